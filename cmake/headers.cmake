@@ -7,7 +7,13 @@ set(afio_HEADERS
   "include/afio/ntkernel-error-category/include/ntkernel_category.hpp"
   "include/afio/revision.hpp"
   "include/afio/v2.0/afio.hpp"
+  "include/afio/v2.0/algorithm/block_cache.hpp"
   "include/afio/v2.0/algorithm/cached_parent_handle_adapter.hpp"
+  "include/afio/v2.0/algorithm/coalescing_writer.hpp"
+  "include/afio/v2.0/algorithm/direct_io_adapter.hpp"
+  "include/afio/v2.0/algorithm/directory_handle_cache.hpp"
+  "include/afio/v2.0/algorithm/directory_walker.hpp"
+  "include/afio/v2.0/algorithm/mapped_ring_buffer.hpp"
   "include/afio/v2.0/algorithm/mapped_view.hpp"
   "include/afio/v2.0/algorithm/shared_fs_mutex/atomic_append.hpp"
   "include/afio/v2.0/algorithm/shared_fs_mutex/base.hpp"
@@ -21,8 +27,10 @@ set(afio_HEADERS
   "include/afio/v2.0/detail/impl/posix/import.hpp"
   "include/afio/v2.0/detail/impl/windows/import.hpp"
   "include/afio/v2.0/directory_handle.hpp"
+  "include/afio/v2.0/directory_watcher.hpp"
   "include/afio/v2.0/file_handle.hpp"
   "include/afio/v2.0/fs_handle.hpp"
+  "include/afio/v2.0/glob_pattern.hpp"
   "include/afio/v2.0/handle.hpp"
   "include/afio/v2.0/io_handle.hpp"
   "include/afio/v2.0/io_service.hpp"
@@ -39,10 +47,18 @@ set(afio_HEADERS
   "include/afio/version.hpp"
   "include/afio/ntkernel-error-category/include/detail/ntkernel-table.ipp"
   "include/afio/ntkernel-error-category/include/detail/ntkernel_category_impl.ipp"
+  "include/afio/v2.0/detail/impl/block_cache.ipp"
   "include/afio/v2.0/detail/impl/cached_parent_handle_adapter.ipp"
+  "include/afio/v2.0/detail/impl/direct_io_adapter.ipp"
+  "include/afio/v2.0/detail/impl/directory_handle_cache.ipp"
+  "include/afio/v2.0/detail/impl/directory_walker.ipp"
+  "include/afio/v2.0/detail/impl/glob_pattern.ipp"
+  "include/afio/v2.0/detail/impl/map_handle.ipp"
+  "include/afio/v2.0/detail/impl/mapped_ring_buffer.ipp"
   "include/afio/v2.0/detail/impl/path_discovery.ipp"
   "include/afio/v2.0/detail/impl/posix/async_file_handle.ipp"
   "include/afio/v2.0/detail/impl/posix/directory_handle.ipp"
+  "include/afio/v2.0/detail/impl/posix/directory_watcher.ipp"
   "include/afio/v2.0/detail/impl/posix/file_handle.ipp"
   "include/afio/v2.0/detail/impl/posix/fs_handle.ipp"
   "include/afio/v2.0/detail/impl/posix/handle.ipp"
@@ -60,6 +76,7 @@ set(afio_HEADERS
   "include/afio/v2.0/detail/impl/storage_profile.ipp"
   "include/afio/v2.0/detail/impl/windows/async_file_handle.ipp"
   "include/afio/v2.0/detail/impl/windows/directory_handle.ipp"
+  "include/afio/v2.0/detail/impl/windows/directory_watcher.ipp"
   "include/afio/v2.0/detail/impl/windows/file_handle.ipp"
   "include/afio/v2.0/detail/impl/windows/fs_handle.ipp"
   "include/afio/v2.0/detail/impl/windows/handle.ipp"
@@ -8,13 +8,38 @@ set(afio_TESTS
   "test/tests/map_handle_create_close/kernel_map_handle.cpp.hpp"
   "test/tests/section_handle_create_close/kernel_section_handle.cpp.hpp"
   "test/tests/async_io.cpp"
+  "test/tests/block_cache.cpp"
+  "test/tests/coalescing_writer.cpp"
   "test/tests/coroutines.cpp"
   "test/tests/current_path.cpp"
+  "test/tests/direct_io_adapter.cpp"
+  "test/tests/directory_handle_cache.cpp"
   "test/tests/directory_handle_create_close/runner.cpp"
   "test/tests/directory_handle_enumerate/runner.cpp"
+  "test/tests/directory_handle_enumerate_cursor.cpp"
+  "test/tests/directory_handle_fill_stat.cpp"
+  "test/tests/directory_handle_glob.cpp"
+  "test/tests/directory_handle_mutate.cpp"
+  "test/tests/directory_handle_version.cpp"
+  "test/tests/directory_walker.cpp"
+  "test/tests/directory_watcher.cpp"
+  "test/tests/file_handle_barrier.cpp"
   "test/tests/file_handle_create_close/runner.cpp"
   "test/tests/file_handle_lock_unlock.cpp"
+  "test/tests/file_handle_send_to.cpp"
+  "test/tests/file_handle_short_io.cpp"
+  "test/tests/fs_handle_exchange.cpp"
+  "test/tests/map_handle_async_barrier.cpp"
   "test/tests/map_handle_create_close/runner.cpp"
+  "test/tests/map_handle_large_pages.cpp"
+  "test/tests/map_handle_lazy.cpp"
+  "test/tests/map_handle_numa.cpp"
+  "test/tests/map_handle_page_statistics.cpp"
+  "test/tests/map_handle_populate.cpp"
+  "test/tests/map_handle_relocate.cpp"
+  "test/tests/mapped_file_handle_growth.cpp"
+  "test/tests/mapped_file_handle_snapshot.cpp"
+  "test/tests/mapped_ring_buffer.cpp"
   "test/tests/mapped_view.cpp"
   "test/tests/path_discovery.cpp"
   "test/tests/path_view.cpp"
@@ -59,11 +59,18 @@ import AFIO_MODULE_NAME;
 
 #include "async_file_handle.hpp"
 #include "directory_handle.hpp"
+#include "directory_watcher.hpp"
 #include "map_handle.hpp"
 #include "statfs.hpp"
 #include "storage_profile.hpp"
 
+#include "algorithm/block_cache.hpp"
 #include "algorithm/cached_parent_handle_adapter.hpp"
+#include "algorithm/coalescing_writer.hpp"
+#include "algorithm/direct_io_adapter.hpp"
+#include "algorithm/directory_handle_cache.hpp"
+#include "algorithm/directory_walker.hpp"
+#include "algorithm/mapped_ring_buffer.hpp"
 #include "algorithm/mapped_view.hpp"
 #include "algorithm/shared_fs_mutex/atomic_append.hpp"
 #include "algorithm/shared_fs_mutex/byte_ranges.hpp"
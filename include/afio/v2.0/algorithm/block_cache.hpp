@@ -0,0 +1,534 @@
+/* A userspace block cache
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef AFIO_BLOCK_CACHE_HPP
+#define AFIO_BLOCK_CACHE_HPP
+
+#include "../io_handle.hpp"
+#include "../utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+//! \file block_cache.hpp Provides a userspace block cache for uncached `io_handle` implementations
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class block_cache
+  \brief A fixed size, process-wide shareable cache of aligned blocks of file content.
+
+  When a handle is opened with `caching::only_metadata` or `caching::none`, the kernel page cache is bypassed
+  and every read goes to the device. This cache keeps recently read blocks in a single arena of large TLB pages
+  allocated via `utils::page_allocator`, so every block is suitably aligned for direct i/o.
+
+  Lookup is lock free. Blocks are found through a number of open addressed hash tables, each changed only
+  under its own lock, which a lookup probes without locking before pinning the block it finds and checking
+  the block was not evicted or reused meanwhile. A lookup racing a change to its table may miss a block which
+  was present, which costs only a redundant read.
+
+  Eviction uses CLOCK-Pro, which like CLOCK costs nothing on a hit beyond setting a referenced bit, so needs no
+  lock on the hit path unlike LRU or ARC. Blocks are either hot or cold. Newly loaded blocks are cold, and are
+  promoted to hot if referenced again before the clock next reaches them, or if they were evicted recently
+  enough to still be remembered. Only cold blocks are evicted, so a single scan through more data than the cache
+  holds cannot displace the hot blocks. The share of the cache given to cold blocks adapts to the workload:
+  it grows whenever a recently evicted block is read again, and shrinks whenever the memory of an evicted
+  block expires without it being read again. Misses take a single clock lock.
+
+  Blocks are pinned whilst in use, and pinned blocks are never evicted. You will normally not use this
+  class directly, rather pass it to `block_cache_adapter<T>`.
+  */
+  class AFIO_DECL block_cache
+  {
+  public:
+    //! The file extent type used by this cache
+    using extent_type = io_handle::extent_type;
+    //! The memory extent type used by this cache
+    using size_type = io_handle::size_type;
+    //! The number of hash table shards
+    static constexpr size_t shards = 16;
+
+    //! A block in the cache
+    struct block
+    {
+      char *data{nullptr};                  //!< Pointer to `block_size()` bytes of aligned storage
+      std::atomic<uint64_t> owner{0};       //!< The owner id of this block, zero if unowned
+      std::atomic<extent_type> index{0};    //!< The block index within the owner
+      std::atomic<unsigned> pins{0};        //!< Non-zero if this block is currently in use
+      std::atomic<bool> referenced{false};  //!< CLOCK-Pro referenced bit, set by each hit
+    };
+
+  private:
+    static size_t _hash(uint64_t owner, extent_type index) noexcept
+    {
+      // The splitmix64 finaliser, so both the shard and the table slot can be taken from it
+      uint64_t x = owner * 0x9E3779B97F4A7C15ULL ^ index;
+      x = (x ^ (x >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+      x = (x ^ (x >> 27U)) * 0x94D049BB133111EBULL;
+      return static_cast<size_t>(x ^ (x >> 31U));
+    }
+    struct key_hasher
+    {
+      size_t operator()(const std::pair<uint64_t, extent_type> &k) const noexcept { return _hash(k.first, k.second); }
+    };
+    // An open addressed, linearly probed table of blocks. Lookups read it without locking, changes are made under lock.
+    struct shard
+    {
+      std::mutex lock;
+      std::unique_ptr<std::atomic<block *>[]> slots;
+      size_t mask{0};
+    };
+    // The CLOCK-Pro state of a page
+    enum class page_status : unsigned char
+    {
+      free,  // not on the clock
+      hot,   // resident hot page
+      cold,  // resident cold page, in its test period
+      test   // non-resident cold page, still in its test period
+    };
+    // A page on the clock. The first blocks() nodes are the resident pages, one per block, the rest
+    // a pool of non-resident pages.
+    struct node
+    {
+      size_t prev{static_cast<size_t>(-1)}, next{static_cast<size_t>(-1)};
+      uint64_t owner{0};
+      extent_type index{0};
+      page_status status{page_status::free};
+    };
+    size_type _block_size;
+    char *_arena{nullptr};
+    size_t _arena_size{0};
+    std::vector<block> _blocks;
+    shard _shards[shards];
+    std::atomic<uint64_t> _next_owner{1};
+    std::atomic<size_type> _hits{0}, _misses{0};
+
+    // Everything below is guarded by _clock_lock
+    std::mutex _clock_lock;
+    std::vector<node> _nodes;
+    size_t _hand_hot{static_cast<size_t>(-1)}, _hand_cold{static_cast<size_t>(-1)}, _hand_test{static_cast<size_t>(-1)};
+    size_t _hot{0}, _cold{0}, _test{0}, _cold_target{0};
+    std::vector<block *> _free;           // blocks on no clock and in no table
+    std::vector<size_t> _nonresident_free;  // unused non-resident nodes
+    std::unordered_map<std::pair<uint64_t, extent_type>, size_t, key_hasher> _nonresident;
+
+    shard &_shard(size_t hash) noexcept { return _shards[hash % shards]; }
+    size_t _home(const shard &s, size_t hash) const noexcept { return (hash / shards) & s.mask; }
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC size_t _find_slot(const shard &s, uint64_t owner, extent_type index) const noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _erase_slot(shard &s, size_t slot) noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _link(size_t n) noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _unlink(size_t n) noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _replace(size_t n, size_t with) noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _end_test(size_t n) noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _run_hand_cold() noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _run_hand_hot() noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _run_hand_test() noexcept;
+
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC block_cache(size_type block_size, size_t blocks);
+
+  public:
+    block_cache(const block_cache &) = delete;
+    block_cache(block_cache &&) = delete;
+    block_cache &operator=(const block_cache &) = delete;
+    block_cache &operator=(block_cache &&) = delete;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC ~block_cache();
+
+    /*! Create a block cache.
+
+    \param bytes The total size of the cache. This is rounded up to a multiple of `block_size`.
+    \param block_size The size of each cached block, which must be a power of two multiple of the
+    logical block size of the devices whose handles will use this cache. Defaults to `utils::page_size()`.
+    \errors `errc::invalid_argument` if the block size is not a power of two, else any error from
+    allocating the arena.
+    \mallocs The arena, plus bookkeeping for each block.
+    */
+    static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::shared_ptr<block_cache>> cache(size_type bytes, size_type block_size = utils::page_size()) noexcept;
+
+    //! The size of each block in the cache
+    size_type block_size() const noexcept { return _block_size; }
+    //! The number of blocks in the cache
+    size_t blocks() const noexcept { return _blocks.size(); }
+    //! The number of lookups which found their block in the cache
+    size_type hits() const noexcept { return _hits.load(std::memory_order_relaxed); }
+    //! The number of lookups which did not find their block in the cache
+    size_type misses() const noexcept { return _misses.load(std::memory_order_relaxed); }
+
+    //! Returns a new unique owner id for keying blocks
+    uint64_t new_owner() noexcept { return _next_owner++; }
+    //! Returns the block if cached, pinned, else null. Does not lock.
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC block *find(uint64_t owner, extent_type index) noexcept;
+    //! Evicts a cold unpinned block if none is free, and returns it pinned and unowned, else null if every block is pinned.
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC block *claim() noexcept;
+    /*! Makes a block returned by `claim()` and since filled findable, returning it. If another thread
+    published the same key in the meantime, the claimed block is released and the other returned pinned instead.
+    */
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC block *publish(block *b, uint64_t owner, extent_type index) noexcept;
+    //! Returns a block returned by `claim()` which will not be published to the cache.
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void release(block *b) noexcept;
+    //! Releases a pin on a block returned by `find()` or `publish()`
+    void unpin(block *b) noexcept { b->pins.fetch_sub(1, std::memory_order_release); }
+    //! Removes any blocks for the owner in the index range [first, last] from the cache.
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void invalidate(uint64_t owner, extent_type first, extent_type last) noexcept;
+  };
+
+  /*! \brief Adapts any `construct()`-able `io_handle` implementation to serve reads from a `block_cache`.
+
+  Reads are split into blocks of `block_cache::block_size()`. Each missing block is read from the adapted
+  handle in full into aligned cache memory, so the adapted handle sees only aligned i/o suitable for
+  `caching::none`. Where a scatter buffer falls entirely within a single cached block, the buffer
+  returned points into the cache without copying, as permitted by the `io_handle::read()` contract.
+  Such buffers remain valid until the next i/o on this handle by the same thread, or its close. Scatter
+  buffers spanning multiple blocks are filled by copying.
+
+  Writes pass straight through to the adapted handle, and any cached blocks they overlap are invalidated.
+  Blocks are keyed per adapter instance, so writes to the same file through some other handle are not
+  seen by the cache. Blocks at the end of the file which are not full are not cached, so appends are
+  always seen. If every block in the cache is pinned, reads bypass the cache into the buffers supplied,
+  so size the cache with many more blocks than concurrent readers.
+  */
+  template <class T> AFIO_REQUIRES(sizeof(construct<T>) > 0) class AFIO_DECL block_cache_adapter : public T
+  {
+    static_assert(sizeof(construct<T>) > 0, "Type T must be registered with the construct<T> framework so block_cache_adapter<T> knows how to construct it");  // NOLINT
+
+  public:
+    //! The handle type being adapted
+    using adapted_handle_type = T;
+    using extent_type = typename T::extent_type;
+    using size_type = typename T::size_type;
+    using buffer_type = typename T::buffer_type;
+    using const_buffer_type = typename T::const_buffer_type;
+    using buffers_type = typename T::buffers_type;
+    using const_buffers_type = typename T::const_buffers_type;
+    template <class U> using io_request = typename T::template io_request<U>;
+    template <class U> using io_result = typename T::template io_result<U>;
+
+  protected:
+    std::shared_ptr<block_cache> _cache;
+    uint64_t _owner{0};
+    // The blocks pinned by zero copy reads, and the thread whose next i/o unpins them
+    std::mutex _pinned_lock;
+    std::vector<std::pair<std::thread::id, block_cache::block *>> _pinned;
+
+    void _unpin_all() noexcept
+    {
+      std::lock_guard<std::mutex> g(_pinned_lock);
+      for(auto &p : _pinned)
+      {
+        _cache->unpin(p.second);
+      }
+      _pinned.clear();
+    }
+    void _unpin_mine() noexcept
+    {
+      const auto me = std::this_thread::get_id();
+      std::lock_guard<std::mutex> g(_pinned_lock);
+      for(size_t n = 0; n < _pinned.size();)
+      {
+        if(_pinned[n].first == me)
+        {
+          _cache->unpin(_pinned[n].second);
+          _pinned[n] = _pinned.back();
+          _pinned.pop_back();
+        }
+        else
+        {
+          n++;
+        }
+      }
+    }
+    // Retains the pin on the block until the next i/o by this thread, returning false if that was not possible
+    bool _pin(block_cache::block *b) noexcept
+    {
+      try
+      {
+        std::lock_guard<std::mutex> g(_pinned_lock);
+        _pinned.emplace_back(std::this_thread::get_id(), b);
+        return true;
+      }
+      catch(...)
+      {
+        return false;
+      }
+    }
+    // Returns the block pinned and how many bytes of it are valid, or null if every block in the cache is pinned.
+    // Blocks not full are not published into the cache, and the caller must release them.
+    result<block_cache::block *> _get(extent_type index, size_t &valid, deadline d) noexcept
+    {
+      valid = _cache->block_size();
+      block_cache::block *b = _cache->find(_owner, index);
+      if(b != nullptr)
+      {
+        return b;
+      }
+      b = _cache->claim();
+      if(b == nullptr)
+      {
+        return nullptr;
+      }
+      buffer_type req{b->data, _cache->block_size()};
+      auto r = adapted_handle_type::read({buffers_type(&req, 1), index * _cache->block_size()}, d);
+      if(!r)
+      {
+        _cache->release(b);
+        return r.error();
+      }
+      const buffer_type &got = *r.value().data();
+      if(got.data != b->data)
+      {
+        memcpy(b->data, got.data, got.len);
+      }
+      valid = got.len;
+      if(valid != _cache->block_size())
+      {
+        return b;
+      }
+      return _cache->publish(b, _owner, index);
+    }
+
+  public:
+    block_cache_adapter() = default;
+    block_cache_adapter(const block_cache_adapter &) = delete;
+    block_cache_adapter(block_cache_adapter &&o) noexcept
+        : adapted_handle_type(std::move(o))
+        , _cache(std::move(o._cache))
+        , _owner(o._owner)
+        , _pinned(std::move(o._pinned))
+    {
+    }
+    block_cache_adapter &operator=(const block_cache_adapter &) = delete;
+    block_cache_adapter &operator=(block_cache_adapter &&o) noexcept
+    {
+      this->~block_cache_adapter();
+      new(this) block_cache_adapter(std::move(o));
+      return *this;
+    }
+    //! Constructs an instance adapting `o` to use the cache `cache`
+    block_cache_adapter(adapted_handle_type &&o, std::shared_ptr<block_cache> cache)
+        : adapted_handle_type(std::move(o))
+        , _cache(std::move(cache))
+        , _owner(_cache->new_owner())
+    {
+    }
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC ~block_cache_adapter() override
+    {
+      if(this->_v)
+      {
+        (void) block_cache_adapter::close();
+      }
+      else if(_cache)
+      {
+        _unpin_all();
+      }
+    }
+
+    //! The cache used by this handle
+    const std::shared_ptr<block_cache> &cache() const noexcept { return _cache; }
+
+    using io_handle::read;
+    /*! \brief Read data, from the block cache where possible.
+
+    \warning Buffers returned may point into the block cache, and are only valid until the next
+    i/o on this handle by the same thread.
+    */
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      _unpin_mine();
+      const size_type bs = _cache->block_size();
+      extent_type offset = reqs.offset;
+      for(auto &req : reqs.buffers)
+      {
+        const size_t len = req.len;
+        if(len == 0)
+        {
+          continue;
+        }
+        const extent_type first = offset / bs, last = (offset + len - 1) / bs;
+        size_t done = 0;
+        for(extent_type index = first; index <= last; index++)
+        {
+          const size_t blockoffset = (index == first) ? static_cast<size_t>(offset - first * bs) : 0;
+          size_t bytes = std::min(len - done, bs - blockoffset), valid = 0;
+          OUTCOME_TRY(b, _get(index, valid, d));
+          if(b == nullptr)
+          {
+            // The cache is full of pinned blocks, so read directly into the buffer supplied
+            buffer_type direct{req.data + done, bytes};
+            OUTCOME_TRY(filled, adapted_handle_type::read({buffers_type(&direct, 1), offset + done}, d));
+            const buffer_type &got = *filled.data();
+            if(got.data != req.data + done)
+            {
+              memmove(req.data + done, got.data, got.len);
+            }
+            done += got.len;
+            if(got.len < bytes)
+            {
+              break;
+            }
+            continue;
+          }
+          const bool full = (valid == bs);
+          if(valid < blockoffset + bytes)
+          {
+            bytes = (valid > blockoffset) ? valid - blockoffset : 0;
+          }
+          if(full && first == last && _pin(b))
+          {
+            // Zero copy
+            req.data = b->data + blockoffset;
+          }
+          else
+          {
+            memcpy(req.data + done, b->data + blockoffset, bytes);
+            if(full)
+            {
+              _cache->unpin(b);
+            }
+            else
+            {
+              _cache->release(b);
+            }
+          }
+          done += bytes;
+          if(!full)
+          {
+            break;
+          }
+        }
+        req.len = done;
+        if(done < len)
+        {
+          // Reached the end of the file, so nothing more can be read
+          for(auto *it = &req + 1; it != reqs.buffers.data() + reqs.buffers.size(); ++it)
+          {
+            it->len = 0;
+          }
+          break;
+        }
+        offset += len;
+      }
+      return reqs.buffers;
+    }
+
+    using io_handle::write;
+    //! \brief Write data through to the adapted handle, invalidating any cached blocks overwritten.
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      _unpin_mine();
+      size_type total = 0;
+      for(const auto &req : reqs.buffers)
+      {
+        total += req.len;
+      }
+      auto ret = adapted_handle_type::write(reqs, d);
+      if(total > 0)
+      {
+        const size_type bs = _cache->block_size();
+        _cache->invalidate(_owner, reqs.offset / bs, (reqs.offset + total - 1) / bs);
+      }
+      return ret;
+    }
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      if(_cache)
+      {
+        _unpin_all();
+      }
+      return adapted_handle_type::close();
+    }
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC native_handle_type release() noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      if(_cache)
+      {
+        _unpin_all();
+      }
+      return adapted_handle_type::release();
+    }
+  };
+  /*! \brief Constructs a `T` adapted to read through the block cache `cache`.
+
+  This function works via the `construct<T>()` free function framework for which your `handle`
+  implementation must have registered its construction details.
+  */
+  template <class T, class... Args> inline result<block_cache_adapter<T>> cache_blocks(std::shared_ptr<block_cache> cache, Args &&... args) noexcept
+  {
+    construct<T> constructor{std::forward<Args>(args)...};
+    OUTCOME_TRY(h, constructor());
+    try
+    {
+      return block_cache_adapter<T>(std::move(h), std::move(cache));
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+}  // namespace algorithm
+
+//! \brief Constructor for `algorithm::block_cache_adapter<T>`
+template <class T> struct construct<algorithm::block_cache_adapter<T>>
+{
+  std::shared_ptr<algorithm::block_cache> cache;
+  construct<T> args;
+  result<algorithm::block_cache_adapter<T>> operator()() const noexcept
+  {
+    OUTCOME_TRY(h, args());
+    try
+    {
+      return algorithm::block_cache_adapter<T>(std::move(h), cache);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+};
+
+AFIO_V2_NAMESPACE_END
+
+#if AFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define AFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/block_cache.ipp"
+#undef AFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
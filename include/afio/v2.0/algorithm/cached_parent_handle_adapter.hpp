@@ -25,7 +25,7 @@ Distributed under the Boost Software License, Version 1.0.
 #ifndef AFIO_CACHED_PARENT_HANDLE_ADAPTER_HPP
 #define AFIO_CACHED_PARENT_HANDLE_ADAPTER_HPP
 
-#include "../directory_handle.hpp"
+#include "directory_handle_cache.hpp"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -41,9 +41,9 @@ namespace algorithm
   {
     struct AFIO_DECL cached_path_handle : public std::enable_shared_from_this<cached_path_handle>
     {
-      directory_handle h;
+      directory_handle_cache::handle_ptr h;
       filesystem::path _lastpath;
-      explicit cached_path_handle(directory_handle &&_h)
+      explicit cached_path_handle(directory_handle_cache::handle_ptr _h)
           : h(std::move(_h))
       {
       }
@@ -60,7 +60,12 @@ namespace algorithm
   e.g. calling `relink()` or `unlink()` a lot on many files with the same parent directory, having to constantly
   fetch the current path, open the parent directory and verify inodes becomes unhelpfully inefficient. This
   adapter keeps a process-wide hash table of directory handles shared between all instances of this adapter,
-  thus making calling `parent_path_handle()` almost zero cost.
+  thus making calling `parent_path_handle()` almost zero cost. The directory handles themselves are obtained from
+  `directory_handle_cache::process()`, so they remain cached for reuse after the last adapter using them is gone.
+
+  `relink()`, `unlink()` and `exchange()` operate on the entry within the cached parent directory directly,
+  costing one `fstatat()` to verify the inode plus the rename or unlink itself. Only if a third party has
+  moved the entry is the slow path of the adapted handle taken.
 
   This adapter is of especial use on platforms which do not reliably implement per-fd path tracking for regular
   files (Apple MacOS, FreeBSD) as `current_path()` is reimplemented to use the current path of the shared parent
@@ -129,14 +134,18 @@ namespace algorithm
     AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<path_handle> parent_path_handle(deadline /* unused */ = std::chrono::seconds(30)) const noexcept override
     {
       AFIO_LOG_FUNCTION_CALL(this);
-      OUTCOME_TRY(ret, _sph->h.clone_to_path_handle());
+      OUTCOME_TRY(ret, _sph->h->clone_to_path_handle());
       return {std::move(ret)};
     }
     AFIO_HEADERS_ONLY_VIRTUAL_SPEC
     result<void> relink(const path_handle &base, path_view_type newpath, bool atomic_replace = true, deadline d = std::chrono::seconds(30)) noexcept override
     {
       AFIO_LOG_FUNCTION_CALL(this);
-      OUTCOME_TRYV(adapted_handle_type::relink(base, newpath, atomic_replace, d));
+      OUTCOME_TRY(done, _in_parent([&](const directory_handle &dirh, const filesystem::path &leafname) { return this->_relink_entry(dirh, leafname, base, newpath, atomic_replace); }));
+      if(!done)
+      {
+        OUTCOME_TRYV(adapted_handle_type::relink(base, newpath, atomic_replace, d));
+      }
       _sph.reset();
       _leafname.clear();
       try
@@ -155,11 +164,100 @@ namespace algorithm
     result<void> unlink(deadline d = std::chrono::seconds(30)) noexcept override
     {
       AFIO_LOG_FUNCTION_CALL(this);
-      OUTCOME_TRYV(adapted_handle_type::unlink(d));
+      OUTCOME_TRY(done, _in_parent([&](const directory_handle &dirh, const filesystem::path &leafname) { return this->_unlink_entry(dirh, leafname); }));
+      if(!done)
+      {
+        OUTCOME_TRYV(adapted_handle_type::unlink(d));
+      }
       _sph.reset();
       _leafname.clear();
       return success();
     }
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC
+    result<void> exchange(fs_handle &o, deadline d = std::chrono::seconds(30)) noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      OUTCOME_TRYV(adapted_handle_type::exchange(o, d));
+      // This handle is now linked wherever the other was, which must be looked up afresh
+      return _recache();
+    }
+    /*! Atomically exchanges the current paths of this open handle and another whose parent directory
+    is also cached, which costs no path lookups unless a third party has moved either.
+    */
+    result<void> exchange(cached_parent_handle_adapter &o, deadline d = std::chrono::seconds(30)) noexcept
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      OUTCOME_TRY(done, _exchange_cached(o));
+      if(!done)
+      {
+        // A third party moved one of the entries, so find where they are now and try once more
+        OUTCOME_TRYV(_recache());
+        OUTCOME_TRYV(o._recache());
+        OUTCOME_TRY(_done, _exchange_cached(o));
+        done = _done;
+      }
+      if(done)
+      {
+        std::swap(_sph, o._sph);
+        std::swap(_leafname, o._leafname);
+        return success();
+      }
+      OUTCOME_TRYV(adapted_handle_type::exchange(o, d));
+      OUTCOME_TRYV(_recache());
+      return o._recache();
+    }
+
+  protected:
+    /* Calls f with the cached parent directory and leafname. If f returns false because a third party has
+    moved the entry, looks them up afresh and calls f once more.
+    */
+    template <class F> result<bool> _in_parent(F &&f) noexcept
+    {
+      if(_sph != nullptr)
+      {
+        OUTCOME_TRY(done, f(*_sph->h, _leafname));
+        if(done)
+        {
+          return true;
+        }
+      }
+      OUTCOME_TRYV(_recache());
+      if(_sph == nullptr)
+      {
+        return false;
+      }
+      return f(*_sph->h, _leafname);
+    }
+    result<bool> _exchange_cached(cached_parent_handle_adapter &o) noexcept
+    {
+      if(_sph == nullptr || o._sph == nullptr)
+      {
+        return false;
+      }
+      return this->_exchange_entries(*_sph->h, _leafname, o, *o._sph->h, o._leafname);
+    }
+    // Looks up the parent directory and leafname of the adapted handle afresh
+    result<void> _recache() noexcept
+    {
+      _sph.reset();
+      _leafname.clear();
+      OUTCOME_TRY(currentpath, adapted_handle_type::current_path());
+      if(currentpath.empty())
+      {
+        return success();
+      }
+      try
+      {
+        auto r = detail::get_cached_path_handle({}, currentpath);
+        _sph = std::move(r.first);
+        _leafname = std::move(r.second);
+        return success();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
   };
   /*! \brief Constructs a `T` adapted into a parent handle caching implementation.
 
@@ -0,0 +1,402 @@
+/* A write coalescing adapter
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef AFIO_COALESCING_WRITER_HPP
+#define AFIO_COALESCING_WRITER_HPP
+
+#include "../io_handle.hpp"
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+//! \file coalescing_writer.hpp Adapts any `io_handle` to coalesce small writes into large gathered writes
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \brief Adapts any `construct()`-able `io_handle` implementation to buffer and coalesce writes in userspace.
+
+  Many small writes at nearby offsets are each a syscall, and if the handle was opened with `caching::reads`
+  or `caching::none`, each is also a round trip to the storage device. This adapter accumulates writes
+  into an extent ordered buffer, merging adjacent and overlapping extents as they arrive, and issues each
+  merged extent as a single large write when any of these occur:
+
+  - The bytes buffered reach `flush_threshold()`.
+  - The oldest buffered write is older than `flush_age()` when the next write or read is issued.
+  - `barrier()`, `flush()` or `close()` are called, or the adapter is destructed.
+
+  Writes whose size meets or exceeds `flush_threshold()` flush the buffer and then bypass it entirely.
+  Reads of ranges not yet written to the underlying handle are served from the buffer, so the view of
+  the file through the adapter is always as if every write had been issued immediately.
+
+  \warning Writes through this adapter are not visible to other handles until flushed. If you truncate
+  the underlying file, or write to it via some other handle, call `flush()` beforehand.
+  */
+  template <class T> AFIO_REQUIRES(sizeof(construct<T>) > 0) class AFIO_DECL coalescing_writer : public T
+  {
+    static_assert(sizeof(construct<T>) > 0, "Type T must be registered with the construct<T> framework so coalescing_writer<T> knows how to construct it");  // NOLINT
+
+  public:
+    //! The handle type being adapted
+    using adapted_handle_type = T;
+    using extent_type = typename T::extent_type;
+    using size_type = typename T::size_type;
+    using buffer_type = typename T::buffer_type;
+    using const_buffer_type = typename T::const_buffer_type;
+    using buffers_type = typename T::buffers_type;
+    using const_buffers_type = typename T::const_buffers_type;
+    template <class U> using io_request = typename T::template io_request<U>;
+    template <class U> using io_result = typename T::template io_result<U>;
+    //! The clock used for measuring the age of buffered writes
+    using clock_type = std::chrono::steady_clock;
+
+  protected:
+    // Key is the offset of the extent, value its contents. Extents never overlap nor abut.
+    std::map<extent_type, std::vector<char>> _extents;
+    size_type _buffered{0};
+    size_type _threshold{1024 * 1024};
+    clock_type::duration _max_age{std::chrono::milliseconds(100)};
+    clock_type::time_point _oldest{};
+
+    // Returns the first extent which overlaps or abuts [offset, offset + bytes)
+    typename std::map<extent_type, std::vector<char>>::iterator _first_touching(extent_type offset) noexcept
+    {
+      auto it = _extents.upper_bound(offset);
+      if(it != _extents.begin())
+      {
+        auto prev = std::prev(it);
+        if(prev->first + prev->second.size() >= offset)
+        {
+          return prev;
+        }
+      }
+      return it;
+    }
+    // Returns the first extent which overlaps [offset, ...)
+    typename std::map<extent_type, std::vector<char>>::iterator _first_overlapping(extent_type offset) noexcept
+    {
+      auto it = _first_touching(offset);
+      if(it != _extents.end() && it->first + it->second.size() == offset)
+      {
+        ++it;
+      }
+      return it;
+    }
+    // Merges the new data into the buffer
+    void _insert(extent_type offset, const char *data, size_t bytes)
+    {
+      extent_type end = offset + bytes;
+      auto first = _first_touching(offset), last = first;
+      while(last != _extents.end() && last->first <= end)
+      {
+        ++last;
+      }
+      if(first == last)
+      {
+        _extents.emplace_hint(first, offset, std::vector<char>(data, data + bytes));
+        _buffered += bytes;
+        return;
+      }
+      extent_type start = std::min(offset, first->first);
+      auto back = std::prev(last);
+      end = std::max(end, back->first + back->second.size());
+      std::vector<char> merged;
+      if(first->first == start)
+      {
+        // Extend the existing extent in place, usually avoiding a copy of its contents
+        merged = std::move(first->second);
+        ++first;
+      }
+      _buffered -= merged.size();
+      merged.resize(static_cast<size_t>(end - start));
+      for(auto it = first; it != last; ++it)
+      {
+        memcpy(merged.data() + (it->first - start), it->second.data(), it->second.size());
+        _buffered -= it->second.size();
+      }
+      memcpy(merged.data() + (offset - start), data, bytes);
+      _buffered += merged.size();
+      auto hint = _extents.erase(_extents.lower_bound(start), last);
+      _extents.emplace_hint(hint, start, std::move(merged));
+    }
+    // Flushes if the size or age thresholds have been exceeded
+    result<void> _maybe_flush() noexcept
+    {
+      if(_extents.empty())
+      {
+        return success();
+      }
+      if(_buffered >= _threshold || clock_type::now() - _oldest >= _max_age)
+      {
+        return flush();
+      }
+      return success();
+    }
+
+  public:
+    coalescing_writer() = default;
+    coalescing_writer(const coalescing_writer &) = delete;
+    coalescing_writer(coalescing_writer &&) = default;  // NOLINT
+    coalescing_writer &operator=(const coalescing_writer &) = delete;
+    coalescing_writer &operator=(coalescing_writer &&o) noexcept
+    {
+      this->~coalescing_writer();
+      new(this) coalescing_writer(std::move(o));
+      return *this;
+    }
+    //! Constructs an instance adapting `o`, flushing when `threshold` bytes are buffered or the oldest buffered write exceeds `max_age`.
+    explicit coalescing_writer(adapted_handle_type &&o, size_type threshold = 1024 * 1024, clock_type::duration max_age = std::chrono::milliseconds(100))
+        : adapted_handle_type(std::move(o))
+        , _threshold(threshold)
+        , _max_age(max_age)
+    {
+    }
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC ~coalescing_writer() override
+    {
+      if(this->_v)
+      {
+        (void) coalescing_writer::close();
+      }
+    }
+
+    //! The number of bytes buffered and not yet written to the adapted handle
+    size_type buffered() const noexcept { return _buffered; }
+    //! The number of bytes buffered at which a flush is triggered
+    size_type flush_threshold() const noexcept { return _threshold; }
+    //! Sets the number of bytes buffered at which a flush is triggered
+    void set_flush_threshold(size_type threshold) noexcept { _threshold = threshold; }
+    //! The maximum age of the oldest buffered write before a flush is triggered
+    clock_type::duration flush_age() const noexcept { return _max_age; }
+    //! Sets the maximum age of the oldest buffered write before a flush is triggered
+    void set_flush_age(clock_type::duration max_age) noexcept { _max_age = max_age; }
+
+    /*! \brief Writes all buffered extents to the adapted handle, one gathered write per extent.
+
+    \errors Any of the values which the adapted handle's `write()` can return. Extents written before
+    the failure are removed from the buffer, those not yet written remain in the buffer.
+    \mallocs None, unless an extent is only partially written, when its remainder is copied into a new extent.
+    */
+    result<void> flush(deadline d = deadline()) noexcept
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      while(!_extents.empty())
+      {
+        auto it = _extents.begin();
+        size_t written = 0;
+        while(written < it->second.size())
+        {
+          const_buffer_type b{it->second.data() + written, it->second.size() - written};
+          OUTCOME_TRY(wrote, adapted_handle_type::write({const_buffers_type(&b, 1), it->first + written}, d));
+          if(wrote.size() == 0 || wrote.data()->len == 0)
+          {
+            // Leave what has not been written in the buffer
+            if(written > 0)
+            {
+              std::vector<char> remaining(it->second.begin() + written, it->second.end());
+              extent_type offset = it->first + written;
+              _extents.erase(it);
+              _extents.emplace(offset, std::move(remaining));
+              _buffered -= written;
+            }
+            return std::errc::io_error;
+          }
+          written += wrote.data()->len;
+        }
+        _buffered -= it->second.size();
+        _extents.erase(it);
+      }
+      return success();
+    }
+
+    using io_handle::write;
+    //! \brief Write data, buffering it in userspace until a flush is triggered.
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      size_type total = 0;
+      for(const auto &b : reqs.buffers)
+      {
+        total += b.len;
+      }
+      if(total >= _threshold)
+      {
+        // Too big to be worth buffering, but all preceding writes must reach the handle first
+        OUTCOME_TRYV(flush(d));
+        return adapted_handle_type::write(reqs, d);
+      }
+      if(_extents.empty())
+      {
+        _oldest = clock_type::now();
+      }
+      try
+      {
+        extent_type offset = reqs.offset;
+        for(const auto &b : reqs.buffers)
+        {
+          if(b.len > 0)
+          {
+            _insert(offset, b.data, b.len);
+          }
+          offset += b.len;
+        }
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+      OUTCOME_TRYV(_maybe_flush());
+      return reqs.buffers;
+    }
+
+    using io_handle::read;
+    /*! \brief Read data, serving any ranges not yet flushed from the write buffer.
+
+    If the adapted handle returns data in different buffers to those supplied (e.g. from a memory map), and
+    the read overlaps buffered writes, the returned data is copied into the buffers supplied so the buffered
+    writes can be overlaid. Bytes between the end of the adapted handle's data and the end of the buffered
+    writes read as zero, as they would after a flush.
+    */
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      OUTCOME_TRYV(_maybe_flush());
+      if(_extents.empty())
+      {
+        return adapted_handle_type::read(reqs, d);
+      }
+      size_type total = 0;
+      for(const auto &b : reqs.buffers)
+      {
+        total += b.len;
+      }
+      auto it = _first_overlapping(reqs.offset);
+      if(it == _extents.end() || it->first >= reqs.offset + total)
+      {
+        // Read doesn't overlap anything buffered
+        return adapted_handle_type::read(reqs, d);
+      }
+      try
+      {
+        std::vector<buffer_type> original(reqs.buffers.begin(), reqs.buffers.end());
+        OUTCOME_TRY(filled, adapted_handle_type::read(reqs, d));
+        const auto &back = *_extents.rbegin();
+        const extent_type buffered_end = back.first + back.second.size();
+        extent_type offset = reqs.offset;
+        for(size_t n = 0; n < original.size() && n < filled.size(); n++)
+        {
+          buffer_type &out = filled[n];
+          const buffer_type &in = original[n];
+          const extent_type end = offset + in.len;
+          size_t len = out.len;
+          if(buffered_end > offset + len)
+          {
+            len = static_cast<size_t>(std::min(end, buffered_end) - offset);
+          }
+          // Does anything buffered overlap this buffer, or lie beyond the end of the adapted handle's data?
+          auto e = _first_overlapping(offset);
+          if(len > out.len || (e != _extents.end() && e->first < offset + len))
+          {
+            if(out.data != in.data)
+            {
+              memmove(in.data, out.data, out.len);
+            }
+            if(len > out.len)
+            {
+              memset(in.data + out.len, 0, len - out.len);
+            }
+            for(; e != _extents.end() && e->first < offset + len; ++e)
+            {
+              extent_type from = std::max(offset, e->first), to = std::min(offset + len, e->first + e->second.size());
+              memcpy(in.data + (from - offset), e->second.data() + (from - e->first), static_cast<size_t>(to - from));
+            }
+            out = {in.data, len};
+          }
+          offset = end;
+        }
+        return filled;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+
+    //! \brief Flushes all buffered writes, then issues the barrier on the adapted handle.
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> barrier(io_request<const_buffers_type> reqs = io_request<const_buffers_type>(), bool wait_for_device = false, bool and_metadata = false, deadline d = deadline()) noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      OUTCOME_TRYV(flush(d));
+      return adapted_handle_type::barrier(reqs, wait_for_device, and_metadata, d);
+    }
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      OUTCOME_TRYV(flush());
+      return adapted_handle_type::close();
+    }
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC native_handle_type release() noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      (void) flush();
+      return adapted_handle_type::release();
+    }
+  };
+  /*! \brief Constructs a `T` adapted into a write coalescing implementation with the default thresholds.
+
+  This function works via the `construct<T>()` free function framework for which your `handle`
+  implementation must have registered its construction details.
+  */
+  template <class T, class... Args> inline result<coalescing_writer<T>> coalesce_writes(Args &&... args) noexcept
+  {
+    construct<T> constructor{std::forward<Args>(args)...};
+    OUTCOME_TRY(h, constructor());
+    return coalescing_writer<T>(std::move(h));
+  }
+
+}  // namespace algorithm
+
+//! \brief Constructor for `algorithm::coalescing_writer<T>`
+template <class T> struct construct<algorithm::coalescing_writer<T>>
+{
+  construct<T> args;
+  result<algorithm::coalescing_writer<T>> operator()() const noexcept
+  {
+    OUTCOME_TRY(h, args());
+    return algorithm::coalescing_writer<T>(std::move(h));
+  }
+};
+
+AFIO_V2_NAMESPACE_END
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
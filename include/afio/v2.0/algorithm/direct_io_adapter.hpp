@@ -0,0 +1,413 @@
+/* A direct i/o alignment adapter
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef AFIO_DIRECT_IO_ADAPTER_HPP
+#define AFIO_DIRECT_IO_ADAPTER_HPP
+
+#include "../file_handle.hpp"
+#include "../utils.hpp"
+
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+//! \file direct_io_adapter.hpp Adapts any `file_handle` to accept unaligned i/o when opened for direct i/o
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    /*! Returns the offset, length and memory alignment required for direct i/o on the handle. On Linux 6.1 or
+    later this is asked of the kernel, else the filing system's block size is used which is always sufficient.
+    */
+    AFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> direct_io_alignment(const handle &h) noexcept;
+  }  // namespace detail
+
+  /*! \brief Adapts any `construct()`-able `file_handle` implementation to perform unaligned i/o on
+  handles opened with `caching::none` or `caching::only_metadata`.
+
+  Direct i/o requires the offset, length and memory address of every buffer to be a multiple of the device's
+  logical block size, otherwise the i/o fails with `EINVAL`. This adapter detects the alignment required,
+  and splits each unaligned buffer into an aligned middle which is transferred without copying, and
+  partial blocks at either end which are bounced through aligned buffers, using read-modify-write for
+  writes. If the buffer's memory is not aligned the same as its offset, the whole buffer is bounced.
+  Bounce buffers are pooled per handle so steady state i/o does not allocate. Handles not requiring
+  aligned i/o pass straight through.
+
+  \warning Read-modify-write is not atomic with respect to concurrent writers of the same blocks, which
+  must therefore be excluded by some other means e.g. byte range locks. Writes ending partway through the
+  last block of the file truncate the file back to the correct length afterwards.
+  */
+  template <class T> AFIO_REQUIRES(sizeof(construct<T>) > 0) class AFIO_DECL direct_io_adapter : public T
+  {
+    static_assert(sizeof(construct<T>) > 0, "Type T must be registered with the construct<T> framework so direct_io_adapter<T> knows how to construct it");  // NOLINT
+
+  public:
+    //! The handle type being adapted
+    using adapted_handle_type = T;
+    using extent_type = typename T::extent_type;
+    using size_type = typename T::size_type;
+    using buffer_type = typename T::buffer_type;
+    using const_buffer_type = typename T::const_buffer_type;
+    using buffers_type = typename T::buffers_type;
+    using const_buffers_type = typename T::const_buffers_type;
+    template <class U> using io_request = typename T::template io_request<U>;
+    template <class U> using io_result = typename T::template io_result<U>;
+
+  protected:
+    size_t _align{0};
+    // Pooled bounce buffers, all page aligned
+    std::vector<std::pair<char *, size_t>> _bounces;
+
+    bool _is_aligned(extent_type v) const noexcept { return (v & (_align - 1)) == 0; }
+    extent_type _round_down(extent_type v) const noexcept { return v & ~static_cast<extent_type>(_align - 1); }
+    extent_type _round_up(extent_type v) const noexcept { return (v + _align - 1) & ~static_cast<extent_type>(_align - 1); }
+    bool _is_aligned(const void *p) const noexcept { return (reinterpret_cast<uintptr_t>(p) & (_align - 1)) == 0; }
+
+    result<std::pair<char *, size_t>> _acquire(size_t bytes) noexcept
+    {
+      for(auto it = _bounces.begin(); it != _bounces.end(); ++it)
+      {
+        if(it->second >= bytes)
+        {
+          auto ret = *it;
+          _bounces.erase(it);
+          return ret;
+        }
+      }
+      try
+      {
+        bytes = utils::round_up_to_page_size(bytes);
+        return std::make_pair(utils::page_allocator<char>().allocate(bytes), bytes);
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+    void _release(std::pair<char *, size_t> b) noexcept
+    {
+      // Keep a few of the most recently used
+      if(_bounces.size() < 4)
+      {
+        try
+        {
+          _bounces.push_back(b);
+          return;
+        }
+        catch(...)
+        {
+        }
+      }
+      utils::page_allocator<char>().deallocate(b.first, b.second);
+    }
+    void _free_bounces() noexcept
+    {
+      for(auto &b : _bounces)
+      {
+        utils::page_allocator<char>().deallocate(b.first, b.second);
+      }
+      _bounces.clear();
+    }
+    // Reads aligned [offset, offset + bytes) into aligned data, returning bytes read
+    result<size_t> _read_aligned(extent_type offset, char *data, size_t bytes, deadline d) noexcept
+    {
+      buffer_type b{data, bytes};
+      OUTCOME_TRY(filled, adapted_handle_type::read({buffers_type(&b, 1), offset}, d));
+      const buffer_type &got = *filled.data();
+      if(got.data != data)
+      {
+        memcpy(data, got.data, got.len);
+      }
+      return got.len;
+    }
+    // Reads unaligned [offset, offset + bytes) via a bounce buffer
+    result<size_t> _read_bounced(extent_type offset, char *data, size_t bytes, deadline d) noexcept
+    {
+      // The bounce buffer is read in whole blocks, so nothing past the end of the file may be copied out of it
+      OUTCOME_TRY(size, this->length());
+      if(offset >= size)
+      {
+        return 0;
+      }
+      bytes = static_cast<size_t>(std::min(static_cast<extent_type>(bytes), size - offset));
+      const extent_type start = _round_down(offset), end = _round_up(offset + bytes);
+      OUTCOME_TRY(bounce, _acquire(static_cast<size_t>(end - start)));
+      auto r = _read_aligned(start, bounce.first, static_cast<size_t>(end - start), d);
+      size_t ret = 0;
+      if(r)
+      {
+        const size_t skip = static_cast<size_t>(offset - start);
+        ret = (r.value() > skip) ? std::min(bytes, r.value() - skip) : 0;
+        memcpy(data, bounce.first + skip, ret);
+      }
+      _release(bounce);
+      OUTCOME_TRYV(r);
+      return ret;
+    }
+    // Writes unaligned [offset, offset + bytes) via a bounce buffer, reading in any partial end blocks first
+    result<void> _write_bounced(extent_type offset, const char *data, size_t bytes, deadline d) noexcept
+    {
+      const extent_type start = _round_down(offset), end = _round_up(offset + bytes);
+      const size_t length = static_cast<size_t>(end - start);
+      OUTCOME_TRY(size, this->length());
+      OUTCOME_TRY(bounce, _acquire(length));
+      auto unbounce = undoer([&] { _release(bounce); });
+      auto fill = [&](extent_type block) -> result<void> {
+        char *p = bounce.first + (block - start);
+        size_t valid = 0;
+        if(block < size)
+        {
+          OUTCOME_TRY(got, _read_aligned(block, p, _align, d));
+          valid = static_cast<size_t>(std::min(static_cast<extent_type>(got), size - block));
+        }
+        // Whatever lies past the end of the file is written as zeros
+        memset(p + valid, 0, _align - valid);
+        return success();
+      };
+      if(start != offset)
+      {
+        OUTCOME_TRYV(fill(start));
+      }
+      if(end != offset + bytes && (end - _align != start || start == offset))
+      {
+        OUTCOME_TRYV(fill(end - _align));
+      }
+      memcpy(bounce.first + (offset - start), data, bytes);
+      const_buffer_type b{bounce.first, length};
+      OUTCOME_TRY(written, adapted_handle_type::write({const_buffers_type(&b, 1), start}, d));
+      if(written.data()->len != length)
+      {
+        return std::errc::io_error;
+      }
+      if(end > std::max(size, offset + bytes))
+      {
+        // The write extended the file to the block boundary, so set it back to what it ought to be
+        OUTCOME_TRYV(this->truncate(std::max(size, offset + bytes)));
+      }
+      return success();
+    }
+
+  public:
+    direct_io_adapter() = default;
+    direct_io_adapter(const direct_io_adapter &) = delete;
+    direct_io_adapter(direct_io_adapter &&) = default;  // NOLINT
+    direct_io_adapter &operator=(const direct_io_adapter &) = delete;
+    direct_io_adapter &operator=(direct_io_adapter &&o) noexcept
+    {
+      this->~direct_io_adapter();
+      new(this) direct_io_adapter(std::move(o));
+      return *this;
+    }
+    //! Constructs an instance adapting `o`, which will align i/o to `align` which must be a power of two.
+    direct_io_adapter(adapted_handle_type &&o, size_t align)
+        : adapted_handle_type(std::move(o))
+        , _align(align)
+    {
+    }
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC ~direct_io_adapter() override
+    {
+      if(this->_v)
+      {
+        (void) direct_io_adapter::close();
+      }
+      _free_bounces();
+    }
+
+    //! The alignment of offset, length and memory address being enforced for direct i/o
+    size_t alignment() const noexcept { return _align; }
+
+    using io_handle::read;
+    //! \brief Read data, bouncing any unaligned parts of buffers through aligned memory.
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      if(!this->requires_aligned_io())
+      {
+        return adapted_handle_type::read(reqs, d);
+      }
+      bool aligned = _is_aligned(reqs.offset);
+      for(const auto &req : reqs.buffers)
+      {
+        aligned = aligned && _is_aligned(req.data) && _is_aligned(req.len);
+      }
+      if(aligned)
+      {
+        return adapted_handle_type::read(reqs, d);
+      }
+      extent_type offset = reqs.offset;
+      bool eof = false;
+      for(auto &req : reqs.buffers)
+      {
+        const size_t len = req.len;
+        if(eof)
+        {
+          req.len = 0;
+          continue;
+        }
+        size_t done = 0;
+        if(_is_aligned(offset) && _is_aligned(req.data) && _is_aligned(len))
+        {
+          OUTCOME_TRY(got, _read_aligned(offset, req.data, len, d));
+          done = got;
+        }
+        else if(_round_up(offset) < _round_down(offset + len) && _is_aligned(req.data + (_round_up(offset) - offset)))
+        {
+          // Bounce the partial blocks at either end, read the aligned middle directly
+          const size_t head = static_cast<size_t>(_round_up(offset) - offset), middle = static_cast<size_t>(_round_down(offset + len) - _round_up(offset));
+          if(head > 0)
+          {
+            OUTCOME_TRY(got, _read_bounced(offset, req.data, head, d));
+            done = got;
+          }
+          if(done == head)
+          {
+            OUTCOME_TRY(got, _read_aligned(offset + head, req.data + head, middle, d));
+            done += got;
+            if(done == head + middle && done < len)
+            {
+              OUTCOME_TRY(got2, _read_bounced(offset + done, req.data + done, len - done, d));
+              done += got2;
+            }
+          }
+        }
+        else
+        {
+          OUTCOME_TRY(got, _read_bounced(offset, req.data, len, d));
+          done = got;
+        }
+        req.len = done;
+        eof = (done < len);
+        offset += len;
+      }
+      return reqs.buffers;
+    }
+
+    using io_handle::write;
+    //! \brief Write data, read-modify-writing any unaligned parts of buffers through aligned memory.
+    AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override
+    {
+      AFIO_LOG_FUNCTION_CALL(this);
+      if(!this->requires_aligned_io())
+      {
+        return adapted_handle_type::write(reqs, d);
+      }
+      bool aligned = _is_aligned(reqs.offset);
+      for(const auto &req : reqs.buffers)
+      {
+        aligned = aligned && _is_aligned(req.data) && _is_aligned(req.len);
+      }
+      if(aligned)
+      {
+        return adapted_handle_type::write(reqs, d);
+      }
+      extent_type offset = reqs.offset;
+      for(const auto &req : reqs.buffers)
+      {
+        const size_t len = req.len;
+        if(len == 0)
+        {
+          continue;
+        }
+        if(_is_aligned(offset) && _is_aligned(req.data) && _is_aligned(len))
+        {
+          const_buffer_type b{req.data, len};
+          OUTCOME_TRY(written, adapted_handle_type::write({const_buffers_type(&b, 1), offset}, d));
+          if(written.data()->len != len)
+          {
+            return std::errc::io_error;
+          }
+        }
+        else if(_round_up(offset) < _round_down(offset + len) && _is_aligned(req.data + (_round_up(offset) - offset)))
+        {
+          // Write the aligned middle directly first, so any file extension by the ends is trimmed correctly
+          const size_t head = static_cast<size_t>(_round_up(offset) - offset), middle = static_cast<size_t>(_round_down(offset + len) - _round_up(offset));
+          const_buffer_type b{req.data + head, middle};
+          OUTCOME_TRY(written, adapted_handle_type::write({const_buffers_type(&b, 1), offset + head}, d));
+          if(written.data()->len != middle)
+          {
+            return std::errc::io_error;
+          }
+          if(head > 0)
+          {
+            OUTCOME_TRYV(_write_bounced(offset, req.data, head, d));
+          }
+          if(head + middle < len)
+          {
+            OUTCOME_TRYV(_write_bounced(offset + head + middle, req.data + head + middle, len - head - middle, d));
+          }
+        }
+        else
+        {
+          OUTCOME_TRYV(_write_bounced(offset, req.data, len, d));
+        }
+        offset += len;
+      }
+      return reqs.buffers;
+    }
+  };
+  /*! \brief Constructs a `T` adapted to accept unaligned i/o when opened for direct i/o.
+
+  This function works via the `construct<T>()` free function framework for which your `handle`
+  implementation must have registered its construction details.
+  */
+  template <class T, class... Args> inline result<direct_io_adapter<T>> align_direct_io(Args &&... args) noexcept
+  {
+    construct<T> constructor{std::forward<Args>(args)...};
+    OUTCOME_TRY(h, constructor());
+    OUTCOME_TRY(align, detail::direct_io_alignment(h));
+    return direct_io_adapter<T>(std::move(h), align);
+  }
+
+}  // namespace algorithm
+
+//! \brief Constructor for `algorithm::direct_io_adapter<T>`
+template <class T> struct construct<algorithm::direct_io_adapter<T>>
+{
+  construct<T> args;
+  result<algorithm::direct_io_adapter<T>> operator()() const noexcept
+  {
+    OUTCOME_TRY(h, args());
+    OUTCOME_TRY(align, algorithm::detail::direct_io_alignment(h));
+    return algorithm::direct_io_adapter<T>(std::move(h), align);
+  }
+};
+
+AFIO_V2_NAMESPACE_END
+
+#if AFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define AFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/direct_io_adapter.ipp"
+#undef AFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,173 @@
+/* A bounded cache of open directory handles keyed by path
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef AFIO_DIRECTORY_HANDLE_CACHE_HPP
+#define AFIO_DIRECTORY_HANDLE_CACHE_HPP
+
+#include "../directory_handle.hpp"
+
+#include <atomic>
+#include <chrono>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+//! \file directory_handle_cache.hpp Provides a bounded cache of open directory handles keyed by path
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class directory_handle_cache
+  \brief A bounded, thread safe cache of open directory handles keyed by absolute path.
+
+  Opening a file deep within a directory tree by absolute path makes the kernel look up every
+  directory along the path, every time. If instead a handle to the containing directory is kept
+  open, the file can be opened relative to it with a single lookup. This cache keeps such handles,
+  so `resolve()` can turn an absolute path into an open handle to its parent directory and a
+  leafname to open relative to it.
+
+  On a miss, the deepest ancestor directory already in the cache is found, and each directory below
+  it is opened relative to its parent and added to the cache, so opening siblings and cousins later
+  finds their directories already cached.
+
+  Each cached handle remembers the device and inode of the directory when it was opened. Because
+  the directory at a path can be renamed or replaced by third parties, a hit is validated by
+  looking up the path again and comparing device and inode, and on mismatch the entry is discarded
+  and the path opened afresh. Validation costs a syscall, so it may be limited to once per
+  `revalidate` interval per entry, in which case a hit costs no syscalls at all but may return a
+  handle to a directory which was moved away from the path within the interval.
+
+  The cache holds at most `capacity()` handles, evicting the least recently used when full. It is
+  divided into shards each with its own lock and LRU list, so threads using different directories
+  rarely contend. Evicted handles remain open until the last `handle_ptr` to them is released.
+  */
+  class AFIO_DECL directory_handle_cache
+  {
+  public:
+    //! The type of pointer to a cached directory handle
+    using handle_ptr = std::shared_ptr<const directory_handle>;
+    //! The path view type used by this cache
+    using path_view_type = directory_handle::path_view_type;
+
+    //! \brief The result of resolving a path
+    struct resolved
+    {
+      handle_ptr parent;        //!< The directory containing the path
+      path_view_type leafname;  //!< The leafname of the path, viewing the path which was resolved
+    };
+    //! \brief Statistics about the use of a cache
+    struct statistics
+    {
+      uint64_t hits{0};       //!< The number of lookups which found a valid handle.
+      uint64_t misses{0};     //!< The number of lookups which had to open a directory.
+      uint64_t stale{0};      //!< The number of cached handles discarded because their path no longer refers to their directory.
+      uint64_t evictions{0};  //!< The number of cached handles evicted to make room.
+    };
+
+  protected:
+    struct _shard;
+    size_t _capacity;
+    size_t _shard_count;
+    std::chrono::steady_clock::duration _revalidate;
+    std::unique_ptr<_shard[]> _shards;
+    std::atomic<uint64_t> _hits{0}, _misses{0}, _stale{0}, _evictions{0};
+
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC _shard &_shard_for(const filesystem::path &path) const noexcept;
+    // Returns a valid cached handle for path, or null
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC handle_ptr _find(const filesystem::path &path) noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _insert(const filesystem::path &path, const handle_ptr &h) noexcept;
+
+  public:
+    /*! \brief Constructs a cache.
+
+    \param capacity The maximum number of handles to cache.
+    \param revalidate How long a hit may go without revalidating the path of the cached handle. Zero
+    means every hit is validated.
+    \param shards The number of independently locked shards. Zero means the hardware concurrency.
+    */
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC explicit directory_handle_cache(size_t capacity = 1024, std::chrono::steady_clock::duration revalidate = std::chrono::steady_clock::duration::zero(), size_t shards = 0);
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC ~directory_handle_cache();
+    directory_handle_cache(const directory_handle_cache &) = delete;
+    directory_handle_cache(directory_handle_cache &&) = delete;
+    directory_handle_cache &operator=(const directory_handle_cache &) = delete;
+    directory_handle_cache &operator=(directory_handle_cache &&) = delete;
+
+    //! The process wide cache, with default construction parameters
+    static AFIO_HEADERS_ONLY_MEMFUNC_SPEC directory_handle_cache &process() noexcept;
+
+    //! The maximum number of handles cached
+    size_t capacity() const noexcept { return _capacity; }
+    //! The number of handles currently cached
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC size_t size() const noexcept;
+    //! Statistics about the use of this cache so far
+    statistics stats() const noexcept
+    {
+      statistics ret;
+      ret.hits = _hits.load(std::memory_order_relaxed);
+      ret.misses = _misses.load(std::memory_order_relaxed);
+      ret.stale = _stale.load(std::memory_order_relaxed);
+      ret.evictions = _evictions.load(std::memory_order_relaxed);
+      return ret;
+    }
+
+    /*! \brief Returns a handle to the directory at an absolute path, from the cache if possible.
+
+    Any path with a root directory is accepted, so on Windows the `\!!\` kernel paths returned by
+    `current_path()`, which lack a drive letter, may be used as well as DOS paths.
+
+    \errors `errc::invalid_argument` if `path` has no root directory. Any of the values
+    `directory_handle::directory()` can return.
+    \mallocs The cache entry of each directory opened.
+    */
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<handle_ptr> directory(const filesystem::path &path) noexcept;
+    /*! \brief Returns a handle to the directory containing an absolute path, and the leafname of the path
+    relative to it.
+
+    The returned leafname views `path`, so is only valid for as long as `path` is.
+
+    \errors `errc::invalid_argument` if `path` is not absolute or has no leafname. As for `directory()`.
+    */
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<resolved> resolve(path_view_type path) noexcept;
+    //! Discards the cached handle of the directory at `path`, and of every directory below it.
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void invalidate(const filesystem::path &path) noexcept;
+    //! Discards all cached handles
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void clear() noexcept;
+  };
+}  // namespace algorithm
+
+AFIO_V2_NAMESPACE_END
+
+#if AFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define AFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/directory_handle_cache.ipp"
+#undef AFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
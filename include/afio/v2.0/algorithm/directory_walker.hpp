@@ -0,0 +1,158 @@
+/* Walks a directory tree in parallel
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef AFIO_DIRECTORY_WALKER_HPP
+#define AFIO_DIRECTORY_WALKER_HPP
+
+#include "../directory_handle.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+//! \file directory_walker.hpp Provides a parallel recursive directory tree walker
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class directory_walker
+  \brief Walks a directory tree using a pool of threads, calling a visitor for every entry found.
+
+  Each directory is opened relative to its already open parent directory, so the walk is immune to
+  concurrent renames of any directory above the one being enumerated, and never builds a path. Each
+  directory is enumerated in batches using `directory_handle::enumerate()` with a cursor, into
+  entry and kernel buffers owned by each thread and reused for every directory, so memory use is
+  bounded by the number of directories awaiting a thread no matter how large any directory is.
+
+  Each thread keeps its own queue of directories to enumerate, pushing the subdirectories it finds
+  onto the back and taking its next directory from the back, so it proceeds depth first through
+  the part of the tree it is working upon. A thread with nothing to do steals from the front of
+  another thread's queue, which holds the directories nearest the root and so most likely the
+  largest subtrees. A walk of a large tree therefore keeps every thread, and as many concurrent
+  filing system requests as there are threads, busy until the tree is exhausted.
+
+  For every entry, the filter if set is called first with just the metadata the enumeration
+  provided, which is only the inode and type on POSIX. Entries it rejects are neither visited nor
+  descended into. Then any metadata wanted but not provided by the enumeration is fetched for the
+  surviving entries of each batch by `directory_handle::fill_stat()`, and the visitor is called for
+  each entry which has not since vanished. If the entry is
+  a directory and the visitor returns `action::descend`, the directory is queued to be walked.
+  Symbolic links are never followed.
+
+  \warning The filter and visitor are called concurrently by all the threads of the walk, so must
+  be thread safe. The leafname of the entry is only valid until they return.
+  */
+  class AFIO_DECL directory_walker
+  {
+  public:
+    //! The path view type used by this walker
+    using path_view_type = directory_handle::path_view_type;
+
+    //! What the walk should do after visiting an entry
+    enum class action
+    {
+      descend,  //!< If the entry is a directory, walk it
+      prune,    //!< Do not walk the entry, if it is a directory
+      stop      //!< Stop the walk as soon as possible
+    };
+    //! The type of the callable which decides if an entry is visited, given its parent directory, the entry and its depth below the root
+    using filter_type = AFIO_V2_NAMESPACE::detail::function_ptr<bool(const directory_handle &parent, const directory_entry &entry, size_t depth)>;
+    //! The type of the callable which visits an entry, given its parent directory, the entry, which of its metadata is valid and its depth below the root
+    using visitor_type = AFIO_V2_NAMESPACE::detail::function_ptr<action(const directory_handle &parent, const directory_entry &entry, stat_t::want metadata, size_t depth)>;
+
+    //! \brief Statistics about a completed walk
+    struct statistics
+    {
+      uint64_t directories{0};  //!< The number of directories enumerated, including the root.
+      uint64_t entries{0};      //!< The number of entries visited.
+      uint64_t vanished{0};     //!< The number of entries or directories which could not be examined because they were removed, or access to them was denied, during the walk.
+    };
+
+  protected:
+    struct _state;
+    visitor_type _visitor;
+    filter_type _filter;
+    stat_t::want _metadata;
+    size_t _threads;
+    size_t _batch;
+
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _run(_state &state, size_t idx) noexcept;
+
+  public:
+    /*! \brief Constructs a walker.
+
+    \param visitor The callable to call for every entry found.
+    \param metadata The metadata to provide to the visitor for every entry. Anything not provided by enumeration is fetched for each entry, which is expensive.
+    \param threads The number of threads to walk with, including the thread calling `walk()`. Zero means the hardware concurrency.
+    \param batch The number of entries each thread enumerates per call into the kernel.
+    */
+    explicit directory_walker(visitor_type visitor, stat_t::want metadata = stat_t::want::none, size_t threads = 0, size_t batch = 256)
+        : _visitor(std::move(visitor))
+        , _metadata(metadata)
+        , _threads(threads != 0 ? threads : std::max(std::thread::hardware_concurrency(), 1U))
+        , _batch(batch != 0 ? batch : 1)
+    {
+    }
+    //! Sets the callable which decides if an entry is visited. An entry it rejects is not descended into either.
+    directory_walker &set_filter(filter_type filter) noexcept
+    {
+      _filter = std::move(filter);
+      return *this;
+    }
+    //! The number of threads used by the walk, including the thread calling `walk()`
+    size_t threads() const noexcept { return _threads; }
+
+    /*! \brief Walks the directory tree rooted at `path` relative to `base`, returning once the whole tree
+    has been walked or the visitor has returned `action::stop`.
+
+    Entries and directories removed during the walk, or to which access is denied, are counted and skipped.
+    Any other failure stops the walk.
+
+    \errors Any of the values `directory_handle::directory()` or `directory_handle::enumerate()` can return for the
+    root, or for any directory if not due to it having been removed or access being denied. Any of the values
+    `std::thread` can throw. Any exception thrown by the filter or visitor.
+    \mallocs The per thread queues and buffers, the threads, and the queue entries.
+    */
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<statistics> walk(const path_handle &base, path_view_type path) noexcept;
+  };
+}  // namespace algorithm
+
+AFIO_V2_NAMESPACE_END
+
+#if AFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define AFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/directory_walker.ipp"
+#undef AFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
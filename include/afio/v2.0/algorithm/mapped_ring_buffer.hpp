@@ -0,0 +1,256 @@
+/* A lock free byte ring buffer stored in a double mapped section
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef AFIO_MAPPED_RING_BUFFER_HPP
+#define AFIO_MAPPED_RING_BUFFER_HPP
+
+#include "../map_handle.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+//! \file mapped_ring_buffer.hpp Provides a lock free byte ring buffer stored in a double mapped section
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class mapped_ring_buffer
+  \brief A lock free, multiple producer single consumer ring of bytes whose storage is a `section_handle`
+  mapped twice back to back.
+
+  Because the second map of the storage immediately follows the first, any run of bytes in the ring is
+  contiguous in memory even if it wraps the end of the storage. Producers therefore always receive a single
+  buffer to write a record into, and the consumer always sees a single buffer of committed bytes, so records
+  never need to be split or copied out in pieces.
+
+  The section begins with a header holding three monotonically increasing 64 bit cursors, each in its own
+  cache line: the position up to which producers have reserved space, the position up to which reserved
+  space has been committed, and the position up to which the consumer has consumed. Producers reserve space
+  with a compare and swap, and then commit in the order in which they reserved, so a producer committing
+  spins until all earlier producers have committed. The consumer loads the commit cursor with acquire
+  semantics, and releases consumed space with release semantics. With a single producer, no producer ever
+  spins.
+
+  The ring may be backed by a file, in which case its contents persist, and any number of processes may map
+  the same file concurrently so long as only one of them consumes. A newly created file whose cursors are all
+  zero is a valid empty ring, so no initialisation protocol between processes is needed. Otherwise the ring
+  lives in an anonymous section, and can only be shared with child processes.
+
+  Capacity is always a power of two multiple of the page size, or of the 64Kb allocation granularity on
+  Windows. No call ever blocks or allocates memory after creation.
+  */
+  class AFIO_DECL mapped_ring_buffer
+  {
+  public:
+    //! The memory extent type used by this ring
+    using size_type = map_handle::size_type;
+    //! The type of buffer written into by producers
+    using buffer_type = map_handle::buffer_type;
+    //! The type of buffer read by the consumer
+    using const_buffer_type = map_handle::const_buffer_type;
+
+  protected:
+    struct _header_type
+    {
+      alignas(64) std::atomic<uint64_t> reserved;   // producers have claimed up to here
+      alignas(64) std::atomic<uint64_t> committed;  // producers have published up to here
+      alignas(64) std::atomic<uint64_t> consumed;   // the consumer has released up to here
+    };
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "mapped_ring_buffer requires address free 64 bit atomics to be shareable between processes");
+
+    section_handle _sh;
+    _header_type *_header{nullptr};  // the header, immediately followed by two maps of the storage
+    char *_data{nullptr};
+    size_type _capacity{0};
+
+    // Both the size of the header and the granularity to which capacity is rounded
+    static AFIO_HEADERS_ONLY_MEMFUNC_SPEC size_type _granularity() noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _map(size_type capacity) noexcept;
+    AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _unmap() noexcept;
+
+  public:
+    //! Default constructor
+    constexpr mapped_ring_buffer() {}  // NOLINT
+    //! Implicit move construction of mapped_ring_buffer permitted
+    mapped_ring_buffer(mapped_ring_buffer &&o) noexcept : _sh(std::move(o._sh)), _header(o._header), _data(o._data), _capacity(o._capacity)
+    {
+      o._header = nullptr;
+      o._data = nullptr;
+      o._capacity = 0;
+    }
+    //! No copy construction
+    mapped_ring_buffer(const mapped_ring_buffer &) = delete;
+    //! Move assignment of mapped_ring_buffer permitted
+    mapped_ring_buffer &operator=(mapped_ring_buffer &&o) noexcept
+    {
+      this->~mapped_ring_buffer();
+      new(this) mapped_ring_buffer(std::move(o));
+      return *this;
+    }
+    //! No copy assignment
+    mapped_ring_buffer &operator=(const mapped_ring_buffer &) = delete;
+    ~mapped_ring_buffer() { _unmap(); }
+
+    /*! \brief Create a ring in an anonymous section.
+
+    \param capacity The minimum number of bytes the ring can hold. Rounded up to a power of two multiple of
+    the page size, or of 64Kb on Windows.
+    \errors `errc::invalid_argument` if `capacity` is zero, else any of the values `section_handle::section()`,
+    `map_handle::map()`, POSIX `mmap()` or Windows `MapViewOfFileEx()` can return.
+    */
+    static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<mapped_ring_buffer> ring(size_type capacity) noexcept;
+    /*! \brief Create a ring stored in a file, or open the ring already stored in a file.
+
+    If the file is empty, it is extended to hold a ring of `capacity`, otherwise the ring already stored in the
+    file is used and `capacity` is ignored. The file handle must remain open for the lifetime of the ring.
+
+    \param backing A writable handle to the file storing the ring.
+    \param capacity The minimum number of bytes the ring can hold if the file is empty. Rounded up to a power of
+    two multiple of the page size, or of 64Kb on Windows.
+    \errors `errc::invalid_argument` if the file is empty and `capacity` is zero, or if the file is not empty and
+    does not contain a ring. Else any of the values `file_handle::truncate()`, `section_handle::section()`,
+    `map_handle::map()`, POSIX `mmap()` or Windows `MapViewOfFileEx()` can return.
+    */
+    static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<mapped_ring_buffer> ring(file_handle &backing, size_type capacity = 0) noexcept;
+
+    //! True if this ring is usable
+    bool is_valid() const noexcept { return _data != nullptr; }
+    //! The number of bytes the ring can hold
+    size_type capacity() const noexcept { return _capacity; }
+    //! The section storing this ring
+    const section_handle &section() const noexcept { return _sh; }
+    //! The number of committed bytes not yet consumed. Approximate unless called by the consumer.
+    size_type size() const noexcept { return static_cast<size_type>(_header->committed.load(std::memory_order_acquire) - _header->consumed.load(std::memory_order_acquire)); }
+    //! True if there are no committed bytes to consume. Approximate unless called by the consumer.
+    bool empty() const noexcept { return size() == 0; }
+
+    /*! \brief Reserves contiguous space for a record in the ring. May be called by any number of producers concurrently.
+
+    The returned buffer must be filled and then passed to `commit()`, which publishes it to the consumer.
+    Until then the consumer cannot see it, nor anything reserved after it.
+
+    \return A buffer of exactly `bytes` to write into.
+    \errors `errc::resource_unavailable_try_again` if there is not currently enough free space in the ring,
+    `errc::invalid_argument` if `bytes` is zero or exceeds `capacity()`.
+    */
+    result<buffer_type> reserve(size_type bytes) noexcept
+    {
+      if(bytes == 0 || bytes > _capacity)
+      {
+        return std::errc::invalid_argument;
+      }
+      uint64_t reserved = _header->reserved.load(std::memory_order_relaxed);
+      for(;;)
+      {
+        uint64_t consumed = _header->consumed.load(std::memory_order_acquire);
+        if(reserved + bytes - consumed > _capacity)
+        {
+          return std::errc::resource_unavailable_try_again;
+        }
+        if(_header->reserved.compare_exchange_weak(reserved, reserved + bytes, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+          return buffer_type{_data + (reserved & (_capacity - 1)), bytes};
+        }
+      }
+    }
+    /*! \brief Publishes a buffer previously returned by `reserve()` to the consumer.
+
+    Commits are published in the order in which they were reserved, so if an earlier reservation by
+    another producer has not yet been committed, this spins until it is.
+    */
+    void commit(buffer_type b) noexcept
+    {
+      uint64_t index = static_cast<uint64_t>(b.data - _data) & (_capacity - 1);
+      for(;;)
+      {
+        // The reservation lies within capacity of the commit cursor, so its position can be recovered from its index
+        uint64_t committed = _header->committed.load(std::memory_order_acquire);
+        uint64_t start = committed + ((index - committed) & (_capacity - 1));
+        if(start == committed)
+        {
+          // Only the producer owning the next reservation can advance the commit cursor
+          _header->committed.store(start + b.len, std::memory_order_release);
+          return;
+        }
+        // Another producer's earlier reservation is still being written
+        std::this_thread::yield();
+      }
+    }
+    /*! \brief Reserves space, copies in the bytes, and commits.
+    \errors As for `reserve()`.
+    */
+    result<void> push(const_buffer_type b) noexcept
+    {
+      OUTCOME_TRY(space, reserve(b.len));
+      memcpy(space.data, b.data, b.len);
+      commit(space);
+      return success();
+    }
+
+    //! Returns all committed bytes not yet consumed, as a single contiguous buffer. Must only be called by the consumer.
+    const_buffer_type peek() const noexcept
+    {
+      uint64_t consumed = _header->consumed.load(std::memory_order_relaxed);
+      uint64_t committed = _header->committed.load(std::memory_order_acquire);
+      return const_buffer_type{_data + (consumed & (_capacity - 1)), static_cast<size_t>(committed - consumed)};
+    }
+    /*! \brief Releases the first `bytes` of `peek()` back to the producers. Must only be called by the consumer.
+
+    `bytes` must not exceed the length of `peek()`. If it does, only the committed bytes are released,
+    as releasing more would let producers overwrite records the consumer has not yet seen.
+    */
+    void consume(size_type bytes) noexcept
+    {
+      uint64_t consumed = _header->consumed.load(std::memory_order_relaxed);
+      uint64_t committed = _header->committed.load(std::memory_order_acquire);
+      assert(bytes <= committed - consumed);
+      if(bytes > committed - consumed)
+      {
+        bytes = static_cast<size_type>(committed - consumed);
+      }
+      _header->consumed.store(consumed + bytes, std::memory_order_release);
+    }
+  };
+}  // namespace algorithm
+
+AFIO_V2_NAMESPACE_END
+
+#if AFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define AFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/mapped_ring_buffer.ipp"
+#undef AFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
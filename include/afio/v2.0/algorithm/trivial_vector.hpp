@@ -324,11 +324,10 @@ namespace algorithm
         {
           // We can always grow a section even with maps open on it
           _sh.truncate(bytes).value();
-          // Attempt to resize the map in place
-          if(!_mh.truncate(bytes, true))
+          // Attempt to resize the map, moving it without copying its contents if needs be
+          if(!_mh.relocate(bytes))
           {
-            // std::cerr << "truncate fail" << std::endl;
-            // If can't resize, close the map and reopen it into a new address
+            // If can't relocate, close the map and reopen it into a new address
             _mh.close().value();
             _mh = map_handle::map(_sh, bytes).value();
           }
@@ -0,0 +1,522 @@
+/* A userspace block cache
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../algorithm/block_cache.hpp"
+
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // Set in block::pins whilst the clock evicts a block, so that lookups racing the eviction back off
+    static constexpr unsigned block_cache_evicting = 1U << 31U;
+    static constexpr size_t block_cache_npos = static_cast<size_t>(-1);
+  }  // namespace detail
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC block_cache::block_cache(size_type block_size, size_t blocks)
+      : _block_size(block_size)
+      , _blocks(blocks)
+      , _nodes(blocks * 2)
+      , _cold_target(std::max<size_t>(blocks / 2, 1))
+  {
+    // Each table can hold every block, but on average is a quarter full at most
+    size_t slots = 16;
+    while(slots < 4 * ((blocks + shards - 1) / shards))
+    {
+      slots <<= 1;
+    }
+    for(auto &s : _shards)
+    {
+      s.slots.reset(new std::atomic<block *>[slots]);
+      s.mask = slots - 1;
+      for(size_t n = 0; n < slots; n++)
+      {
+        s.slots[n].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    _free.reserve(blocks);
+    _nonresident_free.reserve(blocks);
+    _nonresident.reserve(blocks);
+    _arena_size = blocks * block_size;
+    _arena = utils::page_allocator<char>().allocate(_arena_size);
+    for(size_t n = 0; n < blocks; n++)
+    {
+      _blocks[n].data = _arena + n * block_size;
+      _free.push_back(&_blocks[blocks - 1 - n]);
+      _nonresident_free.push_back(2 * blocks - 1 - n);
+    }
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC block_cache::~block_cache()
+  {
+    if(_arena != nullptr)
+    {
+      utils::page_allocator<char>().deallocate(_arena, _arena_size);
+    }
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::shared_ptr<block_cache>> block_cache::cache(size_type bytes, size_type block_size) noexcept
+  {
+    if(block_size == 0 || (block_size & (block_size - 1)) != 0)
+    {
+      return std::errc::invalid_argument;
+    }
+    size_t blocks = static_cast<size_t>((bytes + block_size - 1) / block_size);
+    if(blocks == 0)
+    {
+      return std::errc::invalid_argument;
+    }
+    try
+    {
+      return std::shared_ptr<block_cache>(new block_cache(block_size, blocks));
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC size_t block_cache::_find_slot(const shard &s, uint64_t owner, extent_type index) const noexcept
+  {
+    for(size_t n = 0, slot = _home(s, _hash(owner, index)); n <= s.mask; n++, slot = (slot + 1) & s.mask)
+    {
+      block *b = s.slots[slot].load(std::memory_order_relaxed);
+      if(b == nullptr)
+      {
+        break;
+      }
+      if(b->owner.load(std::memory_order_relaxed) == owner && b->index.load(std::memory_order_relaxed) == index)
+      {
+        return slot;
+      }
+    }
+    return detail::block_cache_npos;
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::_erase_slot(shard &s, size_t slot) noexcept
+  {
+    // Move back any later blocks in the probe run which would no longer be reachable past the hole. A concurrent
+    // lookup may miss a block whilst it moves, which costs it only a redundant read.
+    s.slots[slot].store(nullptr, std::memory_order_release);
+    for(size_t next = (slot + 1) & s.mask;; next = (next + 1) & s.mask)
+    {
+      block *b = s.slots[next].load(std::memory_order_relaxed);
+      if(b == nullptr)
+      {
+        return;
+      }
+      const size_t home = _home(s, _hash(b->owner.load(std::memory_order_relaxed), b->index.load(std::memory_order_relaxed)));
+      const bool stays = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+      if(!stays)
+      {
+        s.slots[slot].store(b, std::memory_order_release);
+        s.slots[next].store(nullptr, std::memory_order_release);
+        slot = next;
+      }
+    }
+  }
+
+  // Inserts the node at the head of the clock, which is just behind the hot hand
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::_link(size_t n) noexcept
+  {
+    node &nd = _nodes[n];
+    if(_hand_hot == detail::block_cache_npos)
+    {
+      nd.prev = nd.next = n;
+      _hand_hot = _hand_cold = _hand_test = n;
+      return;
+    }
+    nd.next = _hand_hot;
+    nd.prev = _nodes[_hand_hot].prev;
+    _nodes[nd.prev].next = n;
+    _nodes[_hand_hot].prev = n;
+  }
+
+  // Removes the node from the clock, moving any hands on it to the next node
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::_unlink(size_t n) noexcept
+  {
+    node &nd = _nodes[n];
+    if(nd.next == n)
+    {
+      _hand_hot = _hand_cold = _hand_test = detail::block_cache_npos;
+    }
+    else
+    {
+      for(size_t *hand : {&_hand_hot, &_hand_cold, &_hand_test})
+      {
+        if(*hand == n)
+        {
+          *hand = nd.next;
+        }
+      }
+      _nodes[nd.prev].next = nd.next;
+      _nodes[nd.next].prev = nd.prev;
+    }
+    nd.prev = nd.next = detail::block_cache_npos;
+  }
+
+  // Puts another node in the place of the node on the clock
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::_replace(size_t n, size_t with) noexcept
+  {
+    node &nd = _nodes[n], &w = _nodes[with];
+    if(nd.next == n)
+    {
+      w.prev = w.next = with;
+    }
+    else
+    {
+      w.prev = nd.prev;
+      w.next = nd.next;
+      _nodes[nd.prev].next = with;
+      _nodes[nd.next].prev = with;
+    }
+    for(size_t *hand : {&_hand_hot, &_hand_cold, &_hand_test})
+    {
+      if(*hand == n)
+      {
+        *hand = with;
+      }
+    }
+    nd.prev = nd.next = detail::block_cache_npos;
+  }
+
+  // Ends the test period of a non-resident page, forgetting it
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::_end_test(size_t n) noexcept
+  {
+    node &nd = _nodes[n];
+    _nonresident.erase(std::make_pair(nd.owner, nd.index));
+    _unlink(n);
+    nd.status = page_status::free;
+    _nonresident_free.push_back(n);
+    --_test;
+  }
+
+  // Evicts the cold page under the hand if it was not referenced since the hand last passed, else promotes it
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::_run_hand_cold() noexcept
+  {
+    const size_t n = _hand_cold;
+    node &nd = _nodes[n];
+    size_t next = nd.next;
+    if(nd.status == page_status::cold)
+    {
+      block *b = &_blocks[n];
+      unsigned expected = 0;
+      if(b->referenced.exchange(false, std::memory_order_relaxed))
+      {
+        // Reused during its test period
+        nd.status = page_status::hot;
+        --_cold;
+        ++_hot;
+      }
+      else if(b->pins.compare_exchange_strong(expected, detail::block_cache_evicting, std::memory_order_acquire))
+      {
+        shard &s = _shard(_hash(nd.owner, nd.index));
+        {
+          std::lock_guard<std::mutex> g(s.lock);
+          const size_t slot = _find_slot(s, nd.owner, nd.index);
+          if(slot != detail::block_cache_npos)
+          {
+            _erase_slot(s, slot);
+          }
+          b->owner.store(0, std::memory_order_relaxed);
+        }
+        // Remember the page in the same place on the clock until its test period ends
+        if(_nonresident_free.empty())
+        {
+          while(_nonresident_free.empty())
+          {
+            _run_hand_test();
+          }
+          next = nd.next;
+        }
+        const size_t t = _nonresident_free.back();
+        bool remembered = false;
+        try
+        {
+          remembered = _nonresident.emplace(std::make_pair(nd.owner, nd.index), t).second;
+        }
+        catch(...)
+        {
+        }
+        if(remembered)
+        {
+          _nonresident_free.pop_back();
+          _nodes[t].owner = nd.owner;
+          _nodes[t].index = nd.index;
+          _nodes[t].status = page_status::test;
+          if(next == n)
+          {
+            next = t;
+          }
+          _replace(n, t);
+          ++_test;
+        }
+        else
+        {
+          if(next == n)
+          {
+            next = detail::block_cache_npos;
+          }
+          _unlink(n);
+        }
+        nd.status = page_status::free;
+        --_cold;
+        b->pins.fetch_sub(detail::block_cache_evicting, std::memory_order_release);
+        _free.push_back(b);
+      }
+    }
+    _hand_cold = next;
+    // Keep the hot pages within their share of the cache
+    while(_hot > 0 && _hot + _cold_target > _blocks.size())
+    {
+      _run_hand_hot();
+    }
+  }
+
+  // Demotes the hot page under the hand to cold if it was not referenced since the hand last passed
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::_run_hand_hot() noexcept
+  {
+    const size_t n = _hand_hot;
+    node &nd = _nodes[n];
+    if(nd.status == page_status::test)
+    {
+      // Test periods end when the hot hand passes, as the page is now older than every hot page
+      _end_test(n);
+      if(_cold_target > 1)
+      {
+        --_cold_target;
+      }
+      return;
+    }
+    if(nd.status == page_status::hot && !_blocks[n].referenced.exchange(false, std::memory_order_relaxed))
+    {
+      nd.status = page_status::cold;
+      --_hot;
+      ++_cold;
+    }
+    _hand_hot = nd.next;
+  }
+
+  // Ends the test period of the non-resident page under the hand
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::_run_hand_test() noexcept
+  {
+    const size_t n = _hand_test;
+    if(_nodes[n].status == page_status::test)
+    {
+      // Not reused within its test period, so cold pages need less of the cache
+      _end_test(n);
+      if(_cold_target > 1)
+      {
+        --_cold_target;
+      }
+      return;
+    }
+    _hand_test = _nodes[n].next;
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC block_cache::block *block_cache::find(uint64_t owner, extent_type index) noexcept
+  {
+    const size_t hash = _hash(owner, index);
+    const shard &s = _shard(hash);
+    for(size_t n = 0, slot = _home(s, hash); n <= s.mask; n++, slot = (slot + 1) & s.mask)
+    {
+      block *b = s.slots[slot].load(std::memory_order_acquire);
+      if(b == nullptr)
+      {
+        break;
+      }
+      if(b->owner.load(std::memory_order_relaxed) != owner || b->index.load(std::memory_order_relaxed) != index)
+      {
+        continue;
+      }
+      // Pin the block, then make sure it was not evicted or reused after we found it
+      const unsigned pins = b->pins.fetch_add(1, std::memory_order_acquire);
+      if((pins & detail::block_cache_evicting) == 0 && b->owner.load(std::memory_order_acquire) == owner && b->index.load(std::memory_order_relaxed) == index)
+      {
+        b->referenced.store(true, std::memory_order_relaxed);
+        _hits.fetch_add(1, std::memory_order_relaxed);
+        return b;
+      }
+      b->pins.fetch_sub(1, std::memory_order_release);
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC block_cache::block *block_cache::claim() noexcept
+  {
+    std::lock_guard<std::mutex> g(_clock_lock);
+    // The cold hand evicts or promotes every cold page it passes, and the hot hand keeps demoting hot pages to
+    // cold, so if a few trips of the clock free nothing, every block must be pinned
+    for(size_t n = 0; n <= _nodes.size() * 4; n++)
+    {
+      for(auto it = _free.begin(); it != _free.end(); ++it)
+      {
+        // Lookups which found a block before it was freed may still hold a transient pin on it
+        unsigned expected = 0;
+        if((*it)->pins.compare_exchange_strong(expected, 1, std::memory_order_acquire))
+        {
+          block *b = *it;
+          *it = _free.back();
+          _free.pop_back();
+          return b;
+        }
+      }
+      if(_hand_cold == detail::block_cache_npos)
+      {
+        break;
+      }
+      _run_hand_cold();
+    }
+    return nullptr;
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC block_cache::block *block_cache::publish(block *b, uint64_t owner, extent_type index) noexcept
+  {
+    std::lock_guard<std::mutex> g(_clock_lock);
+    const size_t hash = _hash(owner, index);
+    shard &s = _shard(hash);
+    {
+      std::lock_guard<std::mutex> g2(s.lock);
+      // Blocks are only evicted under the clock lock, so anything found here is not being evicted
+      const size_t existing = _find_slot(s, owner, index);
+      if(existing != detail::block_cache_npos)
+      {
+        // Somebody else loaded this block first, so use theirs
+        b->pins.fetch_sub(1, std::memory_order_release);
+        _free.push_back(b);
+        b = s.slots[existing].load(std::memory_order_relaxed);
+        b->pins.fetch_add(1, std::memory_order_acquire);
+        b->referenced.store(true, std::memory_order_relaxed);
+        return b;
+      }
+      b->index.store(index, std::memory_order_relaxed);
+      b->owner.store(owner, std::memory_order_release);
+      for(size_t n = 0, slot = _home(s, hash); n <= s.mask; n++, slot = (slot + 1) & s.mask)
+      {
+        if(s.slots[slot].load(std::memory_order_relaxed) == nullptr)
+        {
+          s.slots[slot].store(b, std::memory_order_release);
+          break;
+        }
+      }
+      // If the table is full the block cannot be found, but it is still on the clock to be evicted in time
+    }
+    b->referenced.store(false, std::memory_order_relaxed);
+    const size_t n = static_cast<size_t>(b - _blocks.data());
+    node &nd = _nodes[n];
+    nd.owner = owner;
+    nd.index = index;
+    auto it = _nonresident.find(std::make_pair(owner, index));
+    if(it != _nonresident.end())
+    {
+      // Evicted too soon, so cold pages need more of the cache, and this one is hot
+      _end_test(it->second);
+      if(_cold_target < _blocks.size())
+      {
+        ++_cold_target;
+      }
+      nd.status = page_status::hot;
+      ++_hot;
+    }
+    else
+    {
+      nd.status = page_status::cold;
+      ++_cold;
+    }
+    _link(n);
+    return b;
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::release(block *b) noexcept
+  {
+    std::lock_guard<std::mutex> g(_clock_lock);
+    b->pins.fetch_sub(1, std::memory_order_release);
+    _free.push_back(b);
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void block_cache::invalidate(uint64_t owner, extent_type first, extent_type last) noexcept
+  {
+    std::lock_guard<std::mutex> g(_clock_lock);
+    auto remove = [&](block *b) {
+      const size_t n = static_cast<size_t>(b - _blocks.data());
+      node &nd = _nodes[n];
+      shard &s = _shard(_hash(nd.owner, nd.index));
+      {
+        std::lock_guard<std::mutex> g2(s.lock);
+        const size_t slot = _find_slot(s, nd.owner, nd.index);
+        if(slot != detail::block_cache_npos)
+        {
+          _erase_slot(s, slot);
+        }
+        b->owner.store(0, std::memory_order_relaxed);
+      }
+      if(nd.status == page_status::hot)
+      {
+        --_hot;
+      }
+      else
+      {
+        --_cold;
+      }
+      nd.status = page_status::free;
+      _unlink(n);
+      // Readers may still have it pinned, in which case it is not reused until they are done
+      _free.push_back(b);
+    };
+    if(last - first >= _blocks.size())
+    {
+      // Cheaper to look at every block
+      for(size_t n = 0; n < _blocks.size(); n++)
+      {
+        const page_status status = _nodes[n].status;
+        if((status == page_status::hot || status == page_status::cold) && _nodes[n].owner == owner && _nodes[n].index >= first && _nodes[n].index <= last)
+        {
+          remove(&_blocks[n]);
+        }
+      }
+      return;
+    }
+    for(extent_type index = first; index <= last; index++)
+    {
+      shard &s = _shard(_hash(owner, index));
+      block *b = nullptr;
+      {
+        std::lock_guard<std::mutex> g2(s.lock);
+        const size_t slot = _find_slot(s, owner, index);
+        if(slot != detail::block_cache_npos)
+        {
+          b = s.slots[slot].load(std::memory_order_relaxed);
+        }
+      }
+      if(b != nullptr)
+      {
+        remove(b);
+      }
+    }
+  }
+}  // namespace algorithm
+
+AFIO_V2_NAMESPACE_END
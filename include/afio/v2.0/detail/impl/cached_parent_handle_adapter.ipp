@@ -48,7 +48,7 @@ namespace algorithm
     {
       try
       {
-        auto ret = h.current_path();
+        auto ret = h->current_path();
         auto &map = cached_path_handle_map();
         std::lock_guard<std::mutex> g(map.lock);
         if(!ret)
@@ -77,23 +77,23 @@ namespace algorithm
       filesystem::path dirpath;
       if(base.is_valid())
       {
-        dirpath = base.current_path().value() / path.path();
+        dirpath = base.current_path().value();
+        if(!path.empty())
+        {
+          dirpath /= path.path();
+        }
       }
       else
       {
-        dirpath = path.path();
-        if(path.empty())
+        dirpath = filesystem::current_path();
+        if(!path.empty())
         {
-          dirpath = filesystem::current_path();
+          dirpath /= path.path();  // replaces dirpath if path is absolute
         }
 #ifdef _WIN32
         // On Windows, only use the kernel path form
         dirpath = path_handle::path(dirpath).value().current_path().value();
 #endif
-        if(path.empty())
-        {
-          path = dirpath;
-        }
       }
       auto &map = cached_path_handle_map();
       std::lock_guard<std::mutex> g(map.lock);
@@ -124,8 +124,8 @@ namespace algorithm
           return {ret, leaf.path()};
         }
       }
-      cached_path_handle_ptr ret = std::make_shared<cached_path_handle>(directory_handle::directory(base, path).value());
-      auto _currentpath = ret->h.current_path();
+      cached_path_handle_ptr ret = std::make_shared<cached_path_handle>(directory_handle_cache::process().directory(dirpath).value());
+      auto _currentpath = ret->h->current_path();
       if(_currentpath)
       {
         ret->_lastpath = std::move(_currentpath).value();
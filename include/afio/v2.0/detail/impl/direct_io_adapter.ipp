@@ -0,0 +1,70 @@
+/* A direct i/o alignment adapter
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../algorithm/direct_io_adapter.hpp"
+#include "../../statfs.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    AFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> direct_io_alignment(const handle &h) noexcept
+    {
+      AFIO_LOG_FUNCTION_CALL(&h);
+#if defined(__linux__) && defined(STATX_DIOALIGN)
+      {
+        // Linux 6.1 onwards can tell us exactly
+        struct statx s
+        {
+        };
+        if(0 == ::statx(h.native_handle().fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &s) && (s.stx_mask & STATX_DIOALIGN) != 0 && s.stx_dio_offset_align != 0)
+        {
+          return std::max(static_cast<size_t>(s.stx_dio_offset_align), static_cast<size_t>(s.stx_dio_mem_align));
+        }
+      }
+#endif
+      // The filing system's block size is always a multiple of the device's logical block size
+      statfs_t fs;
+      OUTCOME_TRYV(fs.fill(h, statfs_t::want::bsize));
+      size_t ret = 512;
+      if(fs.f_bsize != statfs_t::_allbits1_64)
+      {
+        while(ret < fs.f_bsize && ret < utils::page_size())
+        {
+          ret <<= 1;
+        }
+      }
+      return ret;
+    }
+  }  // namespace detail
+}  // namespace algorithm
+
+AFIO_V2_NAMESPACE_END
@@ -0,0 +1,318 @@
+/* A bounded cache of open directory handles keyed by path
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../algorithm/directory_handle_cache.hpp"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // True if path still refers to the directory h was opened from
+    static inline bool directory_handle_cache_valid(const filesystem::path &path, const directory_handle &h) noexcept
+    {
+#ifdef _WIN32
+      auto r = directory_handle::directory({}, path, directory_handle::mode::attr_read);
+      return r && r.value().st_dev() == h.st_dev() && r.value().st_ino() == h.st_ino();
+#else
+      struct stat s
+      {
+      };
+      if(-1 == ::stat(path.c_str(), &s))
+      {
+        return false;
+      }
+      return s.st_dev == h.st_dev() && s.st_ino == h.st_ino();
+#endif
+    }
+  }  // namespace detail
+
+  struct directory_handle_cache::_shard
+  {
+    struct entry
+    {
+      filesystem::path path;
+      handle_ptr h;
+      std::chrono::steady_clock::time_point validated;
+    };
+    mutable std::mutex lock;
+    std::list<entry> lru;  // most recently used first
+    std::unordered_map<filesystem::path, std::list<entry>::iterator, path_hasher> by_path;
+  };
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC directory_handle_cache::directory_handle_cache(size_t capacity, std::chrono::steady_clock::duration revalidate, size_t shards)
+      : _capacity(std::max(capacity, static_cast<size_t>(1)))
+      , _shard_count(std::min(std::max(shards != 0 ? shards : static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1)), _capacity))
+      , _revalidate(revalidate)
+      , _shards(new _shard[_shard_count])
+  {
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC directory_handle_cache::~directory_handle_cache() = default;
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC directory_handle_cache &directory_handle_cache::process() noexcept
+  {
+    static directory_handle_cache cache;
+    return cache;
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC directory_handle_cache::_shard &directory_handle_cache::_shard_for(const filesystem::path &path) const noexcept { return _shards[path_hasher()(path) % _shard_count]; }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC directory_handle_cache::handle_ptr directory_handle_cache::_find(const filesystem::path &path) noexcept
+  {
+    _shard &s = _shard_for(path);
+    handle_ptr h;
+    std::chrono::steady_clock::time_point validated;
+    {
+      std::lock_guard<std::mutex> g(s.lock);
+      auto it = s.by_path.find(path);
+      if(it == s.by_path.end())
+      {
+        return {};
+      }
+      s.lru.splice(s.lru.begin(), s.lru, it->second);
+      h = it->second->h;
+      validated = it->second->validated;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if(_revalidate > std::chrono::steady_clock::duration::zero() && now - validated < _revalidate)
+    {
+      return h;
+    }
+    // Validate without holding the lock, as it is a syscall
+    bool valid = detail::directory_handle_cache_valid(path, *h);
+    std::lock_guard<std::mutex> g(s.lock);
+    auto it = s.by_path.find(path);
+    if(it != s.by_path.end() && it->second->h == h)
+    {
+      if(valid)
+      {
+        it->second->validated = now;
+      }
+      else
+      {
+        s.lru.erase(it->second);
+        s.by_path.erase(it);
+      }
+    }
+    if(!valid)
+    {
+      ++_stale;
+      return {};
+    }
+    return h;
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> directory_handle_cache::_insert(const filesystem::path &path, const handle_ptr &h) noexcept
+  {
+    try
+    {
+      _shard &s = _shard_for(path);
+      // Evicted handles are closed after the lock is released
+      handle_ptr evicted;
+      std::lock_guard<std::mutex> g(s.lock);
+      auto it = s.by_path.find(path);
+      if(it != s.by_path.end())
+      {
+        // Another thread raced us to open the same directory
+        evicted = std::move(it->second->h);
+        it->second->h = h;
+        it->second->validated = std::chrono::steady_clock::now();
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return success();
+      }
+      s.lru.push_front(_shard::entry{path, h, std::chrono::steady_clock::now()});
+      try
+      {
+        s.by_path.emplace(path, s.lru.begin());
+      }
+      catch(...)
+      {
+        s.lru.pop_front();
+        throw;
+      }
+      if(s.by_path.size() > _capacity / _shard_count)
+      {
+        evicted = std::move(s.lru.back().h);
+        s.by_path.erase(s.lru.back().path);
+        s.lru.pop_back();
+        ++_evictions;
+      }
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC size_t directory_handle_cache::size() const noexcept
+  {
+    size_t ret = 0;
+    for(size_t n = 0; n < _shard_count; n++)
+    {
+      std::lock_guard<std::mutex> g(_shards[n].lock);
+      ret += _shards[n].by_path.size();
+    }
+    return ret;
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<directory_handle_cache::handle_ptr> directory_handle_cache::directory(const filesystem::path &path) noexcept
+  {
+    AFIO_LOG_FUNCTION_CALL(this);
+    try
+    {
+      // Not is_absolute(), as the Windows kernel paths returned by current_path() have no root name
+      if(!path.has_root_directory())
+      {
+        return std::errc::invalid_argument;
+      }
+      handle_ptr h = _find(path);
+      if(h)
+      {
+        ++_hits;
+        return h;
+      }
+      ++_misses;
+      // Find the deepest cached ancestor, remembering the leafnames below it
+      std::vector<filesystem::path> below;
+      filesystem::path at(path);
+      while(at.has_relative_path())
+      {
+        below.push_back(at.filename());
+        at = at.parent_path();
+        h = _find(at);
+        if(h)
+        {
+          break;
+        }
+      }
+      if(!h)
+      {
+        // Nothing on the way to the root is cached, so open the whole path in one go
+        OUTCOME_TRY(dh, directory_handle::directory({}, path));
+        h = std::make_shared<directory_handle>(std::move(dh));
+        OUTCOME_TRYV(_insert(path, h));
+        return h;
+      }
+      // Open each directory below the ancestor relative to its parent, caching each
+      while(!below.empty())
+      {
+        OUTCOME_TRY(dh, directory_handle::directory(*h, below.back()));
+        at /= below.back();
+        below.pop_back();
+        h = std::make_shared<directory_handle>(std::move(dh));
+        OUTCOME_TRYV(_insert(below.empty() ? path : at, h));
+      }
+      return h;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<directory_handle_cache::resolved> directory_handle_cache::resolve(path_view_type path) noexcept
+  {
+    AFIO_LOG_FUNCTION_CALL(this);
+    path_view_type leafname(path.filename());
+    if(leafname.empty())
+    {
+      return std::errc::invalid_argument;
+    }
+    path.remove_filename();
+    try
+    {
+      OUTCOME_TRY(h, directory(path.path()));
+      return resolved{std::move(h), leafname};
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void directory_handle_cache::invalidate(const filesystem::path &path) noexcept
+  {
+    AFIO_LOG_FUNCTION_CALL(this);
+    const auto &prefix = path.native();
+    auto is_below = [&prefix](const filesystem::path &p) {
+      const auto &n = p.native();
+      if(n.size() < prefix.size() || 0 != n.compare(0, prefix.size(), prefix))
+      {
+        return false;
+      }
+      if(n.size() == prefix.size())
+      {
+        return true;
+      }
+      // Only whole path components match, so /a/b does not invalidate /a/bc
+      auto is_sep = [](filesystem::path::value_type c) { return c == '/' || c == filesystem::path::preferred_separator; };
+      return is_sep(n[prefix.size()]) || (!prefix.empty() && is_sep(prefix.back()));
+    };
+    for(size_t n = 0; n < _shard_count; n++)
+    {
+      _shard &s = _shards[n];
+      std::list<_shard::entry> removed;
+      std::lock_guard<std::mutex> g(s.lock);
+      for(auto it = s.lru.begin(); it != s.lru.end();)
+      {
+        auto next = std::next(it);
+        if(is_below(it->path))
+        {
+          s.by_path.erase(it->path);
+          removed.splice(removed.end(), s.lru, it);
+        }
+        it = next;
+      }
+    }
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void directory_handle_cache::clear() noexcept
+  {
+    AFIO_LOG_FUNCTION_CALL(this);
+    for(size_t n = 0; n < _shard_count; n++)
+    {
+      _shard &s = _shards[n];
+      std::list<_shard::entry> removed;
+      std::lock_guard<std::mutex> g(s.lock);
+      s.by_path.clear();
+      removed.swap(s.lru);
+    }
+  }
+}  // namespace algorithm
+
+AFIO_V2_NAMESPACE_END
@@ -0,0 +1,306 @@
+/* Walks a directory tree in parallel
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../algorithm/directory_walker.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <climits>  // for NAME_MAX
+#endif
+
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // True if a failure to examine something was due to it going away or being denied to us
+    static inline bool directory_walker_vanished(const error_info &e) noexcept { return e == std::errc::no_such_file_or_directory || e == std::errc::not_a_directory || e == std::errc::permission_denied || e == std::errc::too_many_symbolic_link_levels; }
+#ifdef _WIN32
+    // The most a FILE_ID_FULL_DIR_INFORMATION record can need, with a leafname of 255 UTF-16 characters
+    static constexpr size_t directory_walker_max_entry = 128 + 256 * sizeof(wchar_t);
+#else
+    // The most a dirent record can need, with a leafname of NAME_MAX bytes
+    static constexpr size_t directory_walker_max_entry = sizeof(dirent) + NAME_MAX + 1;
+#endif
+  }  // namespace detail
+
+  struct directory_walker::_state
+  {
+    // A directory awaiting enumeration
+    struct item
+    {
+      std::shared_ptr<directory_handle> parent;  // null for the root
+      directory_handle::path_type leafname;
+      size_t depth;
+    };
+    // Each thread's queue of directories, which other threads steal from
+    struct queue
+    {
+      std::mutex lock;
+      std::deque<item> items;
+    };
+
+    const path_handle &base;
+    path_view_type path;
+    std::unique_ptr<queue[]> queues;
+    std::atomic<size_t> outstanding{0};  // directories queued or being enumerated
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> directories{0}, entries{0}, vanished{0};
+    std::mutex idle_lock;
+    std::condition_variable idle;
+    std::atomic<size_t> sleepers{0};
+    std::mutex error_lock;
+    result<void> error{success()};  // the first failure, guarded by error_lock
+
+    _state(const path_handle &_base, path_view_type _path)
+        : base(_base)
+        , path(_path)
+    {
+    }
+
+    void fail(result<void> r) noexcept
+    {
+      std::lock_guard<std::mutex> g(error_lock);
+      if(error)
+      {
+        error = std::move(r);
+      }
+      stop = true;
+    }
+    void push(size_t idx, item &&i)
+    {
+      {
+        std::lock_guard<std::mutex> g(queues[idx].lock);
+        queues[idx].items.push_back(std::move(i));
+      }
+      ++outstanding;
+      if(sleepers.load(std::memory_order_relaxed) > 0)
+      {
+        idle.notify_one();
+      }
+    }
+    bool pop(size_t idx, size_t count, item &i) noexcept
+    {
+      {
+        // Take our own most recently found directory, which is depth first
+        queue &q = queues[idx];
+        std::lock_guard<std::mutex> g(q.lock);
+        if(!q.items.empty())
+        {
+          i = std::move(q.items.back());
+          q.items.pop_back();
+          return true;
+        }
+      }
+      for(size_t n = 1; n < count; n++)
+      {
+        // Steal another thread's least recently found directory, which is nearest the root
+        queue &q = queues[(idx + n) % count];
+        std::lock_guard<std::mutex> g(q.lock);
+        if(!q.items.empty())
+        {
+          i = std::move(q.items.front());
+          q.items.pop_front();
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+
+  void directory_walker::_run(_state &state, size_t idx) noexcept
+  {
+    try
+    {
+      std::vector<directory_entry> _entries(_batch);
+      // enumerate() cannot grow a kernel buffer it is given, so it must fit a whole batch of the longest leafnames
+      std::vector<char> _kernelbuffer(_batch * detail::directory_walker_max_entry);
+      span<char> kernelbuffer(_kernelbuffer);
+      // Type is always needed to know what to descend into
+      const stat_t::want wanted = _metadata | stat_t::want::type;
+      _state::item i;
+      for(;;)
+      {
+        if(state.stop)
+        {
+          return;
+        }
+        if(!state.pop(idx, _threads, i))
+        {
+          if(state.outstanding == 0)
+          {
+            return;
+          }
+          // Wait for another thread to find a directory. The timeout covers a push racing our wait.
+          std::unique_lock<std::mutex> g(state.idle_lock);
+          ++state.sleepers;
+          state.idle.wait_for(g, std::chrono::milliseconds(1));
+          --state.sleepers;
+          continue;
+        }
+        auto done = undoer([&] {
+          i.parent.reset();
+          if(--state.outstanding == 0)
+          {
+            state.idle.notify_all();
+          }
+        });
+        auto _dh = (i.parent != nullptr) ? directory_handle::directory(*i.parent, i.leafname) : directory_handle::directory(state.base, state.path);
+        if(!_dh)
+        {
+          if(i.parent != nullptr && detail::directory_walker_vanished(_dh.error()))
+          {
+            ++state.vanished;
+            continue;
+          }
+          state.fail(_dh.error());
+          return;
+        }
+        auto dh = std::make_shared<directory_handle>(std::move(_dh).value());
+        ++state.directories;
+        directory_handle::enumerate_cursor cursor;
+        while(!cursor.done && !state.stop)
+        {
+          auto _info = dh->enumerate(cursor, span<directory_entry>(_entries), {}, directory_handle::filter::fastdeleted, kernelbuffer);
+          if(!_info)
+          {
+            if(detail::directory_walker_vanished(_info.error()))
+            {
+              ++state.vanished;
+              break;
+            }
+            state.fail(_info.error());
+            return;
+          }
+          auto &info = _info.value();
+          // Compact the entries surviving the filter to the front, so their metadata is fetched in one batch
+          size_t count = 0;
+          for(directory_entry &entry : info.filled)
+          {
+            if(_filter && !_filter(*dh, entry, i.depth))
+            {
+              continue;
+            }
+            if(&entry != &info.filled[count])
+            {
+              info.filled[count] = entry;
+            }
+            ++count;
+          }
+          auto batch = info.filled.subspan(0, count);
+          stat_t::want have = info.metadata;
+          if((wanted & ~have) && count > 0)
+          {
+            auto filled = dh->fill_stat(batch, wanted & ~have);
+            if(!filled)
+            {
+              if(detail::directory_walker_vanished(filled.error()))
+              {
+                ++state.vanished;
+                break;
+              }
+              state.fail(filled.error());
+              return;
+            }
+            have |= filled.value();
+          }
+          for(directory_entry &entry : batch)
+          {
+            if(entry.stat.st_type == filesystem::file_type::not_found)
+            {
+              ++state.vanished;
+              continue;
+            }
+            ++state.entries;
+            action a = _visitor(*dh, entry, have & (_metadata | info.metadata), i.depth);
+            if(a == action::stop)
+            {
+              state.stop = true;
+              break;
+            }
+            if(a == action::descend && entry.stat.st_type == filesystem::file_type::directory)
+            {
+              state.push(idx, _state::item{dh, entry.leafname.path(), i.depth + 1});
+            }
+          }
+        }
+      }
+    }
+    catch(...)
+    {
+      state.fail(error_from_exception());
+    }
+  }
+
+  result<directory_walker::statistics> directory_walker::walk(const path_handle &base, path_view_type path) noexcept
+  {
+    AFIO_LOG_FUNCTION_CALL(this);
+    if(!_visitor)
+    {
+      return std::errc::invalid_argument;
+    }
+    try
+    {
+      _state state(base, path);
+      state.queues = std::make_unique<_state::queue[]>(_threads);
+      state.push(0, _state::item{nullptr, {}, 0});
+      std::vector<std::thread> threads;
+      threads.reserve(_threads - 1);
+      try
+      {
+        for(size_t n = 1; n < _threads; n++)
+        {
+          threads.emplace_back([this, &state, n] { _run(state, n); });
+        }
+      }
+      catch(...)
+      {
+        state.fail(error_from_exception());
+      }
+      _run(state, 0);
+      for(auto &t : threads)
+      {
+        t.join();
+      }
+      OUTCOME_TRYV(state.error);
+      statistics ret;
+      ret.directories = state.directories;
+      ret.entries = state.entries;
+      ret.vanished = state.vanished;
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+}  // namespace algorithm
+
+AFIO_V2_NAMESPACE_END
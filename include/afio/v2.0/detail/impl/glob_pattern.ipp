@@ -0,0 +1,271 @@
+/* A shell glob compiled for fast matching of leafnames
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../glob_pattern.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+AFIO_V2_NAMESPACE_BEGIN
+
+AFIO_HEADERS_ONLY_MEMFUNC_SPEC glob_pattern::glob_pattern(path_view glob)
+{
+#ifdef _WIN32
+  _pattern = glob.path().u8string();
+#else
+  _pattern = glob.path().native();
+#endif
+  using kind = _token::kind;
+  auto add_literal = [this](char c) {
+    if(!_tokens.empty() && _tokens.back().k == kind::literal)
+    {
+      _tokens.back().length++;
+    }
+    else
+    {
+      _tokens.push_back({kind::literal, static_cast<uint32_t>(_literals.size()), 1});
+    }
+    _literals.push_back(c);
+  };
+  // Parses the set after a [, returning where it ends, or null if the [ is not the start of a set
+  auto parse_set = [](const char *p, const char *end, _set &s) -> const char * {
+    static const struct
+    {
+      const char *name;
+      int (*test)(int);
+    } classes[] = {{"alnum", ::isalnum}, {"alpha", ::isalpha}, {"blank", ::isblank}, {"cntrl", ::iscntrl}, {"digit", ::isdigit}, {"graph", ::isgraph},  //
+                   {"lower", ::islower}, {"print", ::isprint}, {"punct", ::ispunct}, {"space", ::isspace}, {"upper", ::isupper}, {"xdigit", ::isxdigit}};
+    bool negate = false;
+    if(p != end && (*p == '!' || *p == '^'))
+    {
+      negate = true;
+      ++p;
+    }
+    for(bool first = true; p != end; first = false)
+    {
+      if(*p == ']' && !first)
+      {
+        if(negate)
+        {
+          for(auto &b : s.bits)
+          {
+            b = ~b;
+          }
+        }
+        return p + 1;
+      }
+      if(*p == '[' && end - p > 1 && p[1] == ':')
+      {
+        string_view rest(p + 2, end - p - 2);
+        size_t idx = rest.find(":]");
+        if(idx != string_view::npos)
+        {
+          string_view name = rest.substr(0, idx);
+          for(const auto &cls : classes)
+          {
+            if(name == cls.name)
+            {
+              // Classes are as in the C locale
+              for(int c = 0; c < 128; c++)
+              {
+                if(cls.test(c) != 0)
+                {
+                  s.set(static_cast<unsigned char>(c));
+                }
+              }
+            }
+          }
+          p = rest.data() + idx + 2;
+          continue;
+        }
+      }
+      if(*p == '\\' && end - p > 1)
+      {
+        ++p;
+      }
+      auto lo = static_cast<unsigned char>(*p++), hi = lo;
+      if(end - p > 1 && *p == '-' && p[1] != ']')
+      {
+        ++p;
+        if(*p == '\\' && end - p > 1)
+        {
+          ++p;
+        }
+        hi = static_cast<unsigned char>(*p++);
+      }
+      for(unsigned c = lo; c <= hi; c++)
+      {
+        s.set(static_cast<unsigned char>(c));
+      }
+    }
+    return nullptr;
+  };
+  const char *p = _pattern.data(), *end = p + _pattern.size();
+  while(p != end)
+  {
+    char c = *p++;
+    switch(c)
+    {
+    case '*':
+      // Consecutive stars are the same as one
+      if(_tokens.empty() || _tokens.back().k != kind::star)
+      {
+        _tokens.push_back({kind::star, 0, 0});
+      }
+      break;
+    case '?':
+      _tokens.push_back({kind::one, 0, 0});
+      break;
+    case '\\':
+      add_literal((p != end) ? *p++ : '\\');
+      break;
+    case '[':
+    {
+      _set s{{0, 0, 0, 0}};
+      const char *q = parse_set(p, end, s);
+      if(q == nullptr)
+      {
+        add_literal(c);
+        break;
+      }
+      p = q;
+      _tokens.push_back({kind::set, static_cast<uint32_t>(_sets.size()), 0});
+      _sets.push_back(s);
+      break;
+    }
+    default:
+      add_literal(c);
+      break;
+    }
+  }
+  auto is = [this](std::initializer_list<kind> kinds) { return _tokens.size() == kinds.size() && std::equal(kinds.begin(), kinds.end(), _tokens.begin(), [](kind a, const _token &b) { return a == b.k; }); };
+  if(_tokens.empty())
+  {
+    _shape = shape::empty;
+  }
+  else if(is({kind::literal}))
+  {
+    _shape = shape::literal;
+    _head = _tokens[0].length;
+  }
+  else if(is({kind::star}))
+  {
+    _shape = shape::any;
+  }
+  else if(is({kind::literal, kind::star}))
+  {
+    _shape = shape::prefix;
+    _head = _tokens[0].length;
+  }
+  else if(is({kind::star, kind::literal}))
+  {
+    _shape = shape::suffix;
+    _tail = _tokens[1].length;
+  }
+  else if(is({kind::literal, kind::star, kind::literal}))
+  {
+    _shape = shape::prefix_suffix;
+    _head = _tokens[0].length;
+    _tail = _tokens[2].length;
+  }
+  else if(is({kind::star, kind::literal, kind::star}))
+  {
+    _shape = shape::infix;
+    _head = _tokens[1].length;
+  }
+  else
+  {
+    _shape = shape::general;
+    return;
+  }
+  // The common shapes don't need the compiled form
+  _tokens.clear();
+  _tokens.shrink_to_fit();
+}
+
+AFIO_HEADERS_ONLY_MEMFUNC_SPEC bool glob_pattern::_match(const char *leafname, size_t length) const noexcept
+{
+  using kind = _token::kind;
+  const _token *t = _tokens.data(), *tend = t + _tokens.size();
+  // Where to resume after the most recent star if what follows it fails to match
+  const _token *star = nullptr;
+  size_t i = 0, starpos = 0;
+  for(;;)
+  {
+    if(t == tend)
+    {
+      if(i == length)
+      {
+        return true;
+      }
+    }
+    else
+    {
+      switch(t->k)
+      {
+      case kind::star:
+        if(++t == tend)
+        {
+          return true;
+        }
+        star = t;
+        starpos = i;
+        continue;
+      case kind::one:
+        if(i < length)
+        {
+          ++i;
+          ++t;
+          continue;
+        }
+        break;
+      case kind::set:
+        if(i < length && _sets[t->offset].test(static_cast<unsigned char>(leafname[i])))
+        {
+          ++i;
+          ++t;
+          continue;
+        }
+        break;
+      case kind::literal:
+        if(length - i >= t->length && 0 == memcmp(leafname + i, _literals.data() + t->offset, t->length))
+        {
+          i += t->length;
+          ++t;
+          continue;
+        }
+        break;
+      }
+    }
+    // Mismatch, so have the most recent star consume one more character and try again
+    if(star == nullptr || starpos >= length)
+    {
+      return false;
+    }
+    t = star;
+    i = ++starpos;
+  }
+}
+
+AFIO_V2_NAMESPACE_END
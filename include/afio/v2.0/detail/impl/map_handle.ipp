@@ -0,0 +1,340 @@
+/* Platform independent parts of map_handle
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../map_handle.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <vector>
+
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace detail
+{
+  /* The background threads upon which async_populate() and async_barrier() run, shared by all maps
+  so the number of threads is bounded however many are in flight. Threads are started as work arrives
+  until there are as many as CPUs, with a minimum of two, and are joined once the remaining work
+  has drained at process exit.
+  */
+  class map_handle_worker_pool
+  {
+    std::mutex _lock;
+    std::condition_variable _changed;
+    std::deque<function_ptr<void()>> _work;
+    std::vector<std::thread> _threads;
+    size_t _idle{0};
+    bool _exiting{false};
+
+    void _run() noexcept
+    {
+      std::unique_lock<decltype(_lock)> g(_lock);
+      for(;;)
+      {
+        ++_idle;
+        _changed.wait(g, [this] { return _exiting || !_work.empty(); });
+        --_idle;
+        if(_work.empty())
+        {
+          return;
+        }
+        auto f = std::move(_work.front());
+        _work.pop_front();
+        g.unlock();
+        f();
+        f.reset();
+        g.lock();
+      }
+    }
+
+  public:
+    map_handle_worker_pool() = default;
+    map_handle_worker_pool(const map_handle_worker_pool &) = delete;
+    map_handle_worker_pool(map_handle_worker_pool &&) = delete;
+    map_handle_worker_pool &operator=(const map_handle_worker_pool &) = delete;
+    map_handle_worker_pool &operator=(map_handle_worker_pool &&) = delete;
+    ~map_handle_worker_pool()
+    {
+      {
+        std::lock_guard<decltype(_lock)> g(_lock);
+        _exiting = true;
+      }
+      _changed.notify_all();
+      for(auto &t : _threads)
+      {
+        t.join();
+      }
+    }
+
+    // Throws if the work could not be queued, or if no thread could be started to run it
+    void post(function_ptr<void()> f)
+    {
+      std::lock_guard<decltype(_lock)> g(_lock);
+      if(_idle <= _work.size() && _threads.size() < std::max<size_t>(std::thread::hardware_concurrency(), 2))
+      {
+        try
+        {
+          _threads.emplace_back([this] { _run(); });
+        }
+        catch(...)
+        {
+          if(_threads.empty())
+          {
+            throw;
+          }
+        }
+      }
+      _work.push_back(std::move(f));
+      _changed.notify_one();
+    }
+  };
+  inline map_handle_worker_pool &map_handle_worker()
+  {
+    static map_handle_worker_pool v;
+    return v;
+  }
+}  // namespace detail
+
+// Waits on a condition variable until ready() or the deadline, returning false if the deadline passed
+template <class Pred> static inline bool map_handle_wait_until(std::condition_variable &changed, std::unique_lock<std::mutex> &g, deadline d, Pred &&ready)
+{
+  if(!d)
+  {
+    changed.wait(g, ready);
+    return true;
+  }
+  if(d.steady)
+  {
+    return changed.wait_for(g, std::chrono::nanoseconds(d.nsecs), ready);
+  }
+  return changed.wait_until(g, d.to_time_point(), ready);
+}
+
+void map_handle::async_populate_state::_run(bool for_write) noexcept
+{
+  for(size_t n = 0; n < _regions.size(); n++)
+  {
+    int status = _cancelled;
+    if(!_cancel.load(std::memory_order_acquire))
+    {
+      auto r = populate(_regions[n], for_write);
+      if(r)
+      {
+        _regions[n] = r.value();
+        status = 0;
+      }
+      else
+      {
+        // populate() only ever returns system errors
+        status = r.error().value();
+      }
+    }
+    {
+      std::lock_guard<decltype(_lock)> g(_lock);
+      _status[n].store(status, std::memory_order_release);
+    }
+    _changed.notify_all();
+    if(_completion)
+    {
+      if(_service != nullptr)
+      {
+        // Posted completions keep the state alive until they have run
+        auto self = shared_from_this();
+        _service->post([self, n](io_service * /*unused*/) { self->_completion(self.get(), n, self->_result(n)); });
+      }
+      else
+      {
+        _completion(this, n, _result(n));
+      }
+    }
+  }
+}
+
+result<map_handle::buffer_type> map_handle::async_populate_state::wait(size_t idx, deadline d) const noexcept
+{
+  if(idx >= _regions.size())
+  {
+    return std::errc::invalid_argument;
+  }
+  if(!is_ready(idx))
+  {
+    std::unique_lock<decltype(_lock)> g(_lock);
+    if(!map_handle_wait_until(_changed, g, d, [&] { return is_ready(idx); }))
+    {
+      return std::errc::timed_out;
+    }
+  }
+  return _result(idx);
+}
+
+result<void> map_handle::async_populate_state::wait(deadline d) const noexcept
+{
+  // Regions complete in order, so waiting upon the last waits upon all with a single deadline
+  if(!is_ready())
+  {
+    std::unique_lock<decltype(_lock)> g(_lock);
+    if(!map_handle_wait_until(_changed, g, d, [&] { return is_ready(); }))
+    {
+      return std::errc::timed_out;
+    }
+  }
+  for(size_t n = 0; n < _regions.size(); n++)
+  {
+    OUTCOME_TRYV(_result(n));
+  }
+  return success();
+}
+
+result<std::shared_ptr<map_handle::async_populate_state>> map_handle::async_populate(span<buffer_type> regions, bool for_write, io_service *service, async_populate_completion completion) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(0);
+  try
+  {
+    auto state = std::make_shared<async_populate_state>(regions);
+    state->_service = service;
+    state->_completion = std::move(completion);
+    detail::map_handle_worker().post(detail::make_function_ptr<void()>([state, for_write] { state->_run(for_write); }));
+    return state;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+struct map_handle::_async_barriers
+{
+  std::mutex lock;
+  std::condition_variable changed;
+  size_t pending{0};
+};
+
+void map_handle::_wait_async_barriers() noexcept
+{
+  if(_barriers != nullptr)
+  {
+    {
+      std::unique_lock<decltype(_barriers->lock)> g(_barriers->lock);
+      _barriers->changed.wait(g, [this] { return _barriers->pending == 0; });
+    }
+    delete _barriers;
+    _barriers = nullptr;
+  }
+}
+
+void map_handle::async_barrier_state::_run() noexcept
+{
+  auto r = _finish();
+  {
+    std::lock_guard<decltype(_lock)> g(_lock);
+    if(!r)
+    {
+      _error = r.error();
+    }
+    _ready.store(true, std::memory_order_release);
+  }
+  _changed.notify_all();
+  if(_completion)
+  {
+    if(_service != nullptr)
+    {
+      // Posted completions keep the state alive until they have run
+      auto self = shared_from_this();
+      _service->post([self](io_service * /*unused*/) { self->_completion(self.get(), self->_result()); });
+    }
+    else
+    {
+      _completion(this, _result());
+    }
+  }
+}
+
+result<map_handle::buffer_type> map_handle::async_barrier_state::wait(deadline d) const noexcept
+{
+  if(!is_ready())
+  {
+    std::unique_lock<decltype(_lock)> g(_lock);
+    if(!map_handle_wait_until(_changed, g, d, [&] { return is_ready(); }))
+    {
+      return std::errc::timed_out;
+    }
+  }
+  return _result();
+}
+
+result<std::shared_ptr<map_handle::async_barrier_state>> map_handle::async_barrier(buffer_type region, bool wait_for_device, bool and_metadata, io_service *service, async_barrier_completion completion) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(region.data == nullptr)
+  {
+    region = {_addr, _length};
+  }
+  if(region.data == nullptr || region.data < _addr || region.data + region.len > _addr + _reservation)
+  {
+    return std::errc::invalid_argument;
+  }
+  char *end = utils::round_up_to_page_size(region.data + region.len, page_size());
+  region.data = utils::round_down_to_page_size(region.data, page_size());
+  region.len = end - region.data;
+  try
+  {
+    auto state = std::make_shared<async_barrier_state>(region);
+    state->_backing = (_section != nullptr) ? _section->backing() : nullptr;
+    state->_offset = _offset + (region.data - _addr);
+    state->_wait_for_device = wait_for_device;
+    state->_and_metadata = and_metadata;
+    state->_service = service;
+    state->_completion = std::move(completion);
+    OUTCOME_TRYV(state->_start());
+    if(_barriers == nullptr)
+    {
+      _barriers = new _async_barriers;
+    }
+    // Counted in flight until the completion has been run or posted, so close() can wait for it
+    _async_barriers *barriers = _barriers;
+    {
+      std::lock_guard<decltype(barriers->lock)> g(barriers->lock);
+      barriers->pending++;
+    }
+    auto unpend = undoer([barriers] {
+      std::lock_guard<decltype(barriers->lock)> g(barriers->lock);
+      barriers->pending--;
+    });
+    detail::map_handle_worker().post(detail::make_function_ptr<void()>([state, barriers] {
+      state->_run();
+      // Notified under the lock, else close() could destroy the condition variable first
+      std::lock_guard<decltype(barriers->lock)> g(barriers->lock);
+      barriers->pending--;
+      barriers->changed.notify_all();
+    }));
+    unpend.dismiss();
+    return state;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+AFIO_V2_NAMESPACE_END
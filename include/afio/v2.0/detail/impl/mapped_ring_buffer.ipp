@@ -0,0 +1,185 @@
+/* A lock free byte ring buffer stored in a double mapped section
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../algorithm/mapped_ring_buffer.hpp"
+
+#ifdef _WIN32
+#include "windows/import.hpp"
+#else
+#include <sys/mman.h>
+#endif
+
+AFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // Rounds up to a power of two multiple of the granularity, returning zero on overflow
+    inline mapped_ring_buffer::size_type round_ring_capacity(mapped_ring_buffer::size_type capacity, mapped_ring_buffer::size_type granularity) noexcept
+    {
+      mapped_ring_buffer::size_type ret = granularity;
+      while(ret != 0 && ret < capacity)
+      {
+        ret <<= 1U;
+      }
+      return ret;
+    }
+  }  // namespace detail
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC mapped_ring_buffer::size_type mapped_ring_buffer::_granularity() noexcept
+  {
+#ifdef _WIN32
+    // Views of sections can only be placed at multiples of the allocation granularity
+    SYSTEM_INFO si{};
+    GetSystemInfo(&si);
+    return si.dwAllocationGranularity;
+#else
+    return utils::page_size();
+#endif
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> mapped_ring_buffer::_map(size_type capacity) noexcept
+  {
+    size_type header = _granularity();
+    // The header and the first map of the storage are one view of the section, the second map of the storage follows
+#ifdef _WIN32
+    HANDLE h = _sh.native_handle().h;
+    ULARGE_INTEGER offset{};
+    offset.QuadPart = header;
+    for(size_t n = 0; n < 64; n++)
+    {
+      void *base = VirtualAlloc(nullptr, header + 2 * capacity, MEM_RESERVE, PAGE_NOACCESS);
+      if(base == nullptr)
+      {
+        return {GetLastError(), std::system_category()};
+      }
+      // Windows cannot place views into reserved address space, so release it and map into where it was.
+      // Another thread may claim the address space in between, in which case try again elsewhere.
+      VirtualFree(base, 0, MEM_RELEASE);
+      auto *addr = static_cast<char *>(base);
+      if(MapViewOfFileEx(h, FILE_MAP_WRITE, 0, 0, header + capacity, addr) == nullptr)
+      {
+        continue;
+      }
+      if(MapViewOfFileEx(h, FILE_MAP_WRITE, offset.HighPart, offset.LowPart, capacity, addr + header + capacity) == nullptr)
+      {
+        UnmapViewOfFile(addr);
+        continue;
+      }
+      _header = reinterpret_cast<_header_type *>(addr);
+      _data = addr + header;
+      _capacity = capacity;
+      return success();
+    }
+    return std::errc::not_enough_memory;
+#else
+    // Reserve the whole region, and then map the section over it in place
+    void *base = ::mmap(nullptr, header + 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);  // NOLINT
+    if(MAP_FAILED == base)
+    {
+      return {errno, std::system_category()};
+    }
+    auto *addr = static_cast<char *>(base);
+    int fd = _sh.native_handle().fd;
+    if(MAP_FAILED == ::mmap(addr, header + capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) || MAP_FAILED == ::mmap(addr + header + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, header))  // NOLINT
+    {
+      int errcode = errno;
+      ::munmap(base, header + 2 * capacity);
+      return {errcode, std::system_category()};
+    }
+    _header = reinterpret_cast<_header_type *>(addr);
+    _data = addr + header;
+    _capacity = capacity;
+    return success();
+#endif
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void mapped_ring_buffer::_unmap() noexcept
+  {
+    if(_header != nullptr)
+    {
+#ifdef _WIN32
+      UnmapViewOfFile(_header);
+      UnmapViewOfFile(_data + _capacity);
+#else
+      ::munmap(_header, _granularity() + 2 * _capacity);
+#endif
+      _header = nullptr;
+      _data = nullptr;
+      _capacity = 0;
+    }
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<mapped_ring_buffer> mapped_ring_buffer::ring(size_type capacity) noexcept
+  {
+    size_type header = _granularity();
+    capacity = (capacity != 0) ? detail::round_ring_capacity(capacity, header) : 0;
+    if(capacity == 0)
+    {
+      return std::errc::invalid_argument;
+    }
+    // A newly created section is all bits zero, which is an empty ring
+    OUTCOME_TRY(sh, section_handle::section(header + capacity));
+    mapped_ring_buffer ret;
+    ret._sh = std::move(sh);
+    OUTCOME_TRYV(ret._map(capacity));
+    return {std::move(ret)};
+  }
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<mapped_ring_buffer> mapped_ring_buffer::ring(file_handle &backing, size_type capacity) noexcept
+  {
+    size_type header = _granularity();
+    OUTCOME_TRY(length, backing.maximum_extent());
+    if(length == 0)
+    {
+      capacity = (capacity != 0) ? detail::round_ring_capacity(capacity, header) : 0;
+      if(capacity == 0)
+      {
+        return std::errc::invalid_argument;
+      }
+      // Extending the file zero fills it, which is an empty ring
+      OUTCOME_TRYV(backing.truncate(header + capacity));
+    }
+    else
+    {
+      if(length <= header)
+      {
+        return std::errc::invalid_argument;
+      }
+      capacity = static_cast<size_type>(length - header);
+      if((capacity & (capacity - 1)) != 0 || (capacity % header) != 0)
+      {
+        return std::errc::invalid_argument;
+      }
+    }
+    OUTCOME_TRY(sh, section_handle::section(backing, header + capacity, section_handle::flag::readwrite));
+    mapped_ring_buffer ret;
+    ret._sh = std::move(sh);
+    OUTCOME_TRYV(ret._map(capacity));
+    return {std::move(ret)};
+  }
+}  // namespace algorithm
+
+AFIO_V2_NAMESPACE_END
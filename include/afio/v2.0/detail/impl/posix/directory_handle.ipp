@@ -32,13 +32,104 @@ http://www.boost.org/LICENSE_1_0.txt)
 #define AFIO_VALGRIND_MAKE_MEM_DEFINED_IF_ADDRESSABLE(a, b)
 #endif
 
+#include <algorithm>  // for max
 #include <dirent.h> /* Defines DT_* constants */
-#include <fnmatch.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>  // for makedev
+#endif
 
 AFIO_V2_NAMESPACE_BEGIN
 
+// Sets type to the file type of a dirent's d_type, returning false if the filing system didn't say
+static inline bool dirent_type(unsigned char d_type, filesystem::file_type &type) noexcept
+{
+  switch(d_type)
+  {
+  case DT_BLK:
+    type = filesystem::file_type::block;
+    return true;
+  case DT_CHR:
+    type = filesystem::file_type::character;
+    return true;
+  case DT_DIR:
+    type = filesystem::file_type::directory;
+    return true;
+  case DT_FIFO:
+    type = filesystem::file_type::fifo;
+    return true;
+  case DT_LNK:
+    type = filesystem::file_type::symlink;
+    return true;
+  case DT_REG:
+    type = filesystem::file_type::regular;
+    return true;
+  case DT_SOCK:
+    type = filesystem::file_type::socket;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Returns the directory seek offset immediately after a dirent
+template <class T> static inline uint64_t dirent_offset(const T *dent) noexcept
+{
+#ifdef __APPLE__
+  return static_cast<uint64_t>(dent->d_seekoff);
+#else
+  return static_cast<uint64_t>(dent->d_off);
+#endif
+}
+
+// Reads the modification and status change times of a directory with a single syscall
+static inline result<void> directory_times(int fd, std::chrono::system_clock::time_point &mtim, std::chrono::system_clock::time_point &ctim) noexcept
+{
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+  // Asking for only the times saves work on network and fuse filing systems
+  struct statx sx
+  {
+  };
+  if(-1 != ::statx(fd, "", AT_EMPTY_PATH, STATX_MTIME | STATX_CTIME, &sx))
+  {
+    struct timespec t
+    {
+    };
+    t.tv_sec = sx.stx_mtime.tv_sec;
+    t.tv_nsec = sx.stx_mtime.tv_nsec;
+    mtim = to_timepoint(t);
+    t.tv_sec = sx.stx_ctime.tv_sec;
+    t.tv_nsec = sx.stx_ctime.tv_nsec;
+    ctim = to_timepoint(t);
+    return success();
+  }
+  if(ENOSYS != errno)
+  {
+    return {errno, std::system_category()};
+  }
+// Kernels before 4.11 don't have statx
+#endif
+  struct stat s
+  {
+  };
+  if(-1 == ::fstat(fd, &s))
+  {
+    return {errno, std::system_category()};
+  }
+#ifdef __ANDROID__
+  mtim = to_timepoint(*((struct timespec *) &s.st_mtime));
+  ctim = to_timepoint(*((struct timespec *) &s.st_ctime));
+#elif defined(__APPLE__)
+  mtim = to_timepoint(s.st_mtimespec);
+  ctim = to_timepoint(s.st_ctimespec);
+#else  // Linux and BSD
+  mtim = to_timepoint(s.st_mtim);
+  ctim = to_timepoint(s.st_ctim);
+#endif
+  return success();
+}
+
 result<directory_handle> directory_handle::directory(const path_handle &base, path_view_type path, mode _mode, creation _creation, caching _caching, flag flags) noexcept
 {
   if(flags & flag::unlink_on_close)
@@ -209,7 +300,7 @@ AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<path_handle> directory_handle::clone_to_pa
   return ret;
 }
 
-result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_type &&tofill, path_view_type glob, filter /*unused*/, span<char> kernelbuffer) const noexcept
+result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_type &&tofill, path_view_type glob, filter filtering, span<char> kernelbuffer) const noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
   if(tofill.empty())
@@ -217,9 +308,9 @@ result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_typ
     return enumerate_info{std::move(tofill), stat_t::want::none, false};
   }
   // Is glob a single entry match? If so, this is really a stat call
-  path_view_type::c_str zglob(glob);
   if(!glob.empty() && !glob.contains_glob())
   {
+    path_view_type::c_str zglob(glob);
     struct stat s
     {
     };
@@ -281,6 +372,30 @@ result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_typ
                                                           | stat_t::want::sparse;
     return enumerate_info{std::move(tofill), default_stat_contents, true};
   }
+  try
+  {
+    return enumerate(std::move(tofill), glob_pattern(glob), filtering, kernelbuffer);
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_type &&tofill, const glob_pattern &glob, filter filtering, span<char> kernelbuffer) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(tofill.empty())
+  {
+    return enumerate_info{std::move(tofill), stat_t::want::none, false};
+  }
+  // A glob matching a single entry is really a stat call
+  if(glob.kind() == glob_pattern::shape::literal && !glob.literal().contains_glob())
+  {
+    return enumerate(std::move(tofill), glob.literal(), filtering, kernelbuffer);
+  }
+  // Taken before any entry is read, so any change during the enumeration is seen
+  OUTCOME_TRY(version_before, version());
 #ifdef __linux__
   // Unlike FreeBSD, Linux doesn't define a getdents() function, so we'll do that here.
   using getdents64_t = int (*)(int, char *, unsigned int);
@@ -351,7 +466,7 @@ result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_typ
   if(bytes == 0)
   {
     tofill._resize(0);
-    return enumerate_info{std::move(tofill), default_stat_contents, true};
+    return enumerate_info{std::move(tofill), default_stat_contents, true, version_before};
   }
   AFIO_VALGRIND_MAKE_MEM_DEFINED_IF_ADDRESSABLE(buffer, bytes);  // NOLINT
   size_t n = 0;
@@ -367,7 +482,7 @@ result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_typ
           goto cont;
         }
       }
-      if(!glob.empty() && fnmatch(zglob.buffer, dent->d_name, 0) != 0)
+      if(!glob.matches(dent->d_name, length))
       {
         goto cont;
       }
@@ -375,34 +490,10 @@ result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_typ
       item.leafname = path_view(dent->d_name, length);
       item.stat = stat_t(nullptr);
       item.stat.st_ino = dent->d_ino;
-      char d_type = dent->d_type;
-      switch(d_type)
+      if(!dirent_type(dent->d_type, item.stat.st_type))
       {
-      case DT_BLK:
-        item.stat.st_type = filesystem::file_type::block;
-        break;
-      case DT_CHR:
-        item.stat.st_type = filesystem::file_type::character;
-        break;
-      case DT_DIR:
-        item.stat.st_type = filesystem::file_type::directory;
-        break;
-      case DT_FIFO:
-        item.stat.st_type = filesystem::file_type::fifo;
-        break;
-      case DT_LNK:
-        item.stat.st_type = filesystem::file_type::symlink;
-        break;
-      case DT_REG:
-        item.stat.st_type = filesystem::file_type::regular;
-        break;
-      case DT_SOCK:
-        item.stat.st_type = filesystem::file_type::socket;
-        break;
-      default:
         // Don't say we return type
         default_stat_contents = default_stat_contents & ~stat_t::want::type;
-        break;
       }
       n++;
     }
@@ -411,14 +502,467 @@ result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_typ
     {
       // Fill is complete
       tofill._resize(n);
-      return enumerate_info{std::move(tofill), default_stat_contents, true};
+      return enumerate_info{std::move(tofill), default_stat_contents, true, version_before};
     }
     if(n >= tofill.size())
     {
       // Fill is incomplete
-      return enumerate_info{std::move(tofill), default_stat_contents, false};
+      return enumerate_info{std::move(tofill), default_stat_contents, false, version_before};
+    }
+  }
+}
+
+result<directory_handle::enumerate_info> directory_handle::enumerate(enumerate_cursor &cursor, buffers_type &&tofill, path_view_type glob, filter filtering, span<char> kernelbuffer) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(tofill.empty())
+  {
+    return enumerate_info{std::move(tofill), stat_t::want::none, cursor.done};
+  }
+  if(cursor.done)
+  {
+    tofill._resize(0);
+    return enumerate_info{std::move(tofill), stat_t::want::none, true};
+  }
+  // A single entry match is a stat call, so there is nothing to resume
+  if(!glob.empty() && !glob.contains_glob())
+  {
+    OUTCOME_TRY(ret, enumerate(std::move(tofill), glob, filtering, kernelbuffer));
+    cursor.done = true;
+    return std::move(ret);
+  }
+  try
+  {
+    return enumerate(cursor, std::move(tofill), glob_pattern(glob), filtering, kernelbuffer);
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+result<directory_handle::enumerate_info> directory_handle::enumerate(enumerate_cursor &cursor, buffers_type &&tofill, const glob_pattern &glob, filter filtering, span<char> kernelbuffer) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(tofill.empty())
+  {
+    return enumerate_info{std::move(tofill), stat_t::want::none, cursor.done};
+  }
+  if(cursor.done)
+  {
+    tofill._resize(0);
+    return enumerate_info{std::move(tofill), stat_t::want::none, true, cursor.version};
+  }
+  // A single entry match is a stat call, so there is nothing to resume
+  if(glob.kind() == glob_pattern::shape::literal && !glob.literal().contains_glob())
+  {
+    OUTCOME_TRY(ret, enumerate(std::move(tofill), glob.literal(), filtering, kernelbuffer));
+    cursor.done = true;
+    return std::move(ret);
+  }
+  if(cursor.position == 0)
+  {
+    // Taken before the first entry is read, so any change during the enumeration is seen
+    OUTCOME_TRY(version_before, version());
+    cursor.version = version_before;
+  }
+#ifdef __linux__
+  // Unlike FreeBSD, Linux doesn't define a getdents() function, so we'll do that here.
+  using getdents64_t = int (*)(int, char *, unsigned int);
+  static auto getdents = static_cast<getdents64_t>([](int fd, char *buf, unsigned count) -> int { return syscall(SYS_getdents64, fd, buf, count); });
+  using dirent = dirent64;
+#endif
+#ifdef __APPLE__
+  // OS X defines a getdirentries64() kernel syscall which can emulate getdents
+  typedef int (*getdents_emulation_t)(int, char *, unsigned);
+  static getdents_emulation_t getdents = static_cast<getdents_emulation_t>([](int fd, char *buf, unsigned count) -> int {
+    off_t foo;
+    return syscall(SYS_getdirentries64, fd, buf, count, &foo);
+  });
+#endif
+  if(!tofill._kernel_buffer && kernelbuffer.empty())
+  {
+    // Let's assume the average leafname will be 64 characters long.
+    size_t toallocate = (sizeof(dirent) + 64) * tofill.size();
+    auto *mem = new(std::nothrow) char[toallocate];
+    if(mem == nullptr)
+    {
+      return std::errc::not_enough_memory;
+    }
+    tofill._kernel_buffer = std::unique_ptr<char[]>(mem);
+    tofill._kernel_buffer_size = toallocate;
+  }
+// Seek to where the previous call stopped
+#ifdef __linux__
+  if(-1 == ::lseek64(_v.fd, static_cast<off64_t>(cursor.position), SEEK_SET))
+  {
+    return {errno, std::system_category()};
+  }
+#else
+  if(-1 == ::lseek(_v.fd, static_cast<off_t>(cursor.position), SEEK_SET))
+    return {errno, std::system_category()};
+#endif
+  stat_t::want default_stat_contents = stat_t::want::ino | stat_t::want::type;
+  size_t n = 0, used = 0;
+  // Keep reading into the unused remainder of the kernel buffer until tofill is full
+  while(n < tofill.size())
+  {
+    char *buffer = kernelbuffer.empty() ? tofill._kernel_buffer.get() : kernelbuffer.data();
+    size_t bytesavailable = kernelbuffer.empty() ? tofill._kernel_buffer_size : kernelbuffer.size();
+    int bytes = getdents(_v.fd, buffer + used, static_cast<unsigned>(bytesavailable - used));
+    if(bytes == -1)
+    {
+      if(EINVAL != errno)
+      {
+        return {errno, std::system_category()};
+      }
+      // The next entry doesn't fit into what remains of the kernel buffer
+      if(n > 0)
+      {
+        break;
+      }
+      if(used > 0)
+      {
+        // Nothing returned refers to the kernel buffer, so start it again
+        used = 0;
+        continue;
+      }
+      if(!kernelbuffer.empty())
+      {
+        return {EINVAL, std::system_category()};
+      }
+      tofill._kernel_buffer.reset();
+      size_t toallocate = tofill._kernel_buffer_size * 2;
+      auto *mem = new(std::nothrow) char[toallocate];
+      if(mem == nullptr)
+      {
+        return std::errc::not_enough_memory;
+      }
+      tofill._kernel_buffer = std::unique_ptr<char[]>(mem);
+      tofill._kernel_buffer_size = toallocate;
+      continue;
+    }
+    if(bytes == 0)
+    {
+      cursor.done = true;
+      break;
+    }
+    AFIO_VALGRIND_MAKE_MEM_DEFINED_IF_ADDRESSABLE(buffer + used, bytes);  // NOLINT
+    auto *dent = reinterpret_cast<dirent *>(buffer + used);
+    used += bytes;
+    for(; bytes > 0 && n < tofill.size(); bytes -= dent->d_reclen, dent = reinterpret_cast<dirent *>(reinterpret_cast<uintptr_t>(dent) + dent->d_reclen))
+    {
+      cursor.position = dirent_offset(dent);
+      if(dent->d_ino == 0u)
+      {
+        continue;
+      }
+      size_t length = strchr(dent->d_name, 0) - dent->d_name;
+      if(length <= 2 && '.' == dent->d_name[0] && (1 == length || '.' == dent->d_name[1]))
+      {
+        continue;
+      }
+      if(!glob.matches(dent->d_name, length))
+      {
+        continue;
+      }
+      directory_entry &item = tofill[n];
+      item.leafname = path_view(dent->d_name, length);
+      item.stat = stat_t(nullptr);
+      item.stat.st_ino = dent->d_ino;
+      if(!dirent_type(dent->d_type, item.stat.st_type))
+      {
+        // Don't say we return type
+        default_stat_contents = default_stat_contents & ~stat_t::want::type;
+      }
+      n++;
+    }
+  }
+  tofill._resize(n);
+  return enumerate_info{std::move(tofill), default_stat_contents, cursor.done, cursor.version};
+}
+
+result<directory_handle::version_token> directory_handle::version() const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  version_token ret;
+  // Read the clock first, as a change after it could land in the same tick as the times read
+  auto now = std::chrono::system_clock::now();
+  OUTCOME_TRYV(directory_times(_v.fd, ret.mtim, ret.ctim));
+  ret.stable = now - std::max(ret.mtim, ret.ctim) >= std::chrono::seconds(2);
+  return ret;
+}
+
+result<bool> directory_handle::unchanged_since(const version_token &token) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!token.stable)
+  {
+    return false;
+  }
+  std::chrono::system_clock::time_point mtim, ctim;
+  OUTCOME_TRYV(directory_times(_v.fd, mtim, ctim));
+  return mtim == token.mtim && ctim == token.ctim;
+}
+
+result<stat_t::want> directory_handle::fill_stat(span<buffer_type> entries, stat_t::want wanted, bool sync) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  stat_t::want ret = wanted;
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+  // Ask only for what is wanted, which saves work on network and fuse filing systems
+  unsigned mask = 0;
+  mask |= (wanted & stat_t::want::type) ? STATX_TYPE : 0;
+  mask |= (wanted & stat_t::want::perms) ? STATX_MODE : 0;
+  mask |= (wanted & stat_t::want::nlink) ? STATX_NLINK : 0;
+  mask |= (wanted & stat_t::want::uid) ? STATX_UID : 0;
+  mask |= (wanted & stat_t::want::gid) ? STATX_GID : 0;
+  mask |= (wanted & stat_t::want::atim) ? STATX_ATIME : 0;
+  mask |= (wanted & stat_t::want::mtim) ? STATX_MTIME : 0;
+  mask |= (wanted & stat_t::want::ctim) ? STATX_CTIME : 0;
+  mask |= (wanted & stat_t::want::ino) ? STATX_INO : 0;
+  mask |= (wanted & (stat_t::want::size | stat_t::want::sparse)) ? STATX_SIZE : 0;
+  mask |= (wanted & (stat_t::want::allocated | stat_t::want::blocks | stat_t::want::sparse)) ? STATX_BLOCKS : 0;
+  mask |= (wanted & stat_t::want::birthtim) ? STATX_BTIME : 0;
+  const int flags = AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | (sync ? AT_STATX_SYNC_AS_STAT : AT_STATX_DONT_SYNC);
+  auto statx_timepoint = [](const struct statx_timestamp &ts) {
+    struct timespec t
+    {
+    };
+    t.tv_sec = ts.tv_sec;
+    t.tv_nsec = ts.tv_nsec;
+    return to_timepoint(t);
+  };
+  bool have_statx = true;
+#else
+  (void) sync;
+#endif
+  for(buffer_type &entry : entries)
+  {
+    path_view::c_str zpath(entry.leafname);
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+    if(have_statx)
+    {
+      struct statx s
+      {
+      };
+      if(-1 == ::statx(_v.fd, zpath.buffer, flags, mask, &s))
+      {
+        if(ENOENT == errno)
+        {
+          entry.stat.st_type = filesystem::file_type::not_found;
+          continue;
+        }
+        if(ENOSYS != errno)
+        {
+          return {errno, std::system_category()};
+        }
+        // Kernels before 4.11 don't have statx
+        have_statx = false;
+      }
+      else
+      {
+        stat_t::want filled = stat_t::want::dev | stat_t::want::rdev | stat_t::want::blksize;
+        entry.stat.st_dev = makedev(s.stx_dev_major, s.stx_dev_minor);
+        entry.stat.st_rdev = makedev(s.stx_rdev_major, s.stx_rdev_minor);
+        entry.stat.st_blksize = s.stx_blksize;
+        if(s.stx_mask & STATX_TYPE)
+        {
+          entry.stat.st_type = to_st_type(s.stx_mode);
+          filled |= stat_t::want::type;
+        }
+        if(s.stx_mask & STATX_MODE)
+        {
+          entry.stat.st_perms = s.stx_mode & 0xfff;
+          filled |= stat_t::want::perms;
+        }
+        if(s.stx_mask & STATX_NLINK)
+        {
+          entry.stat.st_nlink = s.stx_nlink;
+          filled |= stat_t::want::nlink;
+        }
+        if(s.stx_mask & STATX_UID)
+        {
+          entry.stat.st_uid = s.stx_uid;
+          filled |= stat_t::want::uid;
+        }
+        if(s.stx_mask & STATX_GID)
+        {
+          entry.stat.st_gid = s.stx_gid;
+          filled |= stat_t::want::gid;
+        }
+        if(s.stx_mask & STATX_ATIME)
+        {
+          entry.stat.st_atim = statx_timepoint(s.stx_atime);
+          filled |= stat_t::want::atim;
+        }
+        if(s.stx_mask & STATX_MTIME)
+        {
+          entry.stat.st_mtim = statx_timepoint(s.stx_mtime);
+          filled |= stat_t::want::mtim;
+        }
+        if(s.stx_mask & STATX_CTIME)
+        {
+          entry.stat.st_ctim = statx_timepoint(s.stx_ctime);
+          filled |= stat_t::want::ctim;
+        }
+        if(s.stx_mask & STATX_INO)
+        {
+          entry.stat.st_ino = s.stx_ino;
+          filled |= stat_t::want::ino;
+        }
+        if(s.stx_mask & STATX_SIZE)
+        {
+          entry.stat.st_size = s.stx_size;
+          filled |= stat_t::want::size;
+        }
+        if(s.stx_mask & STATX_BLOCKS)
+        {
+          entry.stat.st_allocated = static_cast<handle::extent_type>(s.stx_blocks) * 512;
+          entry.stat.st_blocks = s.stx_blocks;
+          filled |= stat_t::want::allocated | stat_t::want::blocks;
+        }
+        if((s.stx_mask & (STATX_SIZE | STATX_BLOCKS)) == (STATX_SIZE | STATX_BLOCKS))
+        {
+          entry.stat.st_sparse = static_cast<unsigned int>((static_cast<handle::extent_type>(s.stx_blocks) * 512) < static_cast<handle::extent_type>(s.stx_size));
+          filled |= stat_t::want::sparse;
+        }
+        if(s.stx_mask & STATX_BTIME)
+        {
+          entry.stat.st_birthtim = statx_timepoint(s.stx_btime);
+          filled |= stat_t::want::birthtim;
+        }
+        ret = ret & filled;
+        continue;
+      }
+    }
+#endif
+    struct stat s
+    {
+    };
+    if(-1 == ::fstatat(_v.fd, zpath.buffer, &s, AT_SYMLINK_NOFOLLOW))
+    {
+      if(ENOENT == errno)
+      {
+        entry.stat.st_type = filesystem::file_type::not_found;
+        continue;
+      }
+      return {errno, std::system_category()};
+    }
+    entry.stat.st_dev = s.st_dev;
+    entry.stat.st_ino = s.st_ino;
+    entry.stat.st_type = to_st_type(s.st_mode);
+    entry.stat.st_perms = s.st_mode & 0xfff;
+    entry.stat.st_nlink = s.st_nlink;
+    entry.stat.st_uid = s.st_uid;
+    entry.stat.st_gid = s.st_gid;
+    entry.stat.st_rdev = s.st_rdev;
+#ifdef __ANDROID__
+    entry.stat.st_atim = to_timepoint(*((struct timespec *) &s.st_atime));
+    entry.stat.st_mtim = to_timepoint(*((struct timespec *) &s.st_mtime));
+    entry.stat.st_ctim = to_timepoint(*((struct timespec *) &s.st_ctime));
+#elif defined(__APPLE__)
+    entry.stat.st_atim = to_timepoint(s.st_atimespec);
+    entry.stat.st_mtim = to_timepoint(s.st_mtimespec);
+    entry.stat.st_ctim = to_timepoint(s.st_ctimespec);
+#else  // Linux and BSD
+    entry.stat.st_atim = to_timepoint(s.st_atim);
+    entry.stat.st_mtim = to_timepoint(s.st_mtim);
+    entry.stat.st_ctim = to_timepoint(s.st_ctim);
+#endif
+    entry.stat.st_size = s.st_size;
+    entry.stat.st_allocated = static_cast<handle::extent_type>(s.st_blocks) * 512;
+    entry.stat.st_blocks = s.st_blocks;
+    entry.stat.st_blksize = s.st_blksize;
+#ifdef HAVE_STAT_FLAGS
+    entry.stat.st_flags = s.st_flags;
+#endif
+#ifdef HAVE_STAT_GEN
+    entry.stat.st_gen = s.st_gen;
+#endif
+#ifdef HAVE_BIRTHTIMESPEC
+#if defined(__APPLE__)
+    entry.stat.st_birthtim = to_timepoint(s.st_birthtimespec);
+#else
+    entry.stat.st_birthtim = to_timepoint(s.st_birthtim);
+#endif
+#endif
+    entry.stat.st_sparse = static_cast<unsigned int>((static_cast<handle::extent_type>(s.st_blocks) * 512) < static_cast<handle::extent_type>(s.st_size));
+    ret = ret & (stat_t::want::dev | stat_t::want::ino | stat_t::want::type | stat_t::want::perms | stat_t::want::nlink | stat_t::want::uid | stat_t::want::gid | stat_t::want::rdev | stat_t::want::atim | stat_t::want::mtim | stat_t::want::ctim | stat_t::want::size | stat_t::want::allocated |
+                 stat_t::want::blocks | stat_t::want::blksize
+#ifdef HAVE_STAT_FLAGS
+                 | stat_t::want::flags
+#endif
+#ifdef HAVE_STAT_GEN
+                 | stat_t::want::gen
+#endif
+#ifdef HAVE_BIRTHTIMESPEC
+                 | stat_t::want::birthtim
+#endif
+                 | stat_t::want::sparse);
+  }
+  return ret;
+}
+
+size_t directory_handle::mutate(span<mutation> mutations, bool stop_on_failure) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  size_t succeeded = 0;
+  bool failed = false;
+  for(mutation &m : mutations)
+  {
+    if(failed && stop_on_failure)
+    {
+      m.status = error_info(std::errc::operation_canceled);
+      continue;
+    }
+    path_view::c_str zpath(m.leafname);
+    m.status = success();
+    switch(m.op)
+    {
+    case mutation::operation::create_file:
+    {
+      int fd = ::openat(_v.fd, zpath.buffer, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0x1b0 /*660*/);
+      if(-1 == fd)
+      {
+        m.status = error_info(errno, std::system_category());
+      }
+      else
+      {
+        ::close(fd);
+      }
+      break;
+    }
+    case mutation::operation::create_directory:
+      if(-1 == ::mkdirat(_v.fd, zpath.buffer, 0x1f8 /*770*/))
+      {
+        m.status = error_info(errno, std::system_category());
+      }
+      break;
+    case mutation::operation::unlink_file:
+    case mutation::operation::unlink_directory:
+      if(-1 == ::unlinkat(_v.fd, zpath.buffer, (m.op == mutation::operation::unlink_directory) ? AT_REMOVEDIR : 0))
+      {
+        m.status = error_info(errno, std::system_category());
+      }
+      break;
+    case mutation::operation::relink:
+    {
+      path_view::c_str znewpath(m.newpath);
+      m.status = relink_entry(_v.fd, zpath.buffer, *this, znewpath.buffer, m.atomic_replace);
+      break;
+    }
+    }
+    if(m.status)
+    {
+      ++succeeded;
+    }
+    else
+    {
+      failed = true;
     }
   }
+  return succeeded;
 }
 
 AFIO_V2_NAMESPACE_END
@@ -0,0 +1,540 @@
+/* Watches directories for changes
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../../directory_watcher.hpp"
+#include "import.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include <algorithm>
+#include <climits>  // for NAME_MAX
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+AFIO_V2_NAMESPACE_BEGIN
+
+#ifdef __linux__
+static inline uint32_t to_inotify_mask(directory_watcher::event events) noexcept
+{
+  uint32_t mask = 0;
+  if(events & directory_watcher::event::created)
+  {
+    mask |= IN_CREATE;
+  }
+  if(events & directory_watcher::event::deleted)
+  {
+    mask |= IN_DELETE;
+  }
+  if(events & directory_watcher::event::modified)
+  {
+    mask |= IN_MODIFY;
+  }
+  if(events & directory_watcher::event::metadata)
+  {
+    mask |= IN_ATTRIB;
+  }
+  if(events & directory_watcher::event::moved_from)
+  {
+    mask |= IN_MOVED_FROM;
+  }
+  if(events & directory_watcher::event::moved_to)
+  {
+    mask |= IN_MOVED_TO;
+  }
+  if(events & directory_watcher::event::closed_write)
+  {
+    mask |= IN_CLOSE_WRITE;
+  }
+  if(events & directory_watcher::event::self_deleted)
+  {
+    mask |= IN_DELETE_SELF;
+  }
+  if(events & directory_watcher::event::self_moved)
+  {
+    mask |= IN_MOVE_SELF;
+  }
+  return mask;
+}
+
+static inline directory_watcher::event from_inotify_mask(uint32_t mask) noexcept
+{
+  directory_watcher::event events = directory_watcher::event::none;
+  if(mask & IN_CREATE)
+  {
+    events |= directory_watcher::event::created;
+  }
+  if(mask & IN_DELETE)
+  {
+    events |= directory_watcher::event::deleted;
+  }
+  if(mask & IN_MODIFY)
+  {
+    events |= directory_watcher::event::modified;
+  }
+  if(mask & IN_ATTRIB)
+  {
+    events |= directory_watcher::event::metadata;
+  }
+  if(mask & IN_MOVED_FROM)
+  {
+    events |= directory_watcher::event::moved_from;
+  }
+  if(mask & IN_MOVED_TO)
+  {
+    events |= directory_watcher::event::moved_to;
+  }
+  if(mask & IN_CLOSE_WRITE)
+  {
+    events |= directory_watcher::event::closed_write;
+  }
+  if(mask & IN_DELETE_SELF)
+  {
+    events |= directory_watcher::event::self_deleted;
+  }
+  if(mask & IN_MOVE_SELF)
+  {
+    events |= directory_watcher::event::self_moved;
+  }
+  if(mask & IN_ISDIR)
+  {
+    events |= directory_watcher::event::directory;
+  }
+  return events;
+}
+
+struct directory_watcher::_state
+{
+  directory_watcher *owner{nullptr};
+  async_file_handle h;     // the inotify fd
+  filesystem::path root;   // absolute path of the watched directory
+  uint32_t mask{0};        // inotify mask of every watch
+  event events{event::none};
+  bool tree{false};
+  // Path relative to root of the directory of each watch descriptor. Records view these, so
+  // when a watch goes away its path is retired until the start of the next batch.
+  std::unordered_map<int, std::unique_ptr<path_type>> watches;
+  std::vector<std::unique_ptr<path_type>> retired;
+  std::unique_ptr<char[]> buffer;
+  size_t buffer_size{0};
+  std::vector<record> records;
+  io_handle::buffer_type reqbuffer;
+  // Reads alternate between two states, so a completion can schedule the next read without destroying its own
+  async_file_handle::io_state_ptr io[2];
+  size_t slot{0};
+  bool pending{false};
+  bool closing{false};
+  completion_type completion;
+
+  // Adds a watch to the directory at rel, and in tree mode to every directory beneath it
+  result<void> add(const path_type &rel) noexcept
+  {
+    try
+    {
+      std::vector<directory_entry> entries(64);
+      std::vector<char> kernelbuffer;
+      std::vector<path_type> todo{rel};
+      while(!todo.empty())
+      {
+        path_type dir(std::move(todo.back()));
+        todo.pop_back();
+        path_type path(dir.empty() ? root : root / dir);
+        int wd = ::inotify_add_watch(h.native_handle().fd, path.c_str(), dir.empty() ? mask : (mask | IN_DONT_FOLLOW));
+        if(wd < 0)
+        {
+          // Directories within the tree may vanish, or be replaced with non-directories, at any time
+          if(!dir.empty() && (ENOENT == errno || ENOTDIR == errno))
+          {
+            continue;
+          }
+          return {errno, std::system_category()};
+        }
+        auto &watch = watches[wd];
+        if(watch)
+        {
+          retired.push_back(std::move(watch));
+        }
+        watch = std::make_unique<path_type>(dir);
+        if(!tree)
+        {
+          continue;
+        }
+        auto _dh = directory_handle::directory({}, path);
+        if(!_dh)
+        {
+          if(!dir.empty() && (_dh.error() == std::errc::no_such_file_or_directory || _dh.error() == std::errc::not_a_directory))
+          {
+            continue;
+          }
+          return std::move(_dh).error();
+        }
+        directory_handle &dh = _dh.value();
+        if(kernelbuffer.empty())
+        {
+          kernelbuffer.resize(entries.size() * 128);
+        }
+        directory_handle::enumerate_cursor cursor;
+        while(!cursor.done)
+        {
+          OUTCOME_TRY(info, dh.enumerate(cursor, span<directory_entry>(entries), {}, directory_handle::filter::fastdeleted, span<char>(kernelbuffer)));
+          if(!(info.metadata & stat_t::want::type))
+          {
+            OUTCOME_TRYV(dh.fill_stat(info.filled, stat_t::want::type));
+          }
+          for(directory_entry &entry : info.filled)
+          {
+            if(entry.stat.st_type == filesystem::file_type::directory)
+            {
+              todo.push_back(dir.empty() ? entry.leafname.path() : dir / entry.leafname.path());
+            }
+          }
+        }
+      }
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  // Removes the watches of the directory at rel and of every directory beneath it
+  void remove_below(const path_type &rel) noexcept
+  {
+    const auto &native = rel.native();
+    for(auto it = watches.begin(); it != watches.end();)
+    {
+      const auto &other = it->second->native();
+      if(other.compare(0, native.size(), native) == 0 && (other.size() == native.size() || other[native.size()] == '/'))
+      {
+        ::inotify_rm_watch(h.native_handle().fd, it->first);
+        retired.push_back(std::move(it->second));
+        it = watches.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  // Turns the inotify events read into the buffer into records
+  result<records_type> parse(size_t bytes) noexcept
+  {
+    try
+    {
+      retired.clear();
+      records.clear();
+      for(size_t offset = 0; offset < bytes;)
+      {
+        const auto *e = reinterpret_cast<const struct inotify_event *>(buffer.get() + offset);
+        offset += sizeof(struct inotify_event) + e->len;
+        if(e->mask & IN_Q_OVERFLOW)
+        {
+          records.push_back(record{path_view_type(), path_view_type(), event::overflow, 0});
+          continue;
+        }
+        auto it = watches.find(e->wd);
+        if(it == watches.end())
+        {
+          // An event queued before its watch was removed
+          continue;
+        }
+        const path_type *dir = it->second.get();
+        path_view_type leafname = (e->len > 0) ? path_view_type(e->name, strlen(e->name)) : path_view_type();
+        if(tree && e->len > 0 && (e->mask & IN_ISDIR))
+        {
+          path_type child(dir->empty() ? path_type(e->name) : *dir / e->name);
+          if(e->mask & (IN_CREATE | IN_MOVED_TO))
+          {
+            OUTCOME_TRYV(add(child));
+          }
+          else if(e->mask & IN_MOVED_FROM)
+          {
+            remove_below(child);
+          }
+        }
+        event reported = from_inotify_mask(e->mask) & (events | event::directory);
+        if(reported & events)
+        {
+          records.push_back(record{path_view_type(*dir), leafname, reported, e->cookie});
+        }
+        if(e->mask & IN_IGNORED)
+        {
+          // The watch was removed, usually because its directory was deleted
+          it = watches.find(e->wd);
+          if(it != watches.end())
+          {
+            retired.push_back(std::move(it->second));
+            watches.erase(it);
+          }
+        }
+      }
+      return records_type(records);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  void cancel() noexcept
+  {
+    closing = true;
+    if(pending)
+    {
+      // A blocked read cannot be cancelled, but removing the watches queues the events which complete it
+      for(auto &i : watches)
+      {
+        ::inotify_rm_watch(h.native_handle().fd, i.first);
+      }
+    }
+    // Destroying a read in progress pumps the io_service until it completes
+    io[0].reset();
+    io[1].reset();
+  }
+};
+
+directory_watcher::directory_watcher(std::unique_ptr<_state> s) noexcept : _s(std::move(s))
+{
+  _s->owner = this;
+}
+
+directory_watcher::directory_watcher() noexcept {}  // NOLINT
+
+directory_watcher::directory_watcher(directory_watcher &&o) noexcept : _s(std::move(o._s))
+{
+  if(_s)
+  {
+    _s->owner = this;
+  }
+}
+
+directory_watcher::~directory_watcher()
+{
+  if(_s)
+  {
+    _s->cancel();
+  }
+}
+
+result<directory_watcher> directory_watcher::watch(io_service &service, const path_handle &base, directory_watcher::path_view_type path, directory_watcher::event events, bool tree, size_t buffer) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(0);
+  try
+  {
+    auto s = std::make_unique<_state>();
+    {
+      OUTCOME_TRY(dh, directory_handle::directory(base, path));
+      OUTCOME_TRY(root, dh.current_path());
+      s->root = std::move(root);
+    }
+    int fd = ::inotify_init1(IN_CLOEXEC);
+    if(fd < 0)
+    {
+      return {errno, std::system_category()};
+    }
+    // The read of an inotify fd never seeks, so POSIX AIO reads it exactly like a pipe
+    s->h = async_file_handle(&service, native_handle_type(native_handle_type::disposition::readable | native_handle_type::disposition::overlapped, fd), 0, 0, async_file_handle::caching::all);
+    s->events = events;
+    s->tree = tree;
+    s->mask = IN_ONLYDIR | IN_EXCL_UNLINK | to_inotify_mask(events);
+    if(tree)
+    {
+      // New directories must be seen to be watched, and directories moved away to be unwatched
+      s->mask |= IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO;
+    }
+    // A read fails unless at least one event of the longest leafname fits
+    s->buffer_size = std::max(buffer, sizeof(struct inotify_event) + NAME_MAX + 1);
+    s->buffer = std::make_unique<char[]>(s->buffer_size);
+    s->records.reserve(s->buffer_size / sizeof(struct inotify_event) + 1);
+    OUTCOME_TRYV(s->add(path_type()));
+    return directory_watcher(std::move(s));
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+io_service *directory_watcher::service() const noexcept
+{
+  return _s ? _s->h.service() : nullptr;
+}
+
+size_t directory_watcher::watches() const noexcept
+{
+  return _s ? _s->watches.size() : 0;
+}
+
+result<void> directory_watcher::close() noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(_s)
+  {
+    _s->cancel();
+    OUTCOME_TRYV(_s->h.close());
+    _s.reset();
+  }
+  return success();
+}
+
+result<directory_watcher::records_type> directory_watcher::read(deadline d) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!_s)
+  {
+    return std::errc::bad_file_descriptor;
+  }
+  if(_s->pending)
+  {
+    return std::errc::device_or_resource_busy;
+  }
+  if(_s->watches.empty())
+  {
+    return std::errc::no_such_file_or_directory;
+  }
+  std::chrono::steady_clock::time_point began_steady;
+  std::chrono::system_clock::time_point end_utc;
+  if(d)
+  {
+    if(d.steady)
+    {
+      began_steady = std::chrono::steady_clock::now();
+    }
+    else
+    {
+      end_utc = d.to_time_point();
+    }
+  }
+  for(;;)
+  {
+    OUTCOME_TRY(readable, poll_for_readable(_s->h.native_handle().fd, d, began_steady, end_utc));
+    if(!readable)
+    {
+      return std::errc::timed_out;
+    }
+    ssize_t bytes = ::read(_s->h.native_handle().fd, _s->buffer.get(), _s->buffer_size);
+    if(bytes >= 0)
+    {
+      return _s->parse(static_cast<size_t>(bytes));
+    }
+    if(EINTR != errno)
+    {
+      return {errno, std::system_category()};
+    }
+  }
+}
+
+result<void> directory_watcher::_async_read(completion_type &&completion) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!_s)
+  {
+    return std::errc::bad_file_descriptor;
+  }
+  _state *s = _s.get();
+  if(s->pending)
+  {
+    return std::errc::device_or_resource_busy;
+  }
+  if(s->watches.empty())
+  {
+    return std::errc::no_such_file_or_directory;
+  }
+  s->completion = std::move(completion);
+  // If called from within the completion of the previous read, its state is in the other slot
+  const size_t slot = (s->slot ^= 1);
+  s->io[slot].reset();
+  // The length of the buffer is overwritten with the bytes read
+  s->reqbuffer = {s->buffer.get(), s->buffer_size};
+  s->pending = true;
+  auto r = s->h.async_read({{&s->reqbuffer, 1}, 0}, [s](async_file_handle * /*unused*/, async_file_handle::io_result<async_file_handle::buffers_type> &result) {
+    s->pending = false;
+    if(s->closing)
+    {
+      return;
+    }
+    completion_type c(std::move(s->completion));
+    if(!result)
+    {
+      c(s->owner, result.error());
+      return;
+    }
+    c(s->owner, s->parse(result.value()[0].len));
+  });
+  if(!r)
+  {
+    s->pending = false;
+    s->completion = completion_type();
+    return std::move(r).error();
+  }
+  s->io[slot] = std::move(r).value();
+  return success();
+}
+#else
+struct directory_watcher::_state
+{
+};
+
+directory_watcher::directory_watcher(std::unique_ptr<_state> s) noexcept : _s(std::move(s)) {}
+directory_watcher::directory_watcher() noexcept {}  // NOLINT
+directory_watcher::directory_watcher(directory_watcher &&o) noexcept : _s(std::move(o._s)) {}
+directory_watcher::~directory_watcher() = default;
+
+result<directory_watcher> directory_watcher::watch(io_service & /*unused*/, const path_handle & /*unused*/, directory_watcher::path_view_type /*unused*/, directory_watcher::event /*unused*/, bool /*unused*/, size_t /*unused*/) noexcept
+{
+  return std::errc::not_supported;
+}
+
+io_service *directory_watcher::service() const noexcept
+{
+  return nullptr;
+}
+
+size_t directory_watcher::watches() const noexcept
+{
+  return 0;
+}
+
+result<void> directory_watcher::close() noexcept
+{
+  _s.reset();
+  return success();
+}
+
+result<directory_watcher::records_type> directory_watcher::read(deadline /*unused*/) noexcept
+{
+  return std::errc::not_supported;
+}
+
+result<void> directory_watcher::_async_read(completion_type && /*unused*/) noexcept
+{
+  return std::errc::not_supported;
+}
+#endif
+
+AFIO_V2_NAMESPACE_END
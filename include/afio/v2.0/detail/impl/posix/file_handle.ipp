@@ -26,6 +26,10 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "import.hpp"
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
 AFIO_V2_NAMESPACE_BEGIN
 
 result<file_handle> file_handle::file(const path_handle &base, file_handle::path_view_type path, file_handle::mode _mode, file_handle::creation _creation, file_handle::caching _caching, file_handle::flag flags) noexcept
@@ -148,7 +152,7 @@ file_handle::io_result<file_handle::const_buffers_type> file_handle::barrier(fil
     return std::errc::not_supported;
   }
 #ifdef __linux__
-  if(!wait_for_device && !and_metadata)
+  if(!and_metadata)
   {
     // Linux has a lovely dedicated syscall giving us exactly what we need here
     extent_type offset = reqs.offset, bytes = 0;
@@ -157,10 +161,20 @@ file_handle::io_result<file_handle::const_buffers_type> file_handle::barrier(fil
     {
       bytes += req.len;
     }
-    unsigned flags = SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE;  // start writing all dirty pages in range now
-    if(-1 != ::sync_file_range(_v.fd, offset, bytes, flags))
+    if(!wait_for_device)
     {
-      return {reqs.buffers};
+      unsigned flags = SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE;  // start writing all dirty pages in range now
+      if(-1 != ::sync_file_range(_v.fd, offset, bytes, flags))
+      {
+        return {reqs.buffers};
+      }
+    }
+    else if(bytes != 0)
+    {
+      // Write back only the dirty pages in the range and wait for them, so the fdatasync() below
+      // has little left to do beyond any file size change and telling the device to flush its cache.
+      unsigned flags = SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER;
+      (void) ::sync_file_range(_v.fd, offset, bytes, flags);
     }
   }
 #endif
@@ -490,4 +504,179 @@ result<file_handle::extent_type> file_handle::zero(file_handle::extent_type offs
   }
 }
 
+result<file_handle::extent_type> file_handle::send_to(native_handle_type dest, file_handle::extent_type offset, file_handle::extent_type bytes, deadline d) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!dest.is_valid())
+  {
+    return std::errc::bad_file_descriptor;
+  }
+  std::chrono::steady_clock::time_point began_steady;
+  std::chrono::system_clock::time_point end_utc;
+  if(d)
+  {
+    if(d.steady)
+    {
+      began_steady = std::chrono::steady_clock::now();
+    }
+    else
+    {
+      end_utc = d.to_time_point();
+    }
+  }
+  extent_type ret = 0;
+  auto timed_out = [&]() -> result<extent_type> {
+    if(ret > 0)
+    {
+      return ret;
+    }
+    return std::errc::timed_out;
+  };
+  // Neither a kernel transfer nor a blocking write can be interrupted, so the deadline is checked between them
+  auto expired = [&]() -> bool {
+    if(!d)
+    {
+      return false;
+    }
+    if(d.steady)
+    {
+      return std::chrono::steady_clock::now() >= began_steady + std::chrono::nanoseconds(d.nsecs);
+    }
+    return std::chrono::system_clock::now() >= end_utc;
+  };
+#ifdef __linux__
+  // sendfile() can write to any fd since Linux 2.6.33, and to pipes since 5.12. For pipes on older
+  // kernels splice() does the same job.
+  bool use_splice = false;
+  // splice() ignores O_NONBLOCK on the destination
+  int fdflags = ::fcntl(dest.fd, F_GETFL);
+  unsigned spliceflags = SPLICE_F_MOVE | ((fdflags != -1 && (fdflags & O_NONBLOCK)) ? SPLICE_F_NONBLOCK : 0);
+  while(bytes > 0)
+  {
+    // Linux transfers at most 0x7ffff000 bytes per call
+    size_t tosend = (bytes < 0x7ffff000) ? static_cast<size_t>(bytes) : 0x7ffff000;
+    ssize_t sent;
+    if(!use_splice)
+    {
+      off_t off = offset;
+      sent = ::sendfile(dest.fd, _v.fd, &off, tosend);
+    }
+    else
+    {
+      loff_t off = offset;
+      sent = ::splice(_v.fd, &off, dest.fd, nullptr, tosend, spliceflags);
+    }
+    if(sent < 0)
+    {
+      if(EINTR == errno)
+      {
+        continue;
+      }
+      if(EAGAIN == errno || EWOULDBLOCK == errno)
+      {
+        OUTCOME_TRY(writable, poll_for_writable(dest.fd, d, began_steady, end_utc));
+        if(!writable)
+        {
+          return timed_out();
+        }
+        continue;
+      }
+      if((EINVAL == errno || ENOSYS == errno) && !use_splice && ret == 0)
+      {
+        use_splice = true;
+        continue;
+      }
+      if(EINVAL == errno && ret == 0)
+      {
+        // Neither kernel path is available for this combination of fds, so emulate
+        break;
+      }
+      return {errno, std::system_category()};
+    }
+    if(sent == 0)
+    {
+      // End of file
+      return ret;
+    }
+    offset += sent;
+    bytes -= sent;
+    ret += sent;
+    if(bytes > 0 && expired())
+    {
+      return ret;
+    }
+  }
+  if(bytes == 0)
+  {
+    return ret;
+  }
+#endif
+  // Emulate with a bounce buffer
+  try
+  {
+    auto blocksize = utils::file_buffer_default_size();
+    char *buffer = utils::page_allocator<char>().allocate(blocksize);
+    auto unbufferh = undoer([buffer, blocksize] { utils::page_allocator<char>().deallocate(buffer, blocksize); });
+    (void) unbufferh;
+    // Don't rely on short reads to find the end of the file
+    OUTCOME_TRY(length, this->length());
+    if(offset >= length)
+    {
+      return ret;
+    }
+    bytes = std::min(bytes, length - offset);
+    while(bytes > 0)
+    {
+      if(ret > 0 && expired())
+      {
+        return ret;
+      }
+      auto toread = (bytes < blocksize) ? static_cast<size_t>(bytes) : blocksize;
+      // Reads of regular files cannot take a deadline on POSIX, and do not block indefinitely anyway
+      OUTCOME_TRY(readed, read(offset, buffer, toread));
+      if(readed.len == 0)
+      {
+        break;
+      }
+      const char *p = readed.data;
+      size_t togo = readed.len;
+      while(togo > 0)
+      {
+        ssize_t sent = ::write(dest.fd, p, togo);
+        if(sent < 0)
+        {
+          if(EINTR == errno)
+          {
+            continue;
+          }
+          if(EAGAIN == errno || EWOULDBLOCK == errno)
+          {
+            OUTCOME_TRY(writable, poll_for_writable(dest.fd, d, began_steady, end_utc));
+            if(!writable)
+            {
+              return timed_out();
+            }
+            continue;
+          }
+          return {errno, std::system_category()};
+        }
+        p += sent;
+        togo -= sent;
+        offset += sent;
+        bytes -= sent;
+        ret += sent;
+      }
+      if(readed.len < toread)
+      {
+        break;
+      }
+    }
+    return ret;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
 AFIO_V2_NAMESPACE_END
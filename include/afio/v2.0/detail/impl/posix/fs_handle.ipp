@@ -40,6 +40,23 @@ result<void> fs_handle::_fetch_inode() noexcept
   return success();
 }
 
+// True if the entry leafname within the directory dirfd is the inode of fsh
+inline result<bool> is_entry_of(int dirfd, const char *leafname, const fs_handle &fsh) noexcept
+{
+  struct stat s
+  {
+  };
+  if(-1 == ::fstatat(dirfd, leafname, &s, AT_SYMLINK_NOFOLLOW))
+  {
+    if(ENOENT == errno)
+    {
+      return false;
+    }
+    return {errno, std::system_category()};
+  }
+  return static_cast<fs_handle::dev_t>(s.st_dev) == fsh.st_dev() && s.st_ino == fsh.st_ino();
+}
+
 inline result<path_handle> containing_directory(optional<std::reference_wrapper<filesystem::path>> out_filename, const handle &h, const fs_handle &fsh, deadline d) noexcept
 {
   std::chrono::steady_clock::time_point began_steady;
@@ -86,28 +103,11 @@ inline result<path_handle> containing_directory(optional<std::reference_wrapper<
         }
         return success(std::move(currentdirh));
       }
-      // Open the same file name, and compare dev and inode
+      // Look up the same file name without opening it, and compare dev and inode
       path_view::c_str zpath(filename);
-      int fd = ::openat(currentdirh.native_handle().fd, zpath.buffer, O_CLOEXEC);
-      if(fd == -1)
-      {
-        if(ENOENT == errno)
-        {
-          continue;
-        }
-        return {errno, std::system_category()};
-      }
-      auto unfd = undoer([fd] { ::close(fd); });
-      (void) unfd;
-      struct stat s
-      {
-      };
-      if(-1 == ::fstat(fd, &s))
-      {
-        continue;
-      }
+      OUTCOME_TRY(same, is_entry_of(currentdirh.native_handle().fd, zpath.buffer, fsh));
       // If the same, we know for a fact that this is the correct containing dir for now at least
-      if(static_cast<fs_handle::dev_t>(s.st_dev) == fsh.st_dev() && s.st_ino == fsh.st_ino())
+      if(same)
       {
         if(out_filename)
         {
@@ -148,6 +148,31 @@ result<path_handle> fs_handle::parent_path_handle(deadline d) const noexcept
   return containing_directory({}, h, *this, d);
 }
 
+// Renames the entry leafname within the directory dirfd to path relative to base
+inline result<void> relink_entry(int dirfd, const char *leafname, const path_handle &base, const char *path, bool atomic_replace) noexcept
+{
+  if(!atomic_replace)
+  {
+// Some systems provide an extension for atomic non-replacing renames
+#ifdef RENAME_NOREPLACE
+    if(-1 != ::renameat2(dirfd, leafname, base.is_valid() ? base.native_handle().fd : AT_FDCWD, path, RENAME_NOREPLACE))
+      return success();
+    if(EEXIST == errno)
+      return {errno, std::system_category()};
+#endif
+    // Otherwise we need to use linkat followed by renameat (non-atomic)
+    if(-1 == ::linkat(dirfd, leafname, base.is_valid() ? base.native_handle().fd : AT_FDCWD, path, 0))
+    {
+      return { errno, std::system_category() };
+    }
+  }
+  if(-1 == ::renameat(dirfd, leafname, base.is_valid() ? base.native_handle().fd : AT_FDCWD, path))
+  {
+    return { errno, std::system_category() };
+  }
+  return success();
+}
+
 result<void> fs_handle::relink(const path_handle &base, path_view_type path, bool atomic_replace, deadline d) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
@@ -174,26 +199,7 @@ result<void> fs_handle::relink(const path_handle &base, path_view_type path, boo
   // Open our containing directory
   filesystem::path filename;
   OUTCOME_TRY(dirh, containing_directory(std::ref(filename), h, *this, d));
-  if(!atomic_replace)
-  {
-// Some systems provide an extension for atomic non-replacing renames
-#ifdef RENAME_NOREPLACE
-    if(-1 != ::renameat2(dirh.native_handle().fd, filename.c_str(), base.is_valid() ? base.native_handle().fd : AT_FDCWD, zpath.buffer, RENAME_NOREPLACE))
-      return success();
-    if(EEXIST == errno)
-      return {errno, std::system_category()};
-#endif
-    // Otherwise we need to use linkat followed by renameat (non-atomic)
-    if(-1 == ::linkat(dirh.native_handle().fd, filename.c_str(), base.is_valid() ? base.native_handle().fd : AT_FDCWD, zpath.buffer, 0))
-    {
-      return { errno, std::system_category() };
-    }
-  }
-  if(-1 == ::renameat(dirh.native_handle().fd, filename.c_str(), base.is_valid() ? base.native_handle().fd : AT_FDCWD, zpath.buffer))
-  {
-    return { errno, std::system_category() };
-  }
-  return success();
+  return relink_entry(dirh.native_handle().fd, filename.c_str(), base, zpath.buffer, atomic_replace);
 }
 
 result<void> fs_handle::unlink(deadline d) noexcept
@@ -210,4 +216,95 @@ result<void> fs_handle::unlink(deadline d) noexcept
   return success();
 }
 
+result<void> fs_handle::exchange(fs_handle &o, deadline d) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+#ifdef RENAME_EXCHANGE
+  // Open both containing directories
+  filesystem::path filename, ofilename;
+  OUTCOME_TRY(dirh, containing_directory(std::ref(filename), _get_handle(), *this, d));
+  OUTCOME_TRY(odirh, containing_directory(std::ref(ofilename), o._get_handle(), o, d));
+  if(-1 == ::renameat2(dirh.native_handle().fd, filename.c_str(), odirh.native_handle().fd, ofilename.c_str(), RENAME_EXCHANGE))
+  {
+    return {errno, std::system_category()};
+  }
+  return success();
+#else
+  (void) o;
+  (void) d;
+  return std::errc::not_supported;
+#endif
+}
+
+result<bool> fs_handle::_relink_entry(const handle &dirh, path_view_type leafname, const path_handle &base, path_view_type path, bool atomic_replace) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  auto &h = _get_handle();
+  if(h.flags() & handle::flag::anonymous_inode)
+  {
+    return false;
+  }
+  path_view::c_str zleafname(leafname);
+  if(!(h.flags() & handle::flag::disable_safety_unlinks))
+  {
+    OUTCOME_TRY(same, is_entry_of(dirh.native_handle().fd, zleafname.buffer, *this));
+    if(!same)
+    {
+      return false;
+    }
+  }
+  path_view::c_str zpath(path);
+  OUTCOME_TRYV(relink_entry(dirh.native_handle().fd, zleafname.buffer, base, zpath.buffer, atomic_replace));
+  return true;
+}
+
+result<bool> fs_handle::_unlink_entry(const handle &dirh, path_view_type leafname) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  auto &h = _get_handle();
+  path_view::c_str zleafname(leafname);
+  if(!(h.flags() & handle::flag::disable_safety_unlinks))
+  {
+    OUTCOME_TRY(same, is_entry_of(dirh.native_handle().fd, zleafname.buffer, *this));
+    if(!same)
+    {
+      return false;
+    }
+  }
+  if(-1 == ::unlinkat(dirh.native_handle().fd, zleafname.buffer, h.is_directory() ? AT_REMOVEDIR : 0))
+  {
+    return {errno, std::system_category()};
+  }
+  return true;
+}
+
+result<bool> fs_handle::_exchange_entries(const handle &dirh, path_view_type leafname, const fs_handle &o, const handle &odirh, path_view_type oleafname) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+#ifdef RENAME_EXCHANGE
+  path_view::c_str zleafname(leafname), zoleafname(oleafname);
+  if(!(_get_handle().flags() & handle::flag::disable_safety_unlinks))
+  {
+    OUTCOME_TRY(same, is_entry_of(dirh.native_handle().fd, zleafname.buffer, *this));
+    OUTCOME_TRY(osame, is_entry_of(odirh.native_handle().fd, zoleafname.buffer, o));
+    if(!same || !osame)
+    {
+      return false;
+    }
+  }
+  if(-1 == ::renameat2(dirh.native_handle().fd, zleafname.buffer, odirh.native_handle().fd, zoleafname.buffer, RENAME_EXCHANGE))
+  {
+    return {errno, std::system_category()};
+  }
+  return true;
+#else
+  (void) dirh;
+  (void) leafname;
+  (void) o;
+  (void) odirh;
+  (void) oleafname;
+  return std::errc::not_supported;
+#endif
+}
+
 AFIO_V2_NAMESPACE_END
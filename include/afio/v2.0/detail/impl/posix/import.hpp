@@ -32,6 +32,7 @@ Distributed under the Boost Software License, Version 1.0.
 #endif
 
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 
 AFIO_V2_NAMESPACE_BEGIN
@@ -111,6 +112,50 @@ inline result<int> attribs_from_handle_mode_caching_and_flags(native_handle_type
   return attribs;
 }
 
+/* Waits for a possibly non-blocking fd to become ready for the poll() events requested, returning false if the deadline expires first.
+began_steady and end_utc are whichever was set from the deadline at the start of the operation.
+*/
+inline result<bool> poll_for(int fd, short events, deadline d, std::chrono::steady_clock::time_point began_steady, std::chrono::system_clock::time_point end_utc) noexcept
+{
+  for(;;)
+  {
+    int timeout = -1;
+    if(d)
+    {
+      std::chrono::milliseconds ms;
+      if(d.steady)
+      {
+        ms = std::chrono::duration_cast<std::chrono::milliseconds>((began_steady + std::chrono::nanoseconds(d.nsecs)) - std::chrono::steady_clock::now());
+      }
+      else
+      {
+        ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_utc - std::chrono::system_clock::now());
+      }
+      timeout = (ms.count() < 0) ? 0 : static_cast<int>(ms.count());
+    }
+    pollfd pfd{};
+    pfd.fd = fd;
+    pfd.events = events;
+    int ret = ::poll(&pfd, 1, timeout);
+    if(ret > 0)
+    {
+      return true;
+    }
+    if(ret == 0)
+    {
+      return false;
+    }
+    if(EINTR != errno)
+    {
+      return {errno, std::system_category()};
+    }
+  }
+}
+//! Waits for a possibly non-blocking fd to become readable, as for `poll_for()`
+inline result<bool> poll_for_readable(int fd, deadline d, std::chrono::steady_clock::time_point began_steady, std::chrono::system_clock::time_point end_utc) noexcept { return poll_for(fd, POLLIN, d, began_steady, end_utc); }
+//! Waits for a possibly non-blocking fd to become writable, as for `poll_for()`
+inline result<bool> poll_for_writable(int fd, deadline d, std::chrono::steady_clock::time_point began_steady, std::chrono::system_clock::time_point end_utc) noexcept { return poll_for(fd, POLLOUT, d, began_steady, end_utc); }
+
 AFIO_V2_NAMESPACE_END
 
 #endif
@@ -107,7 +107,7 @@ io_handle::io_result<io_handle::buffers_type> io_handle::read(io_handle::io_requ
   }
   for(auto &buffer : reqs.buffers)
   {
-    if(buffer.len >= static_cast<size_t>(bytesread))
+    if(static_cast<size_t>(bytesread) >= buffer.len)
     {
       bytesread -= buffer.len;
     }
@@ -174,7 +174,7 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::write(io_handle::
   }
   for(auto &buffer : reqs.buffers)
   {
-    if(buffer.len >= static_cast<size_t>(byteswritten))
+    if(static_cast<size_t>(byteswritten) >= buffer.len)
     {
       byteswritten -= buffer.len;
     }
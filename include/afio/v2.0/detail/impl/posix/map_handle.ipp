@@ -24,11 +24,67 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../../map_handle.hpp"
 #include "../../../utils.hpp"
+#include "import.hpp"
 
 #include <sys/mman.h>
+#include <sys/resource.h>  // for getrusage
+#include <sys/uio.h>
+#ifdef __linux__
+#include <linux/magic.h>  // for HUGETLBFS_MAGIC
+#include <linux/userfaultfd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>  // for move_pages, userfaultfd
+#include <sys/vfs.h>      // for fstatfs
+#endif
+
+#ifdef __linux__
+// Older system headers lack these, which were added by Linux 4.14, 5.14 and 6.1
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC 0x958458f6
+#endif
+#ifndef MFD_HUGE_SHIFT
+#define MFD_HUGE_SHIFT 26
+#endif
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22
+#endif
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25
+#endif
+#endif
+
+#include <mutex>
+#include <thread>
 
 AFIO_V2_NAMESPACE_BEGIN
 
+// Returns the page size requested by the page_sizes_N bits of a section flag
+static inline result<size_t> page_size_from_flags(section_handle::flag _flag) noexcept
+{
+  unsigned idx = (static_cast<unsigned>(_flag) >> 24U) & 3U;
+  if(idx == 0)
+  {
+    return utils::page_size();
+  }
+  try
+  {
+    auto pagesizes(utils::page_sizes(false));
+    if(idx >= pagesizes.size())
+    {
+      return std::errc::invalid_argument;
+    }
+    return pagesizes[idx];
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
 section_handle::~section_handle()
 {
   if(_v)
@@ -57,6 +113,26 @@ result<void> section_handle::close() noexcept
 
 result<section_handle> section_handle::section(file_handle &backing, extent_type /* unused */, flag _flag) noexcept
 {
+  OUTCOME_TRY(pagesize, page_size_from_flags(_flag));
+  if(pagesize != utils::page_size())
+  {
+#ifdef __linux__
+    // Large pages for file backed sections require the file to live on a hugetlbfs of that page size
+    struct statfs s
+    {
+    };
+    if(-1 == ::fstatfs(backing.native_handle().fd, &s))
+    {
+      return {errno, std::system_category()};
+    }
+    if(s.f_type != HUGETLBFS_MAGIC || static_cast<size_t>(s.f_bsize) != pagesize)
+    {
+      return std::errc::invalid_argument;
+    }
+#else
+    return std::errc::not_supported;
+#endif
+  }
   result<section_handle> ret(section_handle(native_handle_type(), &backing, file_handle(), _flag));
   native_handle_type &nativeh = ret.value()._v;
   nativeh.fd = backing.native_handle().fd;
@@ -75,7 +151,34 @@ result<section_handle> section_handle::section(file_handle &backing, extent_type
 
 result<section_handle> section_handle::section(extent_type bytes, const path_handle &dirh, flag _flag) noexcept
 {
-  OUTCOME_TRY(_anonh, file_handle::temp_inode(dirh));
+  OUTCOME_TRY(pagesize, page_size_from_flags(_flag));
+  file_handle _anonh;
+  if(pagesize != utils::page_size())
+  {
+#if defined(__linux__) && defined(MFD_HUGETLB)
+    // Large page backed anonymous inodes must live on hugetlbfs, and memfd_create() is the only portable way of finding one
+    unsigned shift = 0;
+    while((static_cast<size_t>(1) << shift) < pagesize)
+    {
+      shift++;
+    }
+    int fd = ::memfd_create("afio_section", MFD_CLOEXEC | MFD_HUGETLB | (shift << MFD_HUGE_SHIFT));
+    if(-1 == fd)
+    {
+      return {errno, std::system_category()};
+    }
+    _anonh = file_handle(native_handle_type(native_handle_type::disposition::file | native_handle_type::disposition::seekable | native_handle_type::disposition::readable | native_handle_type::disposition::writable, fd), 0, 0, file_handle::caching::temporary, file_handle::flag::anonymous_inode);
+    bytes = utils::round_up_to_page_size(bytes, pagesize);
+#else
+    (void) dirh;
+    return std::errc::not_supported;
+#endif
+  }
+  else
+  {
+    OUTCOME_TRY(anonh_, file_handle::temp_inode(dirh));
+    _anonh = std::move(anonh_);
+  }
   OUTCOME_TRYV(_anonh.truncate(bytes));
   result<section_handle> ret(section_handle(native_handle_type(), nullptr, std::move(_anonh), _flag));
   native_handle_type &nativeh = ret.value()._v;
@@ -113,6 +216,9 @@ result<section_handle::extent_type> section_handle::truncate(extent_type newsize
   AFIO_LOG_FUNCTION_CALL(this);
   if((_backing == nullptr) && newsize > 0)
   {
+    // hugetlbfs inodes can only be sized in multiples of their page size
+    OUTCOME_TRY(pagesize, page_size_from_flags(_flag));
+    newsize = utils::round_up_to_page_size(newsize, pagesize);
     if(-1 == ::ftruncate(_anonymous.native_handle().fd, newsize))
     {
       return {errno, std::system_category()};
@@ -137,17 +243,24 @@ map_handle::~map_handle()
       abort();
     }
   }
+  _wait_async_barriers();
+  delete _faults;
 }
 
 result<void> map_handle::close() noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
+  // Barriers in flight refer to the pages and the backing file
+  _wait_async_barriers();
   if(_addr != nullptr)
   {
     if(is_writable() && (_flag & section_handle::flag::barrier_on_close))
     {
       OUTCOME_TRYV(map_handle::barrier({}, true, false));
     }
+    // Stop servicing faults before the pages go away
+    delete _lazy;
+    _lazy = nullptr;
     // printf("%d munmap %p-%p\n", getpid(), _addr, _addr+_length);
     if(-1 == ::munmap(_addr, _length))
     {
@@ -164,6 +277,10 @@ result<void> map_handle::close() noexcept
 native_handle_type map_handle::release() noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
+  _wait_async_barriers();
+  // Unfilled pages of a released lazy map become ordinary zero filled memory
+  delete _lazy;
+  _lazy = nullptr;
   // We don't want ~handle() to close our borrowed handle
   _v = native_handle_type();
   _addr = nullptr;
@@ -203,7 +320,7 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::barrier(map_ha
 }
 
 
-static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr, int extra_flags, section_handle *section, map_handle::size_type &bytes, map_handle::extent_type offset, section_handle::flag _flag) noexcept
+static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr, int extra_flags, section_handle *section, map_handle::size_type &bytes, map_handle::extent_type offset, section_handle::flag _flag, map_handle::size_type *pagesize_used = nullptr, utils::numa_policy numa = {}) noexcept
 {
   bool have_backing = (section != nullptr);
   int prot = 0, flags = have_backing ? MAP_SHARED : (MAP_PRIVATE | MAP_ANONYMOUS);
@@ -240,7 +357,8 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
   }
 #endif
 #ifdef MAP_POPULATE
-  if(_flag & section_handle::flag::prefault)
+  // Pages must not be faulted in before their NUMA policy is set
+  if((_flag & section_handle::flag::prefault) && !numa)
   {
     flags |= MAP_POPULATE;
   }
@@ -253,6 +371,30 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
   if(have_backing && section->backing() != nullptr && (section->backing()->kernel_caching() == handle::caching::temporary))
     flags |= MAP_NOSYNC;
 #endif
+  OUTCOME_TRY(pagesize, page_size_from_flags(_flag));
+  if(pagesize != utils::page_size())
+  {
+    bytes = utils::round_up_to_page_size(bytes, pagesize);
+    // Backed maps get their page size from the hugetlbfs inode
+    if(!have_backing)
+    {
+#ifdef MAP_HUGETLB
+      flags |= MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+      unsigned shift = 0;
+      while((static_cast<size_t>(1) << shift) < pagesize)
+      {
+        shift++;
+      }
+      flags |= shift << MAP_HUGE_SHIFT;
+#endif
+#elif defined(MAP_ALIGNED_SUPER)
+      flags |= MAP_ALIGNED_SUPER;
+#else
+      return std::errc::not_supported;
+#endif
+    }
+  }
   flags |= extra_flags;
   // printf("mmap(%p, %u, %d, %d, %d, %u)\n", ataddr, (unsigned) bytes, prot, flags, have_backing ? section->native_handle().fd : -1, (unsigned) offset);
   addr = ::mmap(ataddr, bytes, prot, flags, have_backing ? section->native_handle().fd : -1, offset);
@@ -261,6 +403,49 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
   {
     return {errno, std::system_category()};
   }
+  if(numa)
+  {
+    auto placed = utils::apply_numa_policy(addr, bytes, numa);
+    if(!placed)
+    {
+      ::munmap(addr, bytes);
+      return placed.error();
+    }
+    if(_flag & section_handle::flag::prefault)
+    {
+      // As MAP_POPULATE would have, allocating private pages but only reading shared ones
+      (void) map_handle::populate({static_cast<char *>(addr), bytes}, !have_backing && (prot & PROT_WRITE) != 0);
+    }
+  }
+#ifdef MADV_HUGEPAGE
+  if((_flag & section_handle::flag::transparent_huge_pages) && pagesize == utils::page_size())
+  {
+    // Fails if the kernel has transparent huge pages disabled, which is not fatal
+    (void) ::madvise(addr, bytes, MADV_HUGEPAGE);
+    if(_flag & section_handle::flag::prefault)
+    {
+      // MADV_COLLAPSE needs Linux 6.1, and only succeeds if every huge page aligned region got collapsed
+      if(-1 != ::madvise(addr, bytes, MADV_COLLAPSE))
+      {
+        try
+        {
+          auto pagesizes(utils::page_sizes(false));
+          if(pagesizes.size() > 1)
+          {
+            pagesize = pagesizes[1];
+          }
+        }
+        catch(...)
+        {
+        }
+      }
+    }
+  }
+#endif
+  if(pagesize_used != nullptr)
+  {
+    *pagesize_used = pagesize;
+  }
 #if 0  // not implemented yet, not seen any benefit over setting this at the fd level
   if(have_backing && ((flags & map_handle::flag::disable_prefetching) || (flags & map_handle::flag::maximum_prefetching)))
   {
@@ -272,7 +457,7 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
   return addr;
 }
 
-result<map_handle> map_handle::map(size_type bytes, section_handle::flag _flag) noexcept
+result<map_handle> map_handle::map(size_type bytes, section_handle::flag _flag, utils::numa_policy numa) noexcept
 {
   if(bytes == 0u)
   {
@@ -281,7 +466,9 @@ result<map_handle> map_handle::map(size_type bytes, section_handle::flag _flag)
   bytes = utils::round_up_to_page_size(bytes);
   result<map_handle> ret(map_handle(nullptr));
   native_handle_type &nativeh = ret.value()._v;
-  OUTCOME_TRY(addr, do_mmap(nativeh, nullptr, 0, nullptr, bytes, 0, _flag));
+  OUTCOME_TRY(addr, do_mmap(nativeh, nullptr, 0, nullptr, bytes, 0, _flag, &ret.value()._pagesize, numa));
+  // Kept whole so truncate() and relocate() map any new pages as these were
+  ret.value()._flag = _flag;
   ret.value()._addr = static_cast<char *>(addr);
   ret.value()._reservation = bytes;
   ret.value()._length = bytes;
@@ -289,7 +476,7 @@ result<map_handle> map_handle::map(size_type bytes, section_handle::flag _flag)
   return ret;
 }
 
-result<map_handle> map_handle::map(section_handle &section, size_type bytes, extent_type offset, section_handle::flag _flag) noexcept
+result<map_handle> map_handle::map(section_handle &section, size_type bytes, extent_type offset, section_handle::flag _flag, utils::numa_policy numa) noexcept
 {
   OUTCOME_TRY(length, section.length());  // length of the backing file
   if(bytes == 0u)
@@ -298,7 +485,10 @@ result<map_handle> map_handle::map(section_handle &section, size_type bytes, ext
   }
   result<map_handle> ret{map_handle(&section)};
   native_handle_type &nativeh = ret.value()._v;
-  OUTCOME_TRY(addr, do_mmap(nativeh, nullptr, 0, &section, bytes, offset, _flag));
+  // Views inherit the page size, huge page and barrier on close preferences of their section
+  _flag |= section.section_flags() & (section_handle::flag::page_sizes_3 | section_handle::flag::transparent_huge_pages | section_handle::flag::barrier_on_close);
+  ret.value()._flag = _flag;
+  OUTCOME_TRY(addr, do_mmap(nativeh, nullptr, 0, &section, bytes, offset, _flag, &ret.value()._pagesize, numa));
   ret.value()._addr = static_cast<char *>(addr);
   ret.value()._offset = offset;
   ret.value()._reservation = bytes;
@@ -309,16 +499,244 @@ result<map_handle> map_handle::map(section_handle &section, size_type bytes, ext
   return ret;
 }
 
+#if defined(__linux__) && defined(__NR_userfaultfd)
+struct map_handle::_lazy_state
+{
+  int uffd{-1}, stopfd{-1};
+  char *addr{nullptr}, *staging{nullptr};
+  size_type pagesize{0}, readahead{0};
+  lazy_fill_type fill;
+  std::vector<bool> filled;  // only touched by the handler thread
+  std::mutex lock;
+  result<void> status{success()};  // the first failure of fill, guarded by lock
+  std::thread handler;
+
+  _lazy_state() = default;
+  _lazy_state(const _lazy_state &) = delete;
+  _lazy_state &operator=(const _lazy_state &) = delete;
+  ~_lazy_state()
+  {
+    if(handler.joinable())
+    {
+      uint64_t one = 1;
+      (void) ::write(stopfd, &one, sizeof(one));
+      handler.join();
+    }
+    // Closing the userfaultfd unregisters the map, and wakes any faulting threads
+    if(uffd != -1)
+    {
+      ::close(uffd);
+    }
+    if(stopfd != -1)
+    {
+      ::close(stopfd);
+    }
+    if(staging != nullptr)
+    {
+      ::munmap(staging, readahead);
+    }
+  }
+
+  void run() noexcept
+  {
+    const size_t pages = filled.size();
+    size_type window = pagesize;
+    char *expected = nullptr;  // where the next fault of a sequential access pattern would land
+    pollfd fds[2] = {{uffd, POLLIN, 0}, {stopfd, POLLIN, 0}};
+    for(;;)
+    {
+      if(-1 == ::poll(fds, 2, -1))
+      {
+        if(EINTR == errno)
+        {
+          continue;
+        }
+        return;
+      }
+      if(fds[1].revents != 0)
+      {
+        return;
+      }
+      uffd_msg msg;
+      if(::read(uffd, &msg, sizeof(msg)) != sizeof(msg) || msg.event != UFFD_EVENT_PAGEFAULT)
+      {
+        continue;
+      }
+      size_t first = static_cast<size_t>(msg.arg.pagefault.address - reinterpret_cast<uintptr_t>(addr)) / pagesize;
+      char *page = addr + first * pagesize;
+      // Sequential faults double the batch, anything else resets it
+      window = (page == expected) ? std::min(window * 2, readahead) : pagesize;
+      size_t count = 1;
+      while(count * pagesize < window && first + count < pages && !filled[first + count])
+      {
+        ++count;
+      }
+      size_type len = count * pagesize, done = 0;
+      result<size_type> r(0);
+      try
+      {
+        r = fill(page - addr, buffer_type{staging, len});
+      }
+      catch(...)
+      {
+        r = error_from_exception();
+      }
+      if(r)
+      {
+        done = std::min(r.value(), len);
+      }
+      else
+      {
+        std::lock_guard<std::mutex> g(lock);
+        if(status)
+        {
+          status = r.as_failure();
+        }
+      }
+      memset(staging + done, 0, len - done);
+      uffdio_copy copy{};
+      copy.dst = reinterpret_cast<uintptr_t>(page);
+      copy.src = reinterpret_cast<uintptr_t>(staging);
+      copy.len = len;
+      if(-1 == ::ioctl(uffd, UFFDIO_COPY, &copy))
+      {
+        // Some of the range was already present, perhaps the faulting page itself, so make sure the
+        // faulting thread is woken. If its page is still missing, it will fault again.
+        uffdio_range range{reinterpret_cast<uintptr_t>(page), pagesize};
+        (void) ::ioctl(uffd, UFFDIO_WAKE, &range);
+        expected = nullptr;
+        continue;
+      }
+      for(size_t n = 0; n < count; n++)
+      {
+        filled[first + n] = true;
+      }
+      expected = page + len;
+    }
+  }
+};
+
+result<map_handle> map_handle::map_lazy(size_type bytes, lazy_fill_type fill, size_type readahead) noexcept
+{
+  if(bytes == 0u || !fill)
+  {
+    return std::errc::invalid_argument;
+  }
+  const size_type pagesize = utils::page_size();
+  bytes = utils::round_up_to_page_size(bytes, pagesize);
+  readahead = utils::round_up_to_page_size((readahead == 0u) ? 1024 * 1024 : readahead, pagesize);
+  if(readahead > bytes)
+  {
+    readahead = bytes;
+  }
+  OUTCOME_TRY(ret, map(bytes));
+  std::unique_ptr<_lazy_state> state;
+  try
+  {
+    state = std::make_unique<_lazy_state>();
+    state->filled.resize(bytes / pagesize);
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+  state->addr = ret._addr;
+  state->pagesize = pagesize;
+  state->readahead = readahead;
+  state->fill = std::move(fill);
+  // Handling faults taken by the kernel, e.g. when a lazy map is passed to write(), needs privilege
+  // which may be denied. Fall back to handling just those faults taken by user space.
+  state->uffd = static_cast<int>(::syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK));
+  if(-1 == state->uffd && EPERM == errno)
+  {
+    state->uffd = static_cast<int>(::syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | 1 /*UFFD_USER_MODE_ONLY*/));
+  }
+  if(-1 == state->uffd)
+  {
+    // Kernels older than 5.11 don't know UFFD_USER_MODE_ONLY
+    if(ENOSYS == errno || EPERM == errno || EINVAL == errno)
+    {
+      return std::errc::not_supported;
+    }
+    return {errno, std::system_category()};
+  }
+  uffdio_api api{};
+  api.api = UFFD_API;
+  if(-1 == ::ioctl(state->uffd, UFFDIO_API, &api))
+  {
+    return {errno, std::system_category()};
+  }
+  uffdio_register reg{};
+  reg.range.start = reinterpret_cast<uintptr_t>(ret._addr);
+  reg.range.len = bytes;
+  reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+  if(-1 == ::ioctl(state->uffd, UFFDIO_REGISTER, &reg))
+  {
+    return {errno, std::system_category()};
+  }
+  state->stopfd = ::eventfd(0, EFD_CLOEXEC);
+  if(-1 == state->stopfd)
+  {
+    return {errno, std::system_category()};
+  }
+  void *staging = ::mmap(nullptr, readahead, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(MAP_FAILED == staging)
+  {
+    return {errno, std::system_category()};
+  }
+  state->staging = static_cast<char *>(staging);
+  try
+  {
+    _lazy_state *s = state.get();
+    state->handler = std::thread([s] { s->run(); });
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+  ret._lazy = state.release();
+  return ret;
+}
+
+result<void> map_handle::lazy_status() const noexcept
+{
+  if(_lazy == nullptr)
+  {
+    return success();
+  }
+  std::lock_guard<std::mutex> g(_lazy->lock);
+  return _lazy->status;
+}
+#else
+struct map_handle::_lazy_state
+{
+};
+
+result<map_handle> map_handle::map_lazy(size_type /*unused*/, lazy_fill_type /*unused*/, size_type /*unused*/) noexcept
+{
+  return std::errc::not_supported;
+}
+
+result<void> map_handle::lazy_status() const noexcept
+{
+  return success();
+}
+#endif
+
 result<map_handle::size_type> map_handle::truncate(size_type newsize, bool permit_relocation) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
+  if(_lazy != nullptr)
+  {
+    return std::errc::not_supported;
+  }
   extent_type length = _length;
   if(_section != nullptr)
   {
     OUTCOME_TRY(length_, _section->length());  // length of the backing file
     length = length_;
   }
-  newsize = utils::round_up_to_page_size(newsize);
+  newsize = utils::round_up_to_page_size(newsize, page_size());
   if(newsize == _reservation)
   {
     return success();
@@ -336,15 +754,20 @@ result<map_handle::size_type> map_handle::truncate(size_type newsize, bool permi
   }
   if(_addr == nullptr)
   {
-    OUTCOME_TRY(addr, do_mmap(_v, nullptr, 0, _section, newsize, _offset, _flag));
+    OUTCOME_TRY(addr, do_mmap(_v, nullptr, 0, _section, newsize, _offset, _flag, &_pagesize));
     _addr = static_cast<char *>(addr);
     _reservation = newsize;
     _length = (length - _offset < newsize) ? (length - _offset) : newsize;  // length of backing, not reservation
     return newsize;
   }
+  if(permit_relocation)
+  {
+    OUTCOME_TRY(region, relocate(newsize));
+    return region.len;
+  }
 #ifdef __linux__
   // Dead easy on Linux
-  void *newaddr = ::mremap(_addr, _reservation, newsize, permit_relocation ? MREMAP_MAYMOVE : 0);
+  void *newaddr = ::mremap(_addr, _reservation, newsize, 0);
   if(MAP_FAILED == newaddr)
   {
     return {errno, std::system_category()};
@@ -390,6 +813,67 @@ result<map_handle::size_type> map_handle::truncate(size_type newsize, bool permi
 #endif
 }
 
+result<map_handle::buffer_type> map_handle::relocate(size_type newsize) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(_addr == nullptr || newsize == 0)
+  {
+    return std::errc::invalid_argument;
+  }
+  if(_lazy != nullptr)
+  {
+    return std::errc::not_supported;
+  }
+  newsize = utils::round_up_to_page_size(newsize, page_size());
+  if(newsize == _reservation)
+  {
+    return buffer_type{_addr, _reservation};
+  }
+  extent_type length = newsize;  // anonymous memory is as long as its reservation
+  if(_section != nullptr)
+  {
+    OUTCOME_TRY(length_, _section->length());  // length of the backing file
+    length = length_;
+  }
+#ifdef __linux__
+  // Moves the page table entries, never the pages, so this is O(1) for anonymous and file backed maps alike
+  void *newaddr = ::mremap(_addr, _reservation, newsize, MREMAP_MAYMOVE);
+  if(MAP_FAILED != newaddr)
+  {
+    _addr = static_cast<char *>(newaddr);
+    _reservation = newsize;
+    _length = (length - _offset < newsize) ? (length - _offset) : newsize;  // length of backing, not reservation
+    return buffer_type{_addr, _reservation};
+  }
+  // EFAULT means the map spans more than one kernel VMA, which the generic method below may still handle
+  if(errno != EFAULT)
+  {
+    return {errno, std::system_category()};
+  }
+#endif
+  if(truncate(newsize, false))
+  {
+    return buffer_type{_addr, _reservation};
+  }
+  // Only a view of a shared section can be recreated elsewhere without copying its contents
+  if(_section == nullptr || (_flag & section_handle::flag::cow))
+  {
+    return std::errc::not_supported;
+  }
+  size_type bytes = newsize;
+  OUTCOME_TRY(addr, do_mmap(_v, nullptr, 0, _section, bytes, _offset, _flag));
+  if(-1 == ::munmap(_addr, _reservation))
+  {
+    int errcode = errno;
+    ::munmap(addr, bytes);
+    return {errcode, std::system_category()};
+  }
+  _addr = static_cast<char *>(addr);
+  _reservation = newsize;
+  _length = (length - _offset < newsize) ? (length - _offset) : newsize;  // length of backing, not reservation
+  return buffer_type{_addr, _reservation};
+}
+
 result<map_handle::buffer_type> map_handle::commit(buffer_type region, section_handle::flag flag) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
@@ -397,11 +881,11 @@ result<map_handle::buffer_type> map_handle::commit(buffer_type region, section_h
   {
     return std::errc::invalid_argument;
   }
-  // Set permissions on the pages
-  region = utils::round_to_page_size(region);
+  // Set permissions on the pages, keeping any large page size of this map
+  region = utils::round_to_page_size(region, page_size());
   extent_type offset = _offset + (region.data - _addr);
   size_type bytes = region.len;
-  OUTCOME_TRYV(do_mmap(_v, region.data, MAP_FIXED, _section, bytes, offset, flag));
+  OUTCOME_TRYV(do_mmap(_v, region.data, MAP_FIXED, _section, bytes, offset, flag | (_flag & section_handle::flag::page_sizes_3)));
   // Tell the kernel we will be using these pages soon
   if(-1 == ::madvise(region.data, region.len, MADV_WILLNEED))
   {
@@ -417,16 +901,16 @@ result<map_handle::buffer_type> map_handle::decommit(buffer_type region) noexcep
   {
     return std::errc::invalid_argument;
   }
-  region = utils::round_to_page_size(region);
+  region = utils::round_to_page_size(region, page_size());
   // Tell the kernel to kick these pages into storage
   if(-1 == ::madvise(region.data, region.len, MADV_DONTNEED))
   {
     return {errno, std::system_category()};
   }
-  // Set permissions on the pages to no access
+  // Set permissions on the pages to no access, keeping any large page size of this map
   extent_type offset = _offset + (region.data - _addr);
   size_type bytes = region.len;
-  OUTCOME_TRYV(do_mmap(_v, region.data, MAP_FIXED, _section, bytes, offset, section_handle::flag::none));
+  OUTCOME_TRYV(do_mmap(_v, region.data, MAP_FIXED, _section, bytes, offset, _flag & section_handle::flag::page_sizes_3));
   return region;
 }
 
@@ -465,6 +949,37 @@ result<span<map_handle::buffer_type>> map_handle::prefetch(span<buffer_type> reg
   return regions;
 }
 
+result<map_handle::buffer_type> map_handle::populate(buffer_type region, bool for_write) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(0);
+  if(region.data == nullptr)
+  {
+    return std::errc::invalid_argument;
+  }
+  char *end = utils::round_up_to_page_size(region.data + region.len);
+  region.data = utils::round_down_to_page_size(region.data);
+  region.len = end - region.data;
+#ifdef __linux__
+  if(-1 != ::madvise(region.data, region.len, for_write ? MADV_POPULATE_WRITE : MADV_POPULATE_READ))
+  {
+    return region;
+  }
+  // Kernels before 5.14 don't know these advices
+  if(EINVAL != errno)
+  {
+    return {errno, std::system_category()};
+  }
+#endif
+  // Read every page, as writing would race with other threads
+  size_t pagesize = utils::page_size();
+  volatile auto *a = static_cast<volatile char *>(region.data);
+  for(size_t n = 0; n < region.len; n += pagesize)
+  {
+    a[n];
+  }
+  return region;
+}
+
 result<map_handle::buffer_type> map_handle::do_not_store(buffer_type region) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(0);
@@ -491,6 +1006,342 @@ result<map_handle::buffer_type> map_handle::do_not_store(buffer_type region) noe
   return region;
 }
 
+void map_handle::_fault_counts(uint64_t &major, uint64_t &minor) noexcept
+{
+  struct rusage ru
+  {
+  };
+#ifdef RUSAGE_THREAD
+  if(-1 == ::getrusage(RUSAGE_THREAD, &ru))
+#else
+  if(-1 == ::getrusage(RUSAGE_SELF, &ru))
+#endif
+  {
+    major = minor = 0;
+    return;
+  }
+  major = static_cast<uint64_t>(ru.ru_majflt);
+  minor = static_cast<uint64_t>(ru.ru_minflt);
+}
+
+result<void> map_handle::set_fault_accounting(bool enable) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!enable)
+  {
+    delete _faults;
+    _faults = nullptr;
+    return success();
+  }
+  if(_faults == nullptr)
+  {
+    _faults = new(std::nothrow) _fault_counters;
+    if(_faults == nullptr)
+    {
+      return std::errc::not_enough_memory;
+    }
+  }
+  return success();
+}
+
+#ifdef __linux__
+// Returns the bytes of [begin, end) which are dirty according to /proc/self/smaps. As smaps only
+// reports per mapping totals, mappings partially overlapping the range are pro rated.
+static inline result<size_t> dirty_bytes_from_smaps(uintptr_t begin, uintptr_t end) noexcept
+{
+  FILE *f = ::fopen("/proc/self/smaps", "r");
+  if(f == nullptr)
+  {
+    return {errno, std::system_category()};
+  }
+  auto unf = undoer([f] { ::fclose(f); });
+  char line[512];
+  unsigned long vmabegin = 0, vmaend = 0;  // NOLINT
+  size_t overlap = 0, dirty = 0;
+  double ret = 0;
+  auto accumulate = [&] {
+    if(overlap != 0 && dirty != 0)
+    {
+      ret += static_cast<double>(dirty) * static_cast<double>(overlap) / static_cast<double>(vmaend - vmabegin);
+    }
+    overlap = 0;
+    dirty = 0;
+  };
+  while(::fgets(line, sizeof(line), f) != nullptr)
+  {
+    unsigned long a = 0, b = 0;  // NOLINT
+    char perms[5];
+    size_t kb = 0;
+    if(3 == ::sscanf(line, "%lx-%lx %4s", &a, &b, perms))  // NOLINT
+    {
+      accumulate();
+      vmabegin = a;
+      vmaend = b;
+      uintptr_t obegin = std::max<uintptr_t>(begin, vmabegin), oend = std::min<uintptr_t>(end, vmaend);
+      overlap = (oend > obegin) ? (oend - obegin) : 0;
+    }
+    else if(overlap != 0 && (1 == ::sscanf(line, "Shared_Dirty: %zu kB", &kb) || 1 == ::sscanf(line, "Private_Dirty: %zu kB", &kb)))  // NOLINT
+    {
+      dirty += kb * 1024;
+    }
+  }
+  accumulate();
+  return static_cast<size_t>(ret);
+}
+#endif
+
+result<map_handle::page_statistics_type> map_handle::page_statistics(buffer_type region) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(region.data == nullptr)
+  {
+    if(_addr == nullptr)
+    {
+      return std::errc::invalid_argument;
+    }
+    region = {_addr, _length};
+  }
+  const size_type pagesize = page_size();
+  char *end = utils::round_up_to_page_size(region.data + region.len, pagesize);
+  region.data = utils::round_down_to_page_size(region.data, pagesize);
+  region.len = end - region.data;
+  page_statistics_type ret;
+  ret.pages = region.len / pagesize;
+  // mincore() always reports in units of the system page size, so scan that in chunks
+  const size_type syspagesize = utils::page_size();
+#ifdef __linux__
+  unsigned char vec[4096];
+#else
+  char vec[4096];
+#endif
+  for(size_type offset = 0; offset < region.len;)
+  {
+    size_type thischunk = std::min(region.len - offset, sizeof(vec) * syspagesize);
+    if(-1 == ::mincore(region.data + offset, thischunk, vec))
+    {
+      return {errno, std::system_category()};
+    }
+    for(size_type n = 0; n < thischunk / syspagesize; n++)
+    {
+      if((vec[n] & 1) != 0)
+      {
+        ret.resident_pages++;
+      }
+    }
+    offset += thischunk;
+  }
+  // Convert from system pages to our pages
+  ret.resident_pages = ret.resident_pages * syspagesize / pagesize;
+#ifdef __linux__
+  OUTCOME_TRY(dirtybytes, dirty_bytes_from_smaps(reinterpret_cast<uintptr_t>(region.data), reinterpret_cast<uintptr_t>(region.data + region.len)));
+  ret.dirty_pages = std::min(ret.resident_pages, (dirtybytes + pagesize - 1) / pagesize);
+#else
+  ret.dirty_pages = static_cast<size_type>(-1);
+#endif
+  if(_faults != nullptr)
+  {
+    ret.major_faults = _faults->major.load(std::memory_order_relaxed);
+    ret.minor_faults = _faults->minor.load(std::memory_order_relaxed);
+  }
+  return ret;
+}
+
+result<void> map_handle::set_numa_policy(utils::numa_policy policy, buffer_type region, bool move_existing) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(region.data == nullptr)
+  {
+    if(_addr == nullptr)
+    {
+      return std::errc::invalid_argument;
+    }
+    region = {_addr, _reservation};
+  }
+  const size_type pagesize = page_size();
+  char *end = utils::round_up_to_page_size(region.data + region.len, pagesize);
+  region.data = utils::round_down_to_page_size(region.data, pagesize);
+  return utils::apply_numa_policy(region.data, end - region.data, policy, move_existing);
+}
+
+result<std::vector<map_handle::size_type>> map_handle::numa_distribution(buffer_type region) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(region.data == nullptr)
+  {
+    if(_addr == nullptr)
+    {
+      return std::errc::invalid_argument;
+    }
+    region = {_addr, _length};
+  }
+  const size_type pagesize = page_size();
+  char *end = utils::round_up_to_page_size(region.data + region.len, pagesize);
+  region.data = utils::round_down_to_page_size(region.data, pagesize);
+  region.len = end - region.data;
+#ifdef __linux__
+  try
+  {
+    std::vector<size_type> ret;
+    void *pages[512];
+    int status[512];
+    for(size_type offset = 0; offset < region.len;)
+    {
+      unsigned long count = 0;  // NOLINT
+      for(; count < sizeof(pages) / sizeof(pages[0]) && offset < region.len; count++, offset += pagesize)
+      {
+        pages[count] = region.data + offset;
+      }
+      // With no target nodes, move_pages() reports the node of each page
+      if(-1 == ::syscall(__NR_move_pages, 0, count, pages, nullptr, status, 0))
+      {
+        return {errno, std::system_category()};
+      }
+      for(unsigned long n = 0; n < count; n++)  // NOLINT
+      {
+        // Pages not resident report a negated errno
+        if(status[n] >= 0)
+        {
+          auto node = static_cast<size_t>(status[n]);
+          if(node >= ret.size())
+          {
+            ret.resize(node + 1);
+          }
+          ret[node]++;
+        }
+      }
+    }
+    return ret;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+#else
+  return std::errc::not_supported;
+#endif
+}
+
+result<void> map_handle::async_barrier_state::_start() noexcept
+{
+  if(-1 == ::msync(_region.data, _region.len, MS_ASYNC))
+  {
+    return {errno, std::system_category()};
+  }
+#ifdef __linux__
+  // msync(MS_ASYNC) is a no op on Linux, so kick off writeback of the dirty pages without waiting for it
+  if(_backing != nullptr && -1 == ::sync_file_range(_backing->native_handle().fd, _offset, _region.len, SYNC_FILE_RANGE_WRITE))
+  {
+    return {errno, std::system_category()};
+  }
+#endif
+  return success();
+}
+
+result<void> map_handle::async_barrier_state::_finish() noexcept
+{
+  // Anonymous memory has nowhere durable to go
+  if(_backing == nullptr)
+  {
+    return success();
+  }
+#ifdef __linux__
+  unsigned flags = SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER;
+  if(-1 == ::sync_file_range(_backing->native_handle().fd, _offset, _region.len, flags))
+#else
+  if(-1 == ::msync(_region.data, _region.len, MS_SYNC))
+#endif
+  {
+    return {errno, std::system_category()};
+  }
+  if(_wait_for_device || _and_metadata)
+  {
+    const_buffer_type req{_region.data, _region.len};
+    OUTCOME_TRYV(_backing->barrier(io_request<const_buffers_type>(const_buffers_type(&req, 1), _offset), _wait_for_device, _and_metadata));
+  }
+  return success();
+}
+
+result<map_handle::size_type> map_handle::send_to(native_handle_type dest, extent_type offset, size_type bytes, deadline d) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!dest.is_valid())
+  {
+    return std::errc::bad_file_descriptor;
+  }
+  std::chrono::steady_clock::time_point began_steady;
+  std::chrono::system_clock::time_point end_utc;
+  if(d)
+  {
+    if(d.steady)
+    {
+      began_steady = std::chrono::steady_clock::now();
+    }
+    else
+    {
+      end_utc = d.to_time_point();
+    }
+  }
+  size_type togo = offset < _length ? static_cast<size_type>(_length - offset) : 0;
+  if(bytes > togo)
+  {
+    bytes = togo;
+  }
+  const char *addr = _addr + offset;
+  size_type ret = 0;
+#ifdef __linux__
+  bool use_vmsplice = true;
+  // vmsplice() ignores O_NONBLOCK on the pipe
+  int fdflags = ::fcntl(dest.fd, F_GETFL);
+  unsigned spliceflags = (fdflags != -1 && (fdflags & O_NONBLOCK)) ? SPLICE_F_NONBLOCK : 0;
+#endif
+  while(bytes > 0)
+  {
+    ssize_t sent;
+#ifdef __linux__
+    if(use_vmsplice)
+    {
+      iovec iov{const_cast<char *>(addr), bytes};
+      sent = ::vmsplice(dest.fd, &iov, 1, spliceflags);
+      if(sent < 0 && (EBADF == errno || EINVAL == errno) && ret == 0)
+      {
+        // Not a pipe
+        use_vmsplice = false;
+        continue;
+      }
+    }
+    else
+#endif
+    {
+      sent = ::write(dest.fd, addr, bytes);
+    }
+    if(sent < 0)
+    {
+      if(EINTR == errno)
+      {
+        continue;
+      }
+      if(EAGAIN == errno || EWOULDBLOCK == errno)
+      {
+        OUTCOME_TRY(writable, poll_for_writable(dest.fd, d, began_steady, end_utc));
+        if(!writable)
+        {
+          if(ret > 0)
+          {
+            return ret;
+          }
+          return std::errc::timed_out;
+        }
+        continue;
+      }
+      return {errno, std::system_category()};
+    }
+    addr += sent;
+    bytes -= sent;
+    ret += sent;
+  }
+  return ret;
+}
+
 map_handle::io_result<map_handle::buffers_type> map_handle::read(io_request<buffers_type> reqs, deadline /*d*/) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
@@ -519,6 +1370,7 @@ map_handle::io_result<map_handle::buffers_type> map_handle::read(io_request<buff
 map_handle::io_result<map_handle::const_buffers_type> map_handle::write(io_request<const_buffers_type> reqs, deadline /*d*/) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
+  fault_scope faults(*this);
   char *addr = _addr + reqs.offset;
   size_type togo = reqs.offset < _length ? static_cast<size_type>(_length - reqs.offset) : 0;
   for(const_buffer_type &req : reqs.buffers)
@@ -25,12 +25,58 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../../../mapped_file_handle.hpp"
 #include "import.hpp"
 
+#include <sys/mman.h>
+#ifdef __linux__
+#include <linux/fs.h>  // for FICLONERANGE
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#ifndef FICLONERANGE
+// Added by Linux 4.5, so older system headers lack it
+struct file_clone_range
+{
+  int64_t src_fd;
+  uint64_t src_offset, src_length, dest_offset;
+};
+#define FICLONERANGE _IOW(0x94, 13, struct file_clone_range)
+#endif
+#endif
+
 AFIO_V2_NAMESPACE_BEGIN
 
 result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type reservation) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
   OUTCOME_TRY(length, underlying_file_length());
+  if(_address_space != 0)
+  {
+    // Growing within a fixed address space reservation, so map or unmap the tail in place
+    if(reservation == 0)
+    {
+      reservation = length;
+    }
+    reservation = utils::round_up_to_page_size(reservation);
+    if(reservation > _address_space)
+    {
+      return std::errc::not_enough_memory;
+    }
+    if(reservation > _reservation)
+    {
+      int prot = this->is_writable() ? (PROT_READ | PROT_WRITE) : PROT_READ;
+      if(MAP_FAILED == ::mmap(_mh.address() + _reservation, reservation - _reservation, prot, MAP_SHARED | MAP_FIXED, _sh.native_handle().fd, _reservation))  // NOLINT
+      {
+        return {errno, std::system_category()};
+      }
+    }
+    else if(reservation < _reservation)
+    {
+      if(MAP_FAILED == ::mmap(_mh.address() + reservation, _reservation - reservation, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0))  // NOLINT
+      {
+        return {errno, std::system_category()};
+      }
+    }
+    _reservation = reservation;
+    return reservation;
+  }
   if(length == 0)
   {
     // Not portable to map an empty file, so fail
@@ -51,6 +97,12 @@ result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type rese
   {
     return reservation;
   }
+  // Moving the existing map is O(1) on Linux, and keeps its fault accounting and residency
+  if(_mh.is_valid() && _mh.relocate(reservation))
+  {
+    _reservation = reservation;
+    return reservation;
+  }
   // Reserve the full reservation in address space
   section_handle::flag mapflags = section_handle::flag::nocommit | section_handle::flag::read;
   if(this->is_writable())
@@ -59,11 +111,128 @@ result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type rese
   }
   OUTCOME_TRYV(_mh.close());
   OUTCOME_TRY(mh, map_handle::map(_sh, reservation, 0, mapflags));
+  // Keep any page fault accounting across the remap
+  std::swap(mh._faults, _mh._faults);
   _mh = std::move(mh);
   _reservation = reservation;
   return reservation;
 }
 
+result<mapped_file_handle::size_type> mapped_file_handle::reserve_address_space(size_type bytes) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRY(length, underlying_file_length());
+  bytes = utils::round_up_to_page_size(bytes);
+  size_type reservation = utils::round_up_to_page_size(static_cast<size_type>(length));
+  if(_mh.is_valid() && _reservation > reservation)
+  {
+    reservation = _reservation;
+  }
+  if(bytes == 0 || bytes < reservation)
+  {
+    return std::errc::invalid_argument;
+  }
+  if(!_sh.is_valid())
+  {
+    section_handle::flag sectionflags = section_handle::flag::readwrite;
+    OUTCOME_TRY(sh, section_handle::section(*this, length, sectionflags));
+    _sh = std::move(sh);
+  }
+  // Reserve the whole region inaccessible and uncommitted
+  OUTCOME_TRY(mh, map_handle::map(bytes, section_handle::flag::nocommit));
+  // Turn it into a view of our section, and map the reservation over its front
+  mh._section = &_sh;
+  mh._flag = _sh.section_flags();
+  mh._v.fd = _sh.native_handle().fd;
+  mh._v.behaviour |= native_handle_type::disposition::seekable | native_handle_type::disposition::readable;
+  int prot = PROT_READ;
+  if(this->is_writable())
+  {
+    mh._v.behaviour |= native_handle_type::disposition::writable;
+    prot |= PROT_WRITE;
+  }
+  if(reservation > 0 && MAP_FAILED == ::mmap(mh.address(), reservation, prot, MAP_SHARED | MAP_FIXED, _sh.native_handle().fd, 0))  // NOLINT
+  {
+    return {errno, std::system_category()};
+  }
+  OUTCOME_TRYV(_mh.close());
+  // Keep any page fault accounting across the remap
+  std::swap(mh._faults, _mh._faults);
+  _mh = std::move(mh);
+  _reservation = reservation;
+  _address_space = bytes;
+  _published_length.store(length, std::memory_order_release);
+  return bytes;
+}
+
+result<mapped_file_handle> mapped_file_handle::snapshot(extent_type offset, extent_type bytes) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRY(maplength, length());
+  if(offset >= maplength)
+  {
+    return std::errc::invalid_argument;
+  }
+  if(bytes == 0 || bytes > maplength - offset)
+  {
+    bytes = maplength - offset;
+  }
+  // Extents can only be shared within a filing system, so try to create the snapshot beside this file
+  result<file_handle> fh_(std::errc::no_such_file_or_directory);
+  {
+    auto dirh = parent_path_handle();
+    if(dirh)
+    {
+      fh_ = file_handle::temp_inode(dirh.value());
+    }
+  }
+  if(!fh_)
+  {
+    fh_ = file_handle::temp_inode();
+  }
+  OUTCOME_TRY(fh, std::move(fh_));
+  OUTCOME_TRYV(fh.truncate(bytes));
+  extent_type done = 0;
+#ifdef __linux__
+  {
+    // Sharing extents needs block aligned ranges, except that the range may end at the end of the file
+    OUTCOME_TRY(filelength, underlying_file_length());
+    file_clone_range fcr{_v.fd, offset, (offset + bytes == filelength) ? 0 : bytes, 0};
+    const extent_type pagesize = utils::page_size();
+    if((offset & (pagesize - 1)) == 0 && (fcr.src_length & (pagesize - 1)) == 0 && -1 != ::ioctl(fh.native_handle().fd, FICLONERANGE, &fcr))
+    {
+      done = bytes;
+    }
+  }
+#ifdef __NR_copy_file_range
+  while(done < bytes)
+  {
+    int64_t in = offset + done, out = done;
+    auto copied = ::syscall(__NR_copy_file_range, _v.fd, &in, fh.native_handle().fd, &out, static_cast<size_t>(bytes - done), 0);
+    if(copied <= 0)
+    {
+      // Kernels before 4.5 don't have it, before 5.3 it can't cross filing systems
+      break;
+    }
+    done += copied;
+  }
+#endif
+#endif
+  // Copy whatever remains out of the map
+  while(done < bytes)
+  {
+    OUTCOME_TRY(written, fh.write(done, _mh.address() + offset + done, static_cast<size_type>(bytes - done)));
+    if(written.len == 0)
+    {
+      return std::errc::io_error;
+    }
+    done += written.len;
+  }
+  mapped_file_handle ret(std::move(fh));
+  OUTCOME_TRYV(ret.reserve(static_cast<size_type>(bytes)));
+  return {std::move(ret)};
+}
+
 result<void> mapped_file_handle::close() noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
@@ -94,6 +263,36 @@ native_handle_type mapped_file_handle::release() noexcept
 result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type newsize) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
+  if(_address_space != 0)
+  {
+    // The map never moves, so concurrent readers need only observe the published length
+    if(newsize > _address_space)
+    {
+      return std::errc::not_enough_memory;
+    }
+    extent_type length = _published_length.load(std::memory_order_relaxed);
+    if(newsize < length)
+    {
+      // Readers must have stopped accessing the region being truncated away before now
+      _published_length.store(newsize, std::memory_order_release);
+      char *start = utils::round_up_to_page_size(_mh.address() + newsize);
+      char *end = utils::round_up_to_page_size(_mh.address() + length);
+      if(end > start)
+      {
+        (void) _mh.do_not_store({start, static_cast<size_t>(end - start)});
+      }
+    }
+    OUTCOME_TRYV(file_handle::truncate(newsize));
+    if(newsize > _reservation)
+    {
+      OUTCOME_TRYV(reserve(newsize));
+    }
+    if(newsize > length)
+    {
+      _published_length.store(newsize, std::memory_order_release);
+    }
+    return newsize;
+  }
   // Release all maps and sections and truncate the backing file to zero
   if(newsize == 0)
   {
@@ -131,7 +330,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
     size = newsize;
   }
   // Adjust the map to reflect the new size of the section
-  _mh._length = size;
+  _publish_length(size);
   return newsize;
 }
 
@@ -143,6 +342,11 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
     // This API never exceeds the reservation
     length = _reservation;
   }
+  if(_address_space != 0)
+  {
+    _publish_length(length);
+    return length;
+  }
   if(length == 0)
   {
     OUTCOME_TRYV(_mh.close());
@@ -155,7 +359,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
     return length;
   }
   // Adjust the map to reflect the new size of the section
-  _mh._length = length;
+  _publish_length(length);
   return length;
 }
 
@@ -29,6 +29,9 @@ Distributed under the Boost Software License, Version 1.0.
 #include <mutex>  // for lock_guard
 
 #include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 AFIO_V2_NAMESPACE_BEGIN
 
@@ -169,9 +172,97 @@ namespace utils
     return std::errc::not_supported;
   }
 
+#ifdef __linux__
+  namespace detail
+  {
+    // Returns the MPOL_* mode for the policy
+    inline int numa_policy_mode(numa_policy policy) noexcept
+    {
+      switch(policy.policy)
+      {
+      case numa_policy::mode::none:
+        return 0 /*MPOL_DEFAULT*/;
+      case numa_policy::mode::preferred:
+        return 1 /*MPOL_PREFERRED*/;
+      case numa_policy::mode::bind:
+        return 2 /*MPOL_BIND*/;
+      case numa_policy::mode::interleave:
+        return 3 /*MPOL_INTERLEAVE*/;
+      }
+      return 0;
+    }
+  }  // namespace detail
+#endif
+
+  result<void> apply_numa_policy(void *addr, size_t bytes, numa_policy policy, bool move_existing) noexcept
+  {
+#ifdef __linux__
+    unsigned long nodemask = static_cast<unsigned long>(policy.nodes);  // NOLINT
+    if(policy && policy.nodes == 0)
+    {
+      return std::errc::invalid_argument;
+    }
+    if(policy.policy == numa_policy::mode::preferred)
+    {
+      // MPOL_PREFERRED uses only the lowest numbered node
+      nodemask &= ~nodemask + 1;
+    }
+    bytes = round_up_to_page_size(bytes);
+    // The kernel reads one fewer bits than maxnode says
+    if(-1 == ::syscall(__NR_mbind, addr, bytes, detail::numa_policy_mode(policy), policy ? &nodemask : nullptr, policy ? sizeof(nodemask) * 8 + 1 : 0, move_existing ? (1 << 1) /*MPOL_MF_MOVE*/ : 0))
+    {
+      if(ENOSYS == errno)
+      {
+        return success();
+      }
+      return {errno, std::system_category()};
+    }
+    return success();
+#else
+    (void) addr;
+    (void) bytes;
+    (void) move_existing;
+    if(policy)
+    {
+      return std::errc::not_supported;
+    }
+    return success();
+#endif
+  }
+
+  result<void> set_thread_numa_policy(numa_policy policy) noexcept
+  {
+#ifdef __linux__
+    unsigned long nodemask = static_cast<unsigned long>(policy.nodes);  // NOLINT
+    if(policy && policy.nodes == 0)
+    {
+      return std::errc::invalid_argument;
+    }
+    if(policy.policy == numa_policy::mode::preferred)
+    {
+      nodemask &= ~nodemask + 1;
+    }
+    if(-1 == ::syscall(__NR_set_mempolicy, detail::numa_policy_mode(policy), policy ? &nodemask : nullptr, policy ? sizeof(nodemask) * 8 + 1 : 0))
+    {
+      if(ENOSYS == errno)
+      {
+        return success();
+      }
+      return {errno, std::system_category()};
+    }
+    return success();
+#else
+    if(policy)
+    {
+      return std::errc::not_supported;
+    }
+    return success();
+#endif
+  }
+
   namespace detail
   {
-    large_page_allocation allocate_large_pages(size_t bytes)
+    large_page_allocation allocate_large_pages(size_t bytes, numa_policy numa)
     {
       large_page_allocation ret(calculate_large_page_allocation(bytes));
       int flags = MAP_SHARED | MAP_ANON;
@@ -187,13 +278,14 @@ namespace utils
         flags |= VM_FLAGS_SUPERPAGE_SIZE_ANY;
 #endif
       }
-      if((ret.p = mmap(nullptr, ret.actual_size, PROT_WRITE, flags, -1, 0)) == nullptr)
+      if((ret.p = mmap(nullptr, ret.actual_size, PROT_WRITE, flags, -1, 0)) == MAP_FAILED)
       {
+        ret.p = nullptr;
         if(ENOMEM == errno)
         {
-          if((ret.p = mmap(nullptr, ret.actual_size, PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0)) != nullptr)
+          if((ret.p = mmap(nullptr, ret.actual_size, PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0)) == MAP_FAILED)
           {
-            return ret;
+            ret.p = nullptr;
           }
         }
       }
@@ -203,6 +295,12 @@ namespace utils
         printf("afio: Large page allocation successful\n");
       }
 #endif
+      // Nothing has touched the pages yet, so they will all be placed according to the policy
+      if(ret.p != nullptr && numa && !apply_numa_policy(ret.p, ret.actual_size, numa))
+      {
+        (void) munmap(ret.p, ret.actual_size);
+        ret.p = nullptr;
+      }
       return ret;
     }
     void deallocate_large_pages(void *p, size_t bytes)
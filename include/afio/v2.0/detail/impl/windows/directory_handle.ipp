@@ -23,8 +23,11 @@ http://www.boost.org/LICENSE_1_0.txt)
 */
 
 #include "../../../directory_handle.hpp"
+#include "../../../file_handle.hpp"
 #include "import.hpp"
 
+#include <algorithm>  // for max
+
 AFIO_V2_NAMESPACE_BEGIN
 
 result<directory_handle> directory_handle::directory(const path_handle &base, path_view_type path, mode _mode, creation _creation, caching _caching, flag flags) noexcept
@@ -268,6 +271,8 @@ result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_typ
   {
     return enumerate_info{std::move(tofill), stat_t::want::none, false};
   }
+  // Taken before any entry is read, so any change during the enumeration is seen
+  OUTCOME_TRY(version_before, version());
   UNICODE_STRING _glob{};
   memset(&_glob, 0, sizeof(_glob));
   path_view_type::c_str zglob(glob, true);
@@ -362,14 +367,300 @@ result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_typ
     {
       // Fill is complete
       tofill._resize(n);
-      return enumerate_info{std::move(tofill), default_stat_contents, true};
+      return enumerate_info{std::move(tofill), default_stat_contents, true, version_before};
     }
     if(n >= tofill.size())
     {
       // Fill is incomplete
-      return enumerate_info{std::move(tofill), default_stat_contents, false};
+      return enumerate_info{std::move(tofill), default_stat_contents, false, version_before};
+    }
+  }
+}
+
+result<directory_handle::enumerate_info> directory_handle::enumerate(buffers_type &&tofill, const glob_pattern &glob, filter filtering, span<char> kernelbuffer) const noexcept
+{
+  // The kernel does the matching
+  return enumerate(std::move(tofill), glob.pattern(), filtering, kernelbuffer);
+}
+
+result<directory_handle::enumerate_info> directory_handle::enumerate(enumerate_cursor &cursor, buffers_type &&tofill, path_view_type glob, filter filtering, span<char> kernelbuffer) const noexcept
+{
+  static constexpr stat_t::want default_stat_contents = stat_t::want::ino | stat_t::want::type | stat_t::want::atim | stat_t::want::mtim | stat_t::want::ctim | stat_t::want::size | stat_t::want::allocated | stat_t::want::birthtim | stat_t::want::sparse | stat_t::want::compressed | stat_t::want::reparse_point;
+  // The smallest possible entry, so a request of this many bytes per item in tofill can never return more entries than fit
+  static constexpr size_t min_entry_size = (offsetof(FILE_ID_FULL_DIR_INFORMATION, FileName) + sizeof(wchar_t) + 7) & ~static_cast<size_t>(7);
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(tofill.empty())
+  {
+    return enumerate_info{std::move(tofill), stat_t::want::none, cursor.done};
+  }
+  if(cursor.done)
+  {
+    tofill._resize(0);
+    return enumerate_info{std::move(tofill), stat_t::want::none, true, cursor.version};
+  }
+  if(cursor.position == 0)
+  {
+    // Taken before the first entry is read, so any change during the enumeration is seen
+    OUTCOME_TRY(version_before, version());
+    cursor.version = version_before;
+  }
+  UNICODE_STRING _glob{};
+  memset(&_glob, 0, sizeof(_glob));
+  path_view_type::c_str zglob(glob, true);
+  if(!glob.empty())
+  {
+    _glob.Buffer = const_cast<wchar_t *>(zglob.buffer);
+    _glob.Length = zglob.length * sizeof(wchar_t);
+    _glob.MaximumLength = _glob.Length + sizeof(wchar_t);
+  }
+  if(!tofill._kernel_buffer && kernelbuffer.empty())
+  {
+    // Let's assume the average leafname will be 64 characters long.
+    size_t toallocate = (sizeof(FILE_ID_FULL_DIR_INFORMATION) + 64 * sizeof(wchar_t)) * tofill.size();
+    auto *mem = new(std::nothrow) char[toallocate];
+    if(mem == nullptr)
+    {
+      return std::errc::not_enough_memory;
+    }
+    tofill._kernel_buffer = std::unique_ptr<char[]>(mem);
+    tofill._kernel_buffer_size = toallocate;
+  }
+  size_t n = 0;
+  // Entries not returned this call stay in the handle for the next call, so never ask for more than fit into tofill
+  bool single = false;
+  while(n == 0)
+  {
+    auto *buffer = kernelbuffer.empty() ? reinterpret_cast<FILE_ID_FULL_DIR_INFORMATION *>(tofill._kernel_buffer.get()) : reinterpret_cast<FILE_ID_FULL_DIR_INFORMATION *>(kernelbuffer.data());
+    size_t bytes = kernelbuffer.empty() ? tofill._kernel_buffer_size : kernelbuffer.size();
+    if(!single && bytes > tofill.size() * min_entry_size)
+    {
+      bytes = tofill.size() * min_entry_size;
+    }
+    IO_STATUS_BLOCK isb = make_iostatus();
+    NTSTATUS ntstat = NtQueryDirectoryFile(_v.h, nullptr, nullptr, nullptr, &isb, buffer, static_cast<ULONG>(bytes), FileIdFullDirectoryInformation, single ? TRUE : FALSE, glob.empty() ? nullptr : &_glob, cursor.position == 0 ? TRUE : FALSE);
+    if(STATUS_PENDING == ntstat)
+    {
+      ntstat = ntwait(_v.h, isb, deadline());
+    }
+    if(STATUS_NO_MORE_FILES == ntstat)
+    {
+      cursor.done = true;
+      break;
+    }
+    if(STATUS_BUFFER_OVERFLOW == ntstat && !single)
+    {
+      // The next entry is larger than our limit, so fetch it alone
+      single = true;
+      continue;
+    }
+    if(kernelbuffer.empty() && STATUS_BUFFER_OVERFLOW == ntstat)
+    {
+      tofill._kernel_buffer.reset();
+      size_t toallocate = tofill._kernel_buffer_size * 2;
+      auto *mem = new(std::nothrow) char[toallocate];
+      if(mem == nullptr)
+      {
+        return std::errc::not_enough_memory;
+      }
+      tofill._kernel_buffer = std::unique_ptr<char[]>(mem);
+      tofill._kernel_buffer_size = toallocate;
+      continue;
+    }
+    if(ntstat < 0)
+    {
+      return {static_cast<int>(ntstat), ntkernel_category()};
+    }
+    single = false;
+    for(FILE_ID_FULL_DIR_INFORMATION *ffdi = buffer;; ffdi = reinterpret_cast<FILE_ID_FULL_DIR_INFORMATION *>(reinterpret_cast<uintptr_t>(ffdi) + ffdi->NextEntryOffset))
+    {
+      ++cursor.position;
+      size_t length = ffdi->FileNameLength / sizeof(wchar_t);
+      bool skip = (length <= 2 && '.' == ffdi->FileName[0] && (1 == length || '.' == ffdi->FileName[1]));
+      if(!skip)
+      {
+        // Try to zero terminate leafnames where possible for later efficiency
+        if(reinterpret_cast<uintptr_t>(ffdi->FileName + length) + sizeof(wchar_t) <= reinterpret_cast<uintptr_t>(ffdi) + ffdi->NextEntryOffset)
+        {
+          ffdi->FileName[length] = 0;
+        }
+        directory_entry &item = tofill[n];
+        item.leafname = path_view(wstring_view(ffdi->FileName, length));
+        skip = (filtering == filter::fastdeleted && item.leafname.is_afio_deleted());
+      }
+      if(!skip)
+      {
+        directory_entry &item = tofill[n];
+        item.stat = stat_t(nullptr);
+        item.stat.st_ino = ffdi->FileId.QuadPart;
+        item.stat.st_type = to_st_type(ffdi->FileAttributes, ffdi->ReparsePointTag);
+        item.stat.st_atim = to_timepoint(ffdi->LastAccessTime);
+        item.stat.st_mtim = to_timepoint(ffdi->LastWriteTime);
+        item.stat.st_ctim = to_timepoint(ffdi->ChangeTime);
+        item.stat.st_size = ffdi->EndOfFile.QuadPart;
+        item.stat.st_allocated = ffdi->AllocationSize.QuadPart;
+        item.stat.st_birthtim = to_timepoint(ffdi->CreationTime);
+        item.stat.st_sparse = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) != 0u);
+        item.stat.st_compressed = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_COMPRESSED) != 0u);
+        item.stat.st_reparse_point = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0u);
+        n++;
+      }
+      if(ffdi->NextEntryOffset == 0u)
+      {
+        break;
+      }
+    }
+  }
+  tofill._resize(n);
+  return enumerate_info{std::move(tofill), default_stat_contents, cursor.done, cursor.version};
+}
+
+result<directory_handle::enumerate_info> directory_handle::enumerate(enumerate_cursor &cursor, buffers_type &&tofill, const glob_pattern &glob, filter filtering, span<char> kernelbuffer) const noexcept
+{
+  // The kernel does the matching
+  return enumerate(cursor, std::move(tofill), glob.pattern(), filtering, kernelbuffer);
+}
+
+result<directory_handle::version_token> directory_handle::version() const noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  AFIO_LOG_FUNCTION_CALL(this);
+  version_token ret;
+  // Read the clock first, as a change after it could land in the same tick as the times read
+  auto now = std::chrono::system_clock::now();
+  IO_STATUS_BLOCK isb = make_iostatus();
+  FILE_BASIC_INFORMATION fbi{};
+  NTSTATUS ntstat = NtQueryInformationFile(_v.h, &isb, &fbi, sizeof(fbi), FileBasicInformation);
+  if(STATUS_PENDING == ntstat)
+  {
+    ntstat = ntwait(_v.h, isb, deadline());
+  }
+  if(ntstat < 0)
+  {
+    return {static_cast<int>(ntstat), ntkernel_category()};
+  }
+  ret.mtim = to_timepoint(fbi.LastWriteTime);
+  ret.ctim = to_timepoint(fbi.ChangeTime);
+  ret.stable = now - (std::max)(ret.mtim, ret.ctim) >= std::chrono::seconds(2);
+  return ret;
+}
+
+result<bool> directory_handle::unchanged_since(const version_token &token) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!token.stable)
+  {
+    return false;
+  }
+  OUTCOME_TRY(now, version());
+  return now.mtim == token.mtim && now.ctim == token.ctim;
+}
+
+result<stat_t::want> directory_handle::fill_stat(span<buffer_type> entries, stat_t::want wanted, bool /*unused*/) const noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  AFIO_LOG_FUNCTION_CALL(this);
+  // Windows can only stat an open handle, so open each entry just for reading its attributes
+  DWORD fileshare = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+  for(buffer_type &entry : entries)
+  {
+    path_view::c_str zpath(entry.leafname, true);
+    UNICODE_STRING _path{};
+    _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
+    _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
+    OBJECT_ATTRIBUTES oa{};
+    memset(&oa, 0, sizeof(oa));
+    oa.Length = sizeof(OBJECT_ATTRIBUTES);
+    oa.ObjectName = &_path;
+    oa.RootDirectory = _v.h;
+    oa.Attributes = 0x40 /*OBJ_CASE_INSENSITIVE*/;
+    native_handle_type nativeh;
+    nativeh.behaviour |= native_handle_type::disposition::file;
+    IO_STATUS_BLOCK isb = make_iostatus();
+    NTSTATUS ntstat = NtOpenFile(&nativeh.h, FILE_READ_ATTRIBUTES | SYNCHRONIZE, &oa, &isb, fileshare, 0x00200000 /*FILE_OPEN_REPARSE_POINT*/ | 0x20 /*FILE_SYNCHRONOUS_IO_NONALERT*/);
+    if(STATUS_PENDING == ntstat)
+    {
+      ntstat = ntwait(nativeh.h, isb, deadline());
+    }
+    if(STATUS_OBJECT_NAME_NOT_FOUND == ntstat)
+    {
+      entry.stat.st_type = filesystem::file_type::not_found;
+      continue;
+    }
+    if(ntstat < 0)
+    {
+      return {static_cast<int>(ntstat), ntkernel_category()};
+    }
+    handle h(nativeh, caching::all);
+    OUTCOME_TRYV(entry.stat.fill(h, wanted));
+  }
+  return wanted;
+}
+
+size_t directory_handle::mutate(span<mutation> mutations, bool stop_on_failure) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  // Windows can only relink or unlink an open handle, so each entry is opened relative to this directory
+  auto apply = [this](const mutation &m) -> result<void> {
+    switch(m.op)
+    {
+    case mutation::operation::create_file:
+    {
+      OUTCOME_TRY(fh, file_handle::file(*this, m.leafname, file_handle::mode::write, file_handle::creation::only_if_not_exist, file_handle::caching::all));
+      return fh.close();
+    }
+    case mutation::operation::create_directory:
+    {
+      OUTCOME_TRY(dh, directory(*this, m.leafname, mode::write, creation::only_if_not_exist));
+      return dh.close();
+    }
+    case mutation::operation::unlink_file:
+    {
+      OUTCOME_TRY(fh, file_handle::file(*this, m.leafname, file_handle::mode::write, file_handle::creation::open_existing, file_handle::caching::all));
+      return fh.unlink();
+    }
+    case mutation::operation::unlink_directory:
+    {
+      OUTCOME_TRY(dh, directory(*this, m.leafname, mode::write));
+      return dh.unlink();
+    }
+    case mutation::operation::relink:
+    {
+      auto fh = file_handle::file(*this, m.leafname, file_handle::mode::write, file_handle::creation::open_existing, file_handle::caching::all);
+      if(fh)
+      {
+        return fh.value().relink(*this, m.newpath, m.atomic_replace);
+      }
+      // Perhaps it is a directory
+      OUTCOME_TRY(dh, directory(*this, m.leafname, mode::write));
+      return dh.relink(*this, m.newpath, m.atomic_replace);
+    }
+    }
+    return std::errc::invalid_argument;
+  };
+  size_t succeeded = 0;
+  bool failed = false;
+  for(mutation &m : mutations)
+  {
+    if(failed && stop_on_failure)
+    {
+      m.status = error_info(std::errc::operation_canceled);
+      continue;
+    }
+    m.status = apply(m);
+    if(m.status)
+    {
+      ++succeeded;
+    }
+    else
+    {
+      failed = true;
     }
   }
+  return succeeded;
 }
 
 AFIO_V2_NAMESPACE_END
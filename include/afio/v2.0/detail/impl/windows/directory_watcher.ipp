@@ -0,0 +1,71 @@
+/* Watches directories for changes
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../../directory_watcher.hpp"
+#include "import.hpp"
+
+AFIO_V2_NAMESPACE_BEGIN
+
+// ReadDirectoryChangesW() would need its own i/o completion machinery, so is not implemented yet
+struct directory_watcher::_state
+{
+};
+
+directory_watcher::directory_watcher(std::unique_ptr<_state> s) noexcept : _s(std::move(s)) {}
+directory_watcher::directory_watcher() noexcept {}  // NOLINT
+directory_watcher::directory_watcher(directory_watcher &&o) noexcept : _s(std::move(o._s)) {}
+directory_watcher::~directory_watcher() = default;
+
+result<directory_watcher> directory_watcher::watch(io_service & /*unused*/, const path_handle & /*unused*/, directory_watcher::path_view_type /*unused*/, directory_watcher::event /*unused*/, bool /*unused*/, size_t /*unused*/) noexcept
+{
+  return std::errc::not_supported;
+}
+
+io_service *directory_watcher::service() const noexcept
+{
+  return nullptr;
+}
+
+size_t directory_watcher::watches() const noexcept
+{
+  return 0;
+}
+
+result<void> directory_watcher::close() noexcept
+{
+  _s.reset();
+  return success();
+}
+
+result<directory_watcher::records_type> directory_watcher::read(deadline /*unused*/) noexcept
+{
+  return std::errc::not_supported;
+}
+
+result<void> directory_watcher::_async_read(completion_type && /*unused*/) noexcept
+{
+  return std::errc::not_supported;
+}
+
+AFIO_V2_NAMESPACE_END
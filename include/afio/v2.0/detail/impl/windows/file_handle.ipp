@@ -474,4 +474,88 @@ result<file_handle::extent_type> file_handle::zero(file_handle::extent_type offs
   return success();
 }
 
+result<file_handle::extent_type> file_handle::send_to(native_handle_type dest, file_handle::extent_type offset, file_handle::extent_type bytes, deadline d) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!dest.is_valid())
+  {
+    return std::errc::bad_file_descriptor;
+  }
+  std::chrono::steady_clock::time_point began_steady;
+  std::chrono::system_clock::time_point end_utc;
+  if(d)
+  {
+    if(d.steady)
+    {
+      began_steady = std::chrono::steady_clock::now();
+    }
+    else
+    {
+      end_utc = d.to_time_point();
+    }
+  }
+  // Blocking writes cannot be interrupted, so the deadline is checked between them
+  auto expired = [&]() -> bool {
+    if(!d)
+    {
+      return false;
+    }
+    if(d.steady)
+    {
+      return std::chrono::steady_clock::now() >= began_steady + std::chrono::nanoseconds(d.nsecs);
+    }
+    return std::chrono::system_clock::now() >= end_utc;
+  };
+  // TransmitFile() would need Winsock and only works for sockets, so emulate with a bounce buffer
+  try
+  {
+    extent_type ret = 0;
+    // Don't rely on short reads to find the end of the file
+    OUTCOME_TRY(length, this->length());
+    if(offset >= length)
+    {
+      return ret;
+    }
+    bytes = std::min(bytes, length - offset);
+    auto blocksize = utils::file_buffer_default_size();
+    char *buffer = utils::page_allocator<char>().allocate(blocksize);
+    auto unbufferh = undoer([buffer, blocksize] { utils::page_allocator<char>().deallocate(buffer, blocksize); });
+    (void) unbufferh;
+    while(bytes > 0)
+    {
+      if(ret > 0 && expired())
+      {
+        return ret;
+      }
+      auto toread = (bytes < blocksize) ? static_cast<size_t>(bytes) : blocksize;
+      // Synchronous handles cannot take a deadline for reads
+      OUTCOME_TRY(readed, read(offset, buffer, toread));
+      const char *p = readed.data;
+      size_t togo = readed.len;
+      while(togo > 0)
+      {
+        DWORD written = 0;
+        if(WriteFile(dest.h, p, static_cast<DWORD>(togo), &written, nullptr) == 0)
+        {
+          return {GetLastError(), std::system_category()};
+        }
+        p += written;
+        togo -= written;
+      }
+      offset += readed.len;
+      bytes -= readed.len;
+      ret += readed.len;
+      if(readed.len < toread)
+      {
+        break;
+      }
+    }
+    return ret;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
 AFIO_V2_NAMESPACE_END
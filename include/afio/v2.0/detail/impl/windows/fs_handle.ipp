@@ -246,4 +246,29 @@ result<void> fs_handle::unlink(deadline d) noexcept
   return success();
 }
 
+result<void> fs_handle::exchange(fs_handle & /*unused*/, deadline /*unused*/) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  // NTFS has no means of atomically exchanging two names
+  return std::errc::not_supported;
+}
+
+// Renaming and unlinking are already race free by handle on Windows, so the containing directory is not needed
+result<bool> fs_handle::_relink_entry(const handle & /*unused*/, path_view_type /*unused*/, const path_handle &base, path_view_type path, bool atomic_replace) noexcept
+{
+  OUTCOME_TRYV(fs_handle::relink(base, path, atomic_replace));
+  return true;
+}
+
+result<bool> fs_handle::_unlink_entry(const handle & /*unused*/, path_view_type /*unused*/) noexcept
+{
+  OUTCOME_TRYV(fs_handle::unlink());
+  return true;
+}
+
+result<bool> fs_handle::_exchange_entries(const handle & /*unused*/, path_view_type /*unused*/, const fs_handle & /*unused*/, const handle & /*unused*/, path_view_type /*unused*/) noexcept
+{
+  return std::errc::not_supported;
+}
+
 AFIO_V2_NAMESPACE_END
@@ -163,6 +163,12 @@ namespace windows_nt_kernel
 #endif
 #ifndef STATUS_BUFFER_OVERFLOW
 #define STATUS_BUFFER_OVERFLOW ((NTSTATUS) 0x80000005)
+#endif
+#ifndef STATUS_NO_MORE_FILES
+#define STATUS_NO_MORE_FILES ((NTSTATUS) 0x80000006)
+#endif
+#ifndef STATUS_OBJECT_NAME_NOT_FOUND
+#define STATUS_OBJECT_NAME_NOT_FOUND ((NTSTATUS) 0xC0000034)
 #endif
 
   // From http://msdn.microsoft.com/en-us/library/windows/hardware/ff550671(v=vs.85).aspx
@@ -59,6 +59,11 @@ result<section_handle> section_handle::section(file_handle &backing, extent_type
 {
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
+  // Large page sections need SEC_LARGE_PAGES, which only works for page file backed sections
+  if(_flag & flag::page_sizes_3)
+  {
+    return std::errc::not_supported;
+  }
   result<section_handle> ret(section_handle(native_handle_type(), &backing, file_handle(), _flag));
   native_handle_type &nativeh = ret.value()._v;
   ULONG prot = 0, attribs = 0;
@@ -158,6 +163,11 @@ result<section_handle> section_handle::section(extent_type bytes, const path_han
 {
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
+  // Large page sections need SEC_LARGE_PAGES, which only works for page file backed sections
+  if(_flag & flag::page_sizes_3)
+  {
+    return std::errc::not_supported;
+  }
   OUTCOME_TRY(_anonh, file_handle::temp_inode(dirh));
   OUTCOME_TRYV(_anonh.truncate(bytes));
   result<section_handle> ret(section_handle(native_handle_type(), nullptr, std::move(_anonh), _flag));
@@ -376,6 +386,8 @@ map_handle::~map_handle()
       abort();
     }
   }
+  _wait_async_barriers();
+  delete _faults;
 }
 
 result<void> map_handle::close() noexcept
@@ -383,6 +395,8 @@ result<void> map_handle::close() noexcept
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
   AFIO_LOG_FUNCTION_CALL(this);
+  // Barriers in flight refer to the pages and the backing file
+  _wait_async_barriers();
   if(_addr != nullptr)
   {
     if(_section != nullptr)
@@ -415,6 +429,7 @@ result<void> map_handle::close() noexcept
 native_handle_type map_handle::release() noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
+  _wait_async_barriers();
   // We don't want ~handle() to close our borrowed handle
   _v = native_handle_type();
   _addr = nullptr;
@@ -456,7 +471,7 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::barrier(map_ha
 }
 
 
-result<map_handle> map_handle::map(size_type bytes, section_handle::flag _flag) noexcept
+result<map_handle> map_handle::map(size_type bytes, section_handle::flag _flag, utils::numa_policy numa) noexcept
 {
   bytes = win32_round_up_to_allocation_size(bytes);
   result<map_handle> ret(map_handle(nullptr));
@@ -467,15 +482,42 @@ result<map_handle> map_handle::map(size_type bytes, section_handle::flag _flag)
     size_t commitsize;
     win32_map_flags(nativeh, allocation, prot, commitsize, true, _flag);
   }
+  size_t pagesize = utils::page_size();
+  if(_flag & section_handle::flag::page_sizes_3)
+  {
+    // Windows has exactly one large page size, and large pages cannot be reserved without being committed
+    if(!!(_flag & section_handle::flag::page_sizes_2) || allocation != (MEM_RESERVE | MEM_COMMIT))
+    {
+      return std::errc::not_supported;
+    }
+    try
+    {
+      auto pagesizes(utils::page_sizes(false));
+      if(pagesizes.size() < 2)
+      {
+        return std::errc::invalid_argument;
+      }
+      pagesize = pagesizes[1];
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+    bytes = utils::round_up_to_page_size(bytes, pagesize);
+    allocation |= MEM_LARGE_PAGES;
+  }
+  OUTCOME_TRY(node, utils::detail::win32_numa_node(numa));
   AFIO_LOG_FUNCTION_CALL(&ret);
-  addr = VirtualAlloc(nullptr, bytes, allocation, prot);
+  addr = VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, allocation, prot, node);
   if(addr == nullptr)
   {
     return {GetLastError(), std::system_category()};
   }
+  ret.value()._flag = _flag;
   ret.value()._addr = static_cast<char *>(addr);
   ret.value()._reservation = bytes;
   ret.value()._length = bytes;
+  ret.value()._pagesize = pagesize;
 
   // Windows has no way of getting the kernel to prefault maps on creation, so ...
   if(_flag & section_handle::flag::prefault)
@@ -498,7 +540,7 @@ result<map_handle> map_handle::map(size_type bytes, section_handle::flag _flag)
   return ret;
 }
 
-result<map_handle> map_handle::map(section_handle &section, size_type bytes, extent_type offset, section_handle::flag _flag) noexcept
+result<map_handle> map_handle::map(section_handle &section, size_type bytes, extent_type offset, section_handle::flag _flag, utils::numa_policy /*unused*/) noexcept
 {
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
@@ -510,6 +552,8 @@ result<map_handle> map_handle::map(section_handle &section, size_type bytes, ext
   LARGE_INTEGER _offset{};
   _offset.QuadPart = offset;
   SIZE_T _bytes = win32_round_up_to_allocation_size(bytes);  // reserve to next 64Kb boundary
+  _flag |= section.section_flags() & section_handle::flag::barrier_on_close;
+  ret.value()._flag = _flag;
   win32_map_flags(nativeh, allocation, prot, commitsize, section.backing() != nullptr, _flag);
   AFIO_LOG_FUNCTION_CALL(&ret);
   NTSTATUS ntstat = NtMapViewOfSection(section.native_handle().h, GetCurrentProcess(), &addr, 0, commitsize, &_offset, &_bytes, ViewUnmap, allocation, prot);
@@ -544,7 +588,18 @@ result<map_handle> map_handle::map(section_handle &section, size_type bytes, ext
   return ret;
 }
 
-result<map_handle::size_type> map_handle::truncate(size_type newsize, bool /* unused */) noexcept
+result<map_handle> map_handle::map_lazy(size_type /*unused*/, lazy_fill_type /*unused*/, size_type /*unused*/) noexcept
+{
+  // Windows has no equivalent of userfaultfd, and vectored exception handlers can't service faults taken by the kernel
+  return std::errc::not_supported;
+}
+
+result<void> map_handle::lazy_status() const noexcept
+{
+  return success();
+}
+
+result<map_handle::size_type> map_handle::truncate(size_type newsize, bool permit_relocation) noexcept
 {
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
@@ -554,6 +609,11 @@ result<map_handle::size_type> map_handle::truncate(size_type newsize, bool /* un
   {
     return success();
   }
+  if(permit_relocation && _addr != nullptr && newsize != 0)
+  {
+    OUTCOME_TRY(region, relocate(newsize));
+    return region.len;
+  }
   // Is this VirtualAlloc() allocated memory?
   if(_section == nullptr)
   {
@@ -622,6 +682,63 @@ result<map_handle::size_type> map_handle::truncate(size_type newsize, bool /* un
   return _reservation;
 }
 
+result<map_handle::buffer_type> map_handle::relocate(size_type newsize) noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(_addr == nullptr || newsize == 0)
+  {
+    return std::errc::invalid_argument;
+  }
+  newsize = win32_round_up_to_allocation_size(newsize);
+  if(newsize == _reservation)
+  {
+    return buffer_type{_addr, _reservation};
+  }
+  // Windows has no equivalent to mremap(), so try to resize in place first
+  if(truncate(newsize, false))
+  {
+    return buffer_type{_addr, _reservation};
+  }
+  // Only a view of a shared section can be recreated elsewhere without copying its contents
+  if(_section == nullptr || (_flag & section_handle::flag::cow))
+  {
+    return std::errc::not_supported;
+  }
+  OUTCOME_TRY(length, _section->length());  // length of the backing file
+  ULONG allocation = MEM_RESERVE, prot;
+  PVOID addr = nullptr;
+  size_t commitsize = newsize;
+  LARGE_INTEGER offset{};
+  offset.QuadPart = _offset;
+  SIZE_T _bytes = newsize;
+  native_handle_type nativeh;
+  win32_map_flags(nativeh, allocation, prot, commitsize, _section->backing() != nullptr, _flag);
+  NTSTATUS ntstat = NtMapViewOfSection(_section->native_handle().h, GetCurrentProcess(), &addr, 0, commitsize, &offset, &_bytes, ViewUnmap, allocation, prot);
+  if(ntstat < 0)
+  {
+    return {static_cast<int>(ntstat), ntkernel_category()};
+  }
+  auto unmapped = win32_maps_apply(_addr, _reservation, [](char *addr, size_t /* unused */) -> result<void> {
+    NTSTATUS ntstat = NtUnmapViewOfSection(GetCurrentProcess(), addr);
+    if(ntstat < 0)
+    {
+      return {ntstat, ntkernel_category()};
+    }
+    return success();
+  });
+  if(!unmapped)
+  {
+    NtUnmapViewOfSection(GetCurrentProcess(), addr);
+    return unmapped.error();
+  }
+  _addr = static_cast<char *>(addr);
+  _reservation = _bytes;
+  _length = (length - _offset < newsize) ? (length - _offset) : newsize;  // length of backing, not reservation
+  return buffer_type{_addr, _reservation};
+}
+
 result<map_handle::buffer_type> map_handle::commit(buffer_type region, section_handle::flag flag) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
@@ -732,6 +849,27 @@ result<span<map_handle::buffer_type>> map_handle::prefetch(span<buffer_type> reg
   return regions;
 }
 
+result<map_handle::buffer_type> map_handle::populate(buffer_type region, bool /*unused*/) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(0);
+  if(region.data == nullptr)
+  {
+    return std::errc::invalid_argument;
+  }
+  char *end = utils::round_up_to_page_size(region.data + region.len);
+  region.data = utils::round_down_to_page_size(region.data);
+  region.len = end - region.data;
+  // Have the kernel read in the pages with large i/o where it can, then fault every page into the process
+  (void) prefetch(region);
+  size_t pagesize = utils::page_size();
+  volatile auto *a = static_cast<volatile char *>(region.data);
+  for(size_t n = 0; n < region.len; n += pagesize)
+  {
+    a[n];
+  }
+  return region;
+}
+
 result<map_handle::buffer_type> map_handle::do_not_store(buffer_type region) noexcept
 {
   windows_nt_kernel::init();
@@ -772,6 +910,240 @@ result<map_handle::buffer_type> map_handle::do_not_store(buffer_type region) noe
   return region;
 }
 
+void map_handle::_fault_counts(uint64_t &major, uint64_t &minor) noexcept
+{
+  // Windows only counts faults per process, and does not distinguish soft from hard faults
+  struct PROCESS_MEMORY_COUNTERS_
+  {
+    DWORD cb;
+    DWORD PageFaultCount;
+    SIZE_T PeakWorkingSetSize, WorkingSetSize, QuotaPeakPagedPoolUsage, QuotaPagedPoolUsage, QuotaPeakNonPagedPoolUsage, QuotaNonPagedPoolUsage, PagefileUsage, PeakPagefileUsage;
+  };
+  using K32GetProcessMemoryInfo_t = BOOL(WINAPI *)(HANDLE Process, PROCESS_MEMORY_COUNTERS_ * ppsmemCounters, DWORD cb);
+  static auto K32GetProcessMemoryInfo_ = reinterpret_cast<K32GetProcessMemoryInfo_t>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "K32GetProcessMemoryInfo"));
+  PROCESS_MEMORY_COUNTERS_ pmc{};
+  pmc.cb = sizeof(pmc);
+  major = minor = 0;
+  if(K32GetProcessMemoryInfo_ != nullptr && K32GetProcessMemoryInfo_(GetCurrentProcess(), &pmc, sizeof(pmc)) != 0)
+  {
+    minor = pmc.PageFaultCount;
+  }
+}
+
+result<void> map_handle::set_fault_accounting(bool enable) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!enable)
+  {
+    delete _faults;
+    _faults = nullptr;
+    return success();
+  }
+  if(_faults == nullptr)
+  {
+    _faults = new(std::nothrow) _fault_counters;
+    if(_faults == nullptr)
+    {
+      return std::errc::not_enough_memory;
+    }
+  }
+  return success();
+}
+
+result<map_handle::page_statistics_type> map_handle::page_statistics(buffer_type region) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(region.data == nullptr)
+  {
+    if(_addr == nullptr)
+    {
+      return std::errc::invalid_argument;
+    }
+    region = {_addr, _length};
+  }
+  const size_type pagesize = page_size();
+  char *end = utils::round_up_to_page_size(region.data + region.len, pagesize);
+  region.data = utils::round_down_to_page_size(region.data, pagesize);
+  region.len = end - region.data;
+  page_statistics_type ret;
+  ret.pages = region.len / pagesize;
+  ret.dirty_pages = static_cast<size_type>(-1);  // Windows provides no way of asking
+  struct PSAPI_WORKING_SET_EX_INFORMATION_
+  {
+    PVOID VirtualAddress;
+    ULONG_PTR VirtualAttributes;  // bit 0 is Valid i.e. resident in this process' working set
+  };
+  using K32QueryWorkingSetEx_t = BOOL(WINAPI *)(HANDLE hProcess, PVOID pv, DWORD cb);
+  static auto K32QueryWorkingSetEx_ = reinterpret_cast<K32QueryWorkingSetEx_t>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "K32QueryWorkingSetEx"));
+  if(K32QueryWorkingSetEx_ == nullptr)
+  {
+    return std::errc::function_not_supported;
+  }
+  // QueryWorkingSetEx() reports large pages against their first small page only, so query every large page
+  PSAPI_WORKING_SET_EX_INFORMATION_ wsi[512];
+  for(size_type offset = 0; offset < region.len;)
+  {
+    size_t count = 0;
+    for(; count < sizeof(wsi) / sizeof(wsi[0]) && offset < region.len; count++, offset += pagesize)
+    {
+      wsi[count].VirtualAddress = region.data + offset;
+      wsi[count].VirtualAttributes = 0;
+    }
+    if(K32QueryWorkingSetEx_(GetCurrentProcess(), wsi, static_cast<DWORD>(count * sizeof(wsi[0]))) == 0)
+    {
+      return {GetLastError(), std::system_category()};
+    }
+    for(size_t n = 0; n < count; n++)
+    {
+      if((wsi[n].VirtualAttributes & 1) != 0)
+      {
+        ret.resident_pages++;
+      }
+    }
+  }
+  if(_faults != nullptr)
+  {
+    ret.major_faults = _faults->major.load(std::memory_order_relaxed);
+    ret.minor_faults = _faults->minor.load(std::memory_order_relaxed);
+  }
+  return ret;
+}
+
+result<void> map_handle::set_numa_policy(utils::numa_policy policy, buffer_type region, bool move_existing) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(region.data == nullptr)
+  {
+    if(_addr == nullptr)
+    {
+      return std::errc::invalid_argument;
+    }
+    region = {_addr, _reservation};
+  }
+  // Windows can only place memory when it is allocated, so this fails for anything but the default policy
+  return utils::apply_numa_policy(region.data, region.len, policy, move_existing);
+}
+
+result<std::vector<map_handle::size_type>> map_handle::numa_distribution(buffer_type region) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(region.data == nullptr)
+  {
+    if(_addr == nullptr)
+    {
+      return std::errc::invalid_argument;
+    }
+    region = {_addr, _length};
+  }
+  const size_type pagesize = page_size();
+  char *end = utils::round_up_to_page_size(region.data + region.len, pagesize);
+  region.data = utils::round_down_to_page_size(region.data, pagesize);
+  region.len = end - region.data;
+  struct PSAPI_WORKING_SET_EX_INFORMATION_
+  {
+    PVOID VirtualAddress;
+    ULONG_PTR VirtualAttributes;  // bit 0 is Valid, bits 16-21 are the NUMA node of a valid page
+  };
+  using K32QueryWorkingSetEx_t = BOOL(WINAPI *)(HANDLE hProcess, PVOID pv, DWORD cb);
+  static auto K32QueryWorkingSetEx_ = reinterpret_cast<K32QueryWorkingSetEx_t>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "K32QueryWorkingSetEx"));
+  if(K32QueryWorkingSetEx_ == nullptr)
+  {
+    return std::errc::function_not_supported;
+  }
+  try
+  {
+    std::vector<size_type> ret;
+    PSAPI_WORKING_SET_EX_INFORMATION_ wsi[512];
+    for(size_type offset = 0; offset < region.len;)
+    {
+      size_t count = 0;
+      for(; count < sizeof(wsi) / sizeof(wsi[0]) && offset < region.len; count++, offset += pagesize)
+      {
+        wsi[count].VirtualAddress = region.data + offset;
+        wsi[count].VirtualAttributes = 0;
+      }
+      if(K32QueryWorkingSetEx_(GetCurrentProcess(), wsi, static_cast<DWORD>(count * sizeof(wsi[0]))) == 0)
+      {
+        return {GetLastError(), std::system_category()};
+      }
+      for(size_t n = 0; n < count; n++)
+      {
+        if((wsi[n].VirtualAttributes & 1) != 0)
+        {
+          auto node = static_cast<size_t>((wsi[n].VirtualAttributes >> 16) & 63);
+          if(node >= ret.size())
+          {
+            ret.resize(node + 1);
+          }
+          ret[node]++;
+        }
+      }
+    }
+    return ret;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+result<void> map_handle::async_barrier_state::_start() noexcept
+{
+  // FlushViewOfFile() waits for the writes it issues, so it is done by the background thread
+  return success();
+}
+
+result<void> map_handle::async_barrier_state::_finish() noexcept
+{
+  // Anonymous memory has nowhere durable to go
+  if(_backing == nullptr)
+  {
+    return success();
+  }
+  OUTCOME_TRYV(win32_maps_apply(_region.data, _region.len, [](char *addr, size_t bytes) -> result<void> {
+    if(FlushViewOfFile(addr, static_cast<SIZE_T>(bytes)) == 0)
+    {
+      return {GetLastError(), std::system_category()};
+    }
+    return success();
+  }));
+  if(_wait_for_device || _and_metadata)
+  {
+    const_buffer_type req{_region.data, _region.len};
+    OUTCOME_TRYV(_backing->barrier(io_request<const_buffers_type>(const_buffers_type(&req, 1), _offset), _wait_for_device, _and_metadata));
+  }
+  return success();
+}
+
+result<map_handle::size_type> map_handle::send_to(native_handle_type dest, extent_type offset, size_type bytes, deadline /*unused*/) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  if(!dest.is_valid())
+  {
+    return std::errc::bad_file_descriptor;
+  }
+  size_type togo = offset < _length ? static_cast<size_type>(_length - offset) : 0;
+  if(bytes > togo)
+  {
+    bytes = togo;
+  }
+  const char *addr = _addr + offset;
+  size_type ret = 0;
+  while(bytes > 0)
+  {
+    DWORD towrite = (bytes < (1U << 30U)) ? static_cast<DWORD>(bytes) : (1U << 30U);
+    DWORD written = 0;
+    if(WriteFile(dest.h, addr, towrite, &written, nullptr) == 0)
+    {
+      return {GetLastError(), std::system_category()};
+    }
+    addr += written;
+    bytes -= written;
+    ret += written;
+  }
+  return ret;
+}
+
 map_handle::io_result<map_handle::buffers_type> map_handle::read(io_request<buffers_type> reqs, deadline /*d*/) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
@@ -800,6 +1172,7 @@ map_handle::io_result<map_handle::buffers_type> map_handle::read(io_request<buff
 map_handle::io_result<map_handle::const_buffers_type> map_handle::write(io_request<const_buffers_type> reqs, deadline /*d*/) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
+  fault_scope faults(*this);
   char *addr = _addr + reqs.offset;
   size_type togo = reqs.offset < _length ? static_cast<size_type>(_length - reqs.offset) : 0;
   for(const_buffer_type &req : reqs.buffers)
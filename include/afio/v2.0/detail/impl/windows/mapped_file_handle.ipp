@@ -36,6 +36,19 @@ result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type rese
     reservation = length;
   }
   reservation = utils::round_up_to_page_size(reservation);
+  if(_address_space != 0)
+  {
+    if(reservation > _address_space)
+    {
+      return std::errc::not_enough_memory;
+    }
+    // The view always spans the whole address space, extending the section makes more of it accessible
+    if(_mh.is_valid())
+    {
+      return _reservation;
+    }
+    reservation = _address_space;
+  }
   if(!_sh.is_valid())
   {
     // Section must have read/write, as otherwise map reservation doesn't work on Windows
@@ -55,11 +68,87 @@ result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type rese
   }
   OUTCOME_TRYV(_mh.close());
   OUTCOME_TRY(mh, map_handle::map(_sh, reservation, 0, mapflags));
+  // Keep any page fault accounting across the remap
+  std::swap(mh._faults, _mh._faults);
   _mh = std::move(mh);
   _reservation = reservation;
+  if(_address_space != 0)
+  {
+    // i/o is bounded by the published length instead
+    _mh._length = _address_space;
+  }
   return reservation;
 }
 
+result<mapped_file_handle::size_type> mapped_file_handle::reserve_address_space(size_type bytes) noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRY(length, underlying_file_length());
+  bytes = utils::round_up_to_page_size(bytes);
+  if(bytes == 0 || bytes < utils::round_up_to_page_size(static_cast<size_type>(length)) || (_mh.is_valid() && bytes < _reservation))
+  {
+    return std::errc::invalid_argument;
+  }
+  // Windows cannot map a section of an empty file
+  if(length == 0)
+  {
+    return std::errc::invalid_seek;
+  }
+  _address_space = bytes;
+  OUTCOME_TRYV(_mh.close());
+  auto r = reserve(bytes);
+  if(!r)
+  {
+    _address_space = 0;
+    return r.error();
+  }
+  _published_length.store(length, std::memory_order_release);
+  return bytes;
+}
+
+result<mapped_file_handle> mapped_file_handle::snapshot(extent_type offset, extent_type bytes) const noexcept
+{
+  AFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRY(maplength, length());
+  if(offset >= maplength)
+  {
+    return std::errc::invalid_argument;
+  }
+  if(bytes == 0 || bytes > maplength - offset)
+  {
+    bytes = maplength - offset;
+  }
+  // Try to create the snapshot beside this file, so it is on the same volume
+  result<file_handle> fh_(std::errc::no_such_file_or_directory);
+  {
+    auto dirh = parent_path_handle();
+    if(dirh)
+    {
+      fh_ = file_handle::temp_inode(dirh.value());
+    }
+  }
+  if(!fh_)
+  {
+    fh_ = file_handle::temp_inode();
+  }
+  OUTCOME_TRY(fh, std::move(fh_));
+  OUTCOME_TRYV(fh.truncate(bytes));
+  // Copy the range out of the map
+  extent_type done = 0;
+  while(done < bytes)
+  {
+    OUTCOME_TRY(written, fh.write(done, _mh.address() + offset + done, static_cast<size_type>(bytes - done)));
+    if(written.len == 0)
+    {
+      return std::errc::io_error;
+    }
+    done += written.len;
+  }
+  mapped_file_handle ret(std::move(fh));
+  OUTCOME_TRYV(ret.reserve(static_cast<size_type>(bytes)));
+  return {std::move(ret)};
+}
+
 result<void> mapped_file_handle::close() noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
@@ -90,6 +179,39 @@ native_handle_type mapped_file_handle::release() noexcept
 result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type newsize) noexcept
 {
   AFIO_LOG_FUNCTION_CALL(this);
+  if(_address_space != 0)
+  {
+    if(newsize > _address_space)
+    {
+      return std::errc::not_enough_memory;
+    }
+    if(_sh.is_valid())
+    {
+      OUTCOME_TRY(size, _sh.length());
+      if(newsize >= size)
+      {
+        // Extending the section maps the added extents into our view in place
+        OUTCOME_TRYV(file_handle::truncate(newsize));
+        if(newsize > size)
+        {
+          OUTCOME_TRYV(_sh.truncate(newsize));
+        }
+        _published_length.store(newsize, std::memory_order_release);
+        return newsize;
+      }
+      // Windows cannot shrink a file with a section open upon it, so the map must move
+      _published_length.store(newsize, std::memory_order_release);
+      OUTCOME_TRYV(_mh.close());
+      OUTCOME_TRYV(_sh.close());
+    }
+    OUTCOME_TRYV(file_handle::truncate(newsize));
+    if(newsize != 0)
+    {
+      OUTCOME_TRYV(reserve(_address_space));
+    }
+    _published_length.store(newsize, std::memory_order_release);
+    return newsize;
+  }
   // Release all maps and sections and truncate the backing file to zero
   if(newsize == 0)
   {
@@ -136,7 +258,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
     size = newsize;
   }
   // Adjust the map to reflect the new size of the section
-  _mh._length = size;
+  _publish_length(size);
   return newsize;
 }
 
@@ -150,6 +272,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
   }
   if(length == 0)
   {
+    _publish_length(0);
     OUTCOME_TRYV(_mh.close());
     OUTCOME_TRYV(_sh.close());
     return length;
@@ -157,6 +280,10 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
   if(!_sh.is_valid())
   {
     OUTCOME_TRYV(reserve(_reservation));
+    if(_address_space != 0)
+    {
+      _publish_length(length);
+    }
     return length;
   }
   OUTCOME_TRY(size, _sh.length());
@@ -164,13 +291,13 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
   if(size >= length)
   {
     // Section is already the same size as the file, or is as big as it can go
-    _mh._length = length;
+    _publish_length(length);
     return length;
   }
   // Nobody appears to have extended the section to match the file yet
   OUTCOME_TRYV(_sh.truncate(length));
   // Adjust the map to reflect the new size of the section
-  _mh._length = length;
+  _publish_length(length);
   return length;
 }
 
@@ -31,16 +31,23 @@ AFIO_HEADERS_ONLY_MEMFUNC_SPEC void path_view::c_str::_from_utf8(const path_view
 {
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
+  if(view._state._utf8.size() > 32768)
+  {
+    AFIO_LOG_FATAL(&view, "Attempt to send a path exceeding 64Kb to kernel");
+    abort();
+  }
+  // Each UTF-8 code unit becomes at most one UTF-16 code unit
+  wchar_t *buffer_ = _reserve(view._state._utf8.size() + 1);
   ULONG written = 0;
-  std::error_code ec(static_cast<int>(RtlUTF8ToUnicodeN(_buffer, static_cast<ULONG>(sizeof(_buffer) - sizeof(wchar_t)), &written, view._state._utf8.data(), static_cast<ULONG>(view._state._utf8.size()))), ntkernel_category());
+  std::error_code ec(static_cast<int>(RtlUTF8ToUnicodeN(buffer_, static_cast<ULONG>(view._state._utf8.size() * sizeof(wchar_t)), &written, view._state._utf8.data(), static_cast<ULONG>(view._state._utf8.size()))), ntkernel_category());
   if(ec && ec.value() < 0)
   {
     AFIO_LOG_FATAL(ec.value(), ec.message().c_str());
     abort();
   }
   length = static_cast<uint16_t>(written / sizeof(wchar_t));
-  _buffer[length] = 0;
-  wchar_t *p = _buffer;
+  buffer_[length] = 0;
+  wchar_t *p = buffer_;
   do
   {
     p = wcschr(p, '/');
@@ -49,7 +56,7 @@ AFIO_HEADERS_ONLY_MEMFUNC_SPEC void path_view::c_str::_from_utf8(const path_view
       *p = '\\';
     }
   } while(p != nullptr);
-  buffer = _buffer;
+  buffer = buffer_;
 }
 
 AFIO_V2_NAMESPACE_END
@@ -197,22 +197,65 @@ namespace utils
     return success();
   }
 
+  result<void> apply_numa_policy(void * /*unused*/, size_t /*unused*/, numa_policy policy, bool /*unused*/) noexcept
+  {
+    // Windows can only place memory when it is allocated
+    if(policy)
+    {
+      return std::errc::not_supported;
+    }
+    return success();
+  }
+
+  result<void> set_thread_numa_policy(numa_policy policy) noexcept
+  {
+    if(policy)
+    {
+      return std::errc::not_supported;
+    }
+    return success();
+  }
+
   namespace detail
   {
-    large_page_allocation allocate_large_pages(size_t bytes)
+    // Returns the preferred node of the policy, or NUMA_NO_PREFERRED_NODE
+    inline result<DWORD> win32_numa_node(numa_policy policy) noexcept
+    {
+      if(!policy)
+      {
+        return static_cast<DWORD>(-1) /*NUMA_NO_PREFERRED_NODE*/;
+      }
+      if(policy.policy == numa_policy::mode::interleave || policy.nodes == 0)
+      {
+        return std::errc::not_supported;
+      }
+      DWORD node = 0;
+      while((policy.nodes & (1ULL << node)) == 0)
+      {
+        node++;
+      }
+      return node;
+    }
+
+    large_page_allocation allocate_large_pages(size_t bytes, numa_policy numa)
     {
       large_page_allocation ret(calculate_large_page_allocation(bytes));
+      auto node = win32_numa_node(numa);
+      if(!node)
+      {
+        return ret;
+      }
       DWORD type = MEM_COMMIT | MEM_RESERVE;
       if(ret.page_size_used > 65536)
       {
         type |= MEM_LARGE_PAGES;
       }
-      ret.p = VirtualAlloc(nullptr, ret.actual_size, type, PAGE_READWRITE);
+      ret.p = VirtualAllocExNuma(GetCurrentProcess(), nullptr, ret.actual_size, type, PAGE_READWRITE, node.value());
       if(ret.p == nullptr)
       {
         if(ERROR_NOT_ENOUGH_MEMORY == GetLastError())
         {
-          ret.p = VirtualAlloc(nullptr, ret.actual_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+          ret.p = VirtualAllocExNuma(GetCurrentProcess(), nullptr, ret.actual_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, node.value());
         }
       }
 #ifndef NDEBUG
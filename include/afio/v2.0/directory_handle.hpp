@@ -25,6 +25,7 @@ Distributed under the Boost Software License, Version 1.0.
 #ifndef AFIO_DIRECTORY_HANDLE_H
 #define AFIO_DIRECTORY_HANDLE_H
 
+#include "glob_pattern.hpp"
 #include "path_discovery.hpp"
 #include "stat.hpp"
 
@@ -259,6 +260,25 @@ public:
   result<void> unlink(deadline d = std::chrono::seconds(30)) noexcept override;
 #endif
 
+  /*! \brief A token identifying a version of the entries of a directory, see `version()` and `unchanged_since()`.
+
+  The token is the modification and status change times of the directory, which the kernel updates
+  whenever an entry is created, removed or renamed, but not when the contents or metadata of an entry
+  change. The status change time cannot be set by users, so setting the modification time back does
+  not hide a change. As timestamps have limited granularity, a change in the same tick as the token was
+  taken cannot be told apart from no change, so a token taken within two seconds of the directory last
+  changing is not `stable`, and is never considered unchanged. Two seconds covers the coarsest
+  timestamps in common use, those of FAT.
+  */
+  struct version_token
+  {
+    //! The modification time of the directory when the token was taken
+    std::chrono::system_clock::time_point mtim;
+    //! The status change time of the directory when the token was taken
+    std::chrono::system_clock::time_point ctim;
+    //! False if the directory changed too recently for its times to be trusted, or the token was never taken
+    bool stable{false};
+  };
   //! Completion information for `enumerate()`
   struct enumerate_info
   {
@@ -268,23 +288,173 @@ public:
     stat_t::want metadata;
     //! Whether the directory was entirely read or not.
     bool done;
+    //! The version of the directory taken before any entry was read, so `unchanged_since()` this
+    //! token is false if the directory changed during or after the enumeration. Not taken if the glob
+    //! matches a single entry.
+    version_token version{};
   };
   /*! Fill the buffers type with as many directory entries as will fit.
 
   \return Returns the buffers filled, what metadata was filled in and whether the entire directory
   was read into `tofill`.
   \param tofill The buffers to fill, returned to you on exit.
-  \param glob An optional shell glob by which to filter the items filled. Done kernel side on Windows, user side on POSIX.
+  \param glob An optional shell glob by which to filter the items filled. Done kernel side on Windows, user side on POSIX,
+  where a glob containing wildcards is compiled into a `glob_pattern` each call.
   \param filtering Whether to filter out fake-deleted files on Windows or not.
   \param kernelbuffer A buffer to use for the kernel to fill. If left defaulted, a kernel buffer
   is allocated internally and stored into `tofill` which needs to not be destructed until one
   is no longer using any items within (leafnames are views onto the original kernel data).
   \errors todo
-  \mallocs If the `kernelbuffer` parameter is set on entry, no memory allocations.
-  If unset, at least one memory allocation, possibly more is performed.
+  \mallocs If the `kernelbuffer` parameter is set on entry, no memory allocations other than compiling
+  the glob on POSIX. If unset, at least one memory allocation, possibly more is performed.
   */
   AFIO_MAKE_FREE_FUNCTION
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<enumerate_info> enumerate(buffers_type &&tofill, path_view_type glob = path_view_type(), filter filtering = filter::fastdeleted, span<char> kernelbuffer = span<char>()) const noexcept;
+  /*! Fill the buffers type with as many directory entries as will fit, filtered by a precompiled glob.
+
+  As for `enumerate()` with a path view glob, except that the glob is not parsed again each call, and
+  on POSIX each leafname is matched against it within the loop over the entries returned by the kernel,
+  which for the common shapes of glob such as `*.ext` costs little more than a `memcmp()` per entry.
+  On Windows the text of the glob is given to the kernel as before.
+
+  \mallocs As for `enumerate()` with a path view glob, except that the glob is never compiled.
+  */
+  AFIO_MAKE_FREE_FUNCTION
+  AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<enumerate_info> enumerate(buffers_type &&tofill, const glob_pattern &glob, filter filtering = filter::fastdeleted, span<char> kernelbuffer = span<char>()) const noexcept;
+
+  //! \brief The position reached by an incremental enumeration, see `enumerate(enumerate_cursor &, ...)`.
+  struct enumerate_cursor
+  {
+    //! Opaque position of the next entry to enumerate. Zero is the start of the directory.
+    uint64_t position{0};
+    //! True once the end of the directory has been reached.
+    bool done{false};
+    //! The version of the directory taken when the enumeration began, returned with every batch.
+    version_token version{};
+  };
+  /*! Fill the buffers type with as many directory entries as will fit, continuing from where the
+  previous call with the same cursor stopped.
+
+  Unlike `enumerate()` without a cursor, which reads the directory from the start each call, this
+  reads each entry exactly once across all calls, so a directory of any size can be processed in
+  batches of `tofill.size()` entries with bounded memory and linear total cost. The kernel buffer is
+  never grown except to fit a single entry, and it is reused by each call, so the leafnames returned
+  by one call are invalidated by the next call using the same `tofill` or `kernelbuffer`.
+
+  On POSIX the cursor holds the seek offset of the directory after the last entry returned, so any
+  number of cursors may enumerate the same handle independently, and the cursor remains valid
+  after the handle is closed and reopened if the filing system has stable directory offsets, as do
+  all the major Linux filing systems. On Windows the position is held by the handle, so only one
+  cursor may be used per handle at a time, and it must not be interleaved with `enumerate()`
+  without a cursor.
+
+  Entries added or removed during enumeration may or may not be seen, but no entry present
+  throughout is seen twice or missed.
+
+  \return Returns the buffers filled, what metadata was filled in and whether the end of the
+  directory has been reached, which is also recorded into `cursor`.
+  \param cursor The position to continue from, which is updated on exit. Default construct to begin
+  at the start of the directory.
+  \param tofill The buffers to fill, returned to you on exit.
+  \param glob An optional shell glob by which to filter the items filled. Done kernel side on Windows, user side on POSIX,
+  where a glob containing wildcards is compiled into a `glob_pattern` each call.
+  \param filtering Whether to filter out fake-deleted files on Windows or not.
+  \param kernelbuffer A buffer to use for the kernel to fill. If left defaulted, a kernel buffer
+  is allocated internally and stored into `tofill`.
+  \errors Any of the values POSIX `lseek()` or `getdents()`, or `NtQueryDirectoryFile()` can return.
+  \mallocs If the `kernelbuffer` parameter is set on entry, no memory allocations other than compiling
+  the glob on POSIX. If unset, one memory allocation upon first use of `tofill`.
+  */
+  AFIO_MAKE_FREE_FUNCTION
+  AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<enumerate_info> enumerate(enumerate_cursor &cursor, buffers_type &&tofill, path_view_type glob = path_view_type(), filter filtering = filter::fastdeleted, span<char> kernelbuffer = span<char>()) const noexcept;
+  /*! Fill the buffers type with as many directory entries as will fit, continuing from where the
+  previous call with the same cursor stopped, filtered by a precompiled glob.
+
+  As for `enumerate()` with a cursor and a path view glob, except that the glob is not parsed again
+  each call, which matters when a large directory is enumerated in many small batches.
+
+  \mallocs As for `enumerate()` with a cursor and a path view glob, except that the glob is never compiled.
+  */
+  AFIO_MAKE_FREE_FUNCTION
+  AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<enumerate_info> enumerate(enumerate_cursor &cursor, buffers_type &&tofill, const glob_pattern &glob, filter filtering = filter::fastdeleted, span<char> kernelbuffer = span<char>()) const noexcept;
+
+  /*! \brief Returns a token identifying the current version of the entries of this directory.
+
+  \errors Any of the values POSIX `statx()` or `fstat()`, or `NtQueryInformationFile()` can return.
+  \mallocs None.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<version_token> version() const noexcept;
+  /*! \brief True if no entry of this directory has been created, removed or renamed since the token
+  was taken, at the cost of a single syscall.
+
+  This lets a cache of directory listings skip listing again the directories which have not changed.
+  Always false for a token which is not `stable`. On network filing systems the times may come from the
+  client's attribute cache, so a change by another client may not be seen until that expires.
+
+  \errors As for `version()`.
+  \mallocs None.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<bool> unchanged_since(const version_token &token) const noexcept;
+
+  /*! Fills in the metadata of many entries of this directory, such as those returned by `enumerate()`.
+
+  Enumeration only provides some metadata, on POSIX just the inode and type. This fetches more for a
+  whole batch of entries at once, asking only for what is wanted. On Linux each entry is examined with
+  `statx()` relative to this directory, with a mask of the fields wanted and by default with
+  `AT_STATX_DONT_SYNC`, so network and fuse filing systems may answer from cached metadata rather than
+  asking the server. Asking for less, for example only sizes, can be much cheaper on such filing
+  systems. Other POSIX use `fstatat()`, and Windows opens each entry for attribute read.
+
+  Symbolic links are not followed. An entry which no longer exists has its `st_type` set to
+  `filesystem::file_type::not_found`, and is otherwise left untouched.
+
+  \return The metadata filled into every entry which still exists, which may be more or less than was wanted.
+  \param entries The entries to fill, whose leafnames are relative to this directory.
+  \param wanted The metadata wanted.
+  \param sync If true, the filing system is asked for up to date metadata, which is the behaviour of `stat_t::fill()`.
+  \errors Any of the values POSIX `statx()` or `fstatat()`, or `NtCreateFile()` can return, apart from those
+  meaning the entry does not exist.
+  \mallocs None on POSIX, unless a leafname needs zero terminating.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<stat_t::want> fill_stat(span<buffer_type> entries, stat_t::want wanted = stat_t::want::all, bool sync = false) const noexcept;
+
+  //! \brief A change to an entry of this directory, many of which are made at once by `mutate()`
+  struct mutation
+  {
+    //! The kinds of change
+    enum class operation : unsigned char
+    {
+      create_file,       //!< Create `leafname` as an empty regular file, failing if anything is there.
+      create_directory,  //!< Create `leafname` as a directory, failing if anything is there.
+      unlink_file,       //!< Unlink `leafname`, which must not be a directory.
+      unlink_directory,  //!< Unlink `leafname`, which must be an empty directory.
+      relink             //!< Relink `leafname` to `newpath`.
+    };
+    operation op;                    //!< The change to make
+    path_view_type leafname;         //!< The leafname of the entry within this directory
+    path_view_type newpath;          //!< For `relink`, the new path of the entry relative to this directory
+    bool atomic_replace{true};       //!< For `relink`, whether to replace any entry at `newpath`, as for `fs_handle::relink()`
+    result<void> status{success()};  //!< On return, the outcome of this change
+  };
+  /*! Makes many changes to the entries of this directory at once, in order.
+
+  Creating or unlinking an entry through a `file_handle` costs opening it, fetching its inode, and for
+  unlinking, finding its current path and checking it. This instead makes each change with a single
+  syscall relative to this directory on POSIX, or two for creating a file, and never constructs a handle.
+  The entries must therefore be trusted not to be concurrently replaced by third parties, as nothing
+  checks that the entry unlinked or relinked is the one intended. On Windows each entry is opened
+  relative to this directory, and relinked or unlinked race free by its handle.
+
+  \return The number of changes which succeeded. The outcome of each is set into its `status`.
+  \param mutations The changes to make. Later changes may depend on the success of earlier ones.
+  \param stop_on_failure If true, no more changes are made after the first which fails, and their
+  `status` is set to `errc::operation_canceled`.
+  \errors Not a failure itself. Each `status` may be any of the values POSIX `openat()`, `mkdirat()`,
+  `unlinkat()` or `renameat()` can return, or on Windows `file_handle::file()`, `directory_handle::directory()`,
+  `fs_handle::unlink()` or `fs_handle::relink()` can return.
+  \mallocs None on POSIX, unless a path needs zero terminating.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC size_t mutate(span<mutation> mutations, bool stop_on_failure = false) const noexcept;
 };
 inline std::ostream &operator<<(std::ostream &s, const directory_handle::filter &v)
 {
@@ -299,6 +469,15 @@ inline std::ostream &operator<<(std::ostream &s, const directory_handle::enumera
 {
   return s << "afio::directory_handle::enumerate_info";
 }
+inline std::ostream &operator<<(std::ostream &s, const directory_handle::mutation::operation &v)
+{
+  static constexpr const char *values[] = {"create_file", "create_directory", "unlink_file", "unlink_directory", "relink"};
+  if(static_cast<size_t>(v) >= sizeof(values) / sizeof(values[0]) || (values[static_cast<size_t>(v)] == nullptr))
+  {
+    return s << "afio::directory_handle::mutation::operation::<unknown>";
+  }
+  return s << "afio::directory_handle::mutation::operation::" << values[static_cast<size_t>(v)];
+}
 
 //! \brief Constructor for `directory_handle`
 template <> struct construct<directory_handle>
@@ -356,20 +535,72 @@ inline result<directory_handle> temp_directory(directory_handle::path_view_type
 was read into `tofill`.
 \param self The object whose member function to call.
 \param tofill The buffers to fill, returned to you on exit.
-\param glob An optional shell glob by which to filter the items filled. Done kernel side on Windows, user side on POSIX.
+\param glob An optional shell glob by which to filter the items filled. Done kernel side on Windows, user side on POSIX,
+where a glob containing wildcards is compiled into a `glob_pattern` each call.
 \param filtering Whether to filter out fake-deleted files on Windows or not.
 \param kernelbuffer A buffer to use for the kernel to fill. If left defaulted, a kernel buffer
 is allocated internally and stored into `tofill` which needs to not be destructed until one
 is no longer using any items within (leafnames are views onto the original kernel data).
 \errors todo
-\mallocs If the `kernelbuffer` parameter is set on entry, no memory allocations.
-If unset, at least one memory allocation, possibly more is performed.
+\mallocs If the `kernelbuffer` parameter is set on entry, no memory allocations other than compiling
+the glob on POSIX. If unset, at least one memory allocation, possibly more is performed.
 */
 inline result<directory_handle::enumerate_info> enumerate(const directory_handle &self, directory_handle::buffers_type &&tofill, directory_handle::path_view_type glob = directory_handle::path_view_type(), directory_handle::filter filtering = directory_handle::filter::fastdeleted,
                                                           span<char> kernelbuffer = span<char>()) noexcept
 {
   return self.enumerate(std::forward<decltype(tofill)>(tofill), std::forward<decltype(glob)>(glob), std::forward<decltype(filtering)>(filtering), std::forward<decltype(kernelbuffer)>(kernelbuffer));
 }
+/*! Fill the buffers type with as many directory entries as will fit, filtered by a precompiled glob.
+
+As for `enumerate()` with a path view glob, except that the glob is not parsed again each call, and
+on POSIX each leafname is matched against it within the loop over the entries returned by the kernel,
+which for the common shapes of glob such as `*.ext` costs little more than a `memcmp()` per entry.
+On Windows the text of the glob is given to the kernel as before.
+
+\param self The object whose member function to call.
+\mallocs As for `enumerate()` with a path view glob, except that the glob is never compiled.
+*/
+inline result<directory_handle::enumerate_info> enumerate(const directory_handle &self, directory_handle::buffers_type &&tofill, const glob_pattern &glob, directory_handle::filter filtering = directory_handle::filter::fastdeleted, span<char> kernelbuffer = span<char>()) noexcept
+{
+  return self.enumerate(std::forward<decltype(tofill)>(tofill), glob, std::forward<decltype(filtering)>(filtering), std::forward<decltype(kernelbuffer)>(kernelbuffer));
+}
+/*! Fill the buffers type with as many directory entries as will fit, continuing from where the
+previous call with the same cursor stopped.
+
+\return Returns the buffers filled, what metadata was filled in and whether the end of the
+directory has been reached, which is also recorded into `cursor`.
+\param self The object whose member function to call.
+\param cursor The position to continue from, which is updated on exit. Default construct to begin
+at the start of the directory.
+\param tofill The buffers to fill, returned to you on exit.
+\param glob An optional shell glob by which to filter the items filled. Done kernel side on Windows, user side on POSIX,
+where a glob containing wildcards is compiled into a `glob_pattern` each call.
+\param filtering Whether to filter out fake-deleted files on Windows or not.
+\param kernelbuffer A buffer to use for the kernel to fill. If left defaulted, a kernel buffer
+is allocated internally and stored into `tofill`.
+\errors Any of the values POSIX `lseek()` or `getdents()`, or `NtQueryDirectoryFile()` can return.
+\mallocs If the `kernelbuffer` parameter is set on entry, no memory allocations other than compiling
+the glob on POSIX. If unset, one memory allocation upon first use of `tofill`.
+*/
+inline result<directory_handle::enumerate_info> enumerate(const directory_handle &self, directory_handle::enumerate_cursor &cursor, directory_handle::buffers_type &&tofill, directory_handle::path_view_type glob = directory_handle::path_view_type(),
+                                                          directory_handle::filter filtering = directory_handle::filter::fastdeleted, span<char> kernelbuffer = span<char>()) noexcept
+{
+  return self.enumerate(std::forward<decltype(cursor)>(cursor), std::forward<decltype(tofill)>(tofill), std::forward<decltype(glob)>(glob), std::forward<decltype(filtering)>(filtering), std::forward<decltype(kernelbuffer)>(kernelbuffer));
+}
+/*! Fill the buffers type with as many directory entries as will fit, continuing from where the
+previous call with the same cursor stopped, filtered by a precompiled glob.
+
+As for `enumerate()` with a cursor and a path view glob, except that the glob is not parsed again
+each call, which matters when a large directory is enumerated in many small batches.
+
+\param self The object whose member function to call.
+\mallocs As for `enumerate()` with a cursor and a path view glob, except that the glob is never compiled.
+*/
+inline result<directory_handle::enumerate_info> enumerate(const directory_handle &self, directory_handle::enumerate_cursor &cursor, directory_handle::buffers_type &&tofill, const glob_pattern &glob, directory_handle::filter filtering = directory_handle::filter::fastdeleted,
+                                                          span<char> kernelbuffer = span<char>()) noexcept
+{
+  return self.enumerate(std::forward<decltype(cursor)>(cursor), std::forward<decltype(tofill)>(tofill), glob, std::forward<decltype(filtering)>(filtering), std::forward<decltype(kernelbuffer)>(kernelbuffer));
+}
 // END make_free_functions.py
 
 AFIO_V2_NAMESPACE_END
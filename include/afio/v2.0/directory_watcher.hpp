@@ -0,0 +1,200 @@
+/* Watches directories for changes
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef AFIO_DIRECTORY_WATCHER_H
+#define AFIO_DIRECTORY_WATCHER_H
+
+#include "async_file_handle.hpp"
+#include "directory_handle.hpp"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+//! \file directory_watcher.hpp Provides directory_watcher
+AFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+/*! \class directory_watcher
+\brief Watches a directory, or a whole directory tree, for changes to its entries.
+
+Rather than polling a directory with `enumerate()` to see what has changed, this asks the kernel
+to queue a record of each change as it happens. Records are read in batches into a buffer owned
+by the watcher, either synchronously with `read()` or asynchronously with `async_read()`, whose
+completion is delivered by `io_service::run_until()` in exactly the same way as the completion
+of an `async_file_handle::async_read()`. Each batch is only valid until the next read, so reading
+the same watcher repeatedly does not allocate memory.
+
+In tree mode, every directory beneath the watched directory is also watched, and directories
+created within or moved into the tree are watched as they appear. Entries created within a new
+directory before its watch is added are not reported, so consumers wishing to see everything
+should enumerate newly created directories. Directories moved out of the tree stop being watched.
+
+If the kernel's queue overflows, records are lost and a single record with `event::overflow` is
+delivered in their place, after which consumers ought to rescan whatever they are watching.
+
+On Linux this is implemented using inotify. Other platforms currently return `errc::not_supported`.
+
+\warning As with `async_file_handle`, asynchronous reads must be initiated and completed on the
+thread owning the `io_service`.
+*/
+class AFIO_DECL directory_watcher
+{
+public:
+  using path_type = directory_handle::path_type;
+  using path_view_type = directory_handle::path_view_type;
+
+  //! The kinds of change which can be watched for, and which are reported
+  QUICKCPPLIB_BITFIELD_BEGIN(event){none = 0U,                //!< No events
+                                    created = 1U << 0U,       //!< An entry was created
+                                    deleted = 1U << 1U,       //!< An entry was deleted
+                                    modified = 1U << 2U,      //!< An entry's contents were written to
+                                    metadata = 1U << 3U,      //!< An entry's metadata, such as permissions, timestamps or link count, changed
+                                    moved_from = 1U << 4U,    //!< An entry was renamed away from here
+                                    moved_to = 1U << 5U,      //!< An entry was renamed to here
+                                    closed_write = 1U << 6U,  //!< An entry which had been opened for writing was closed
+                                    self_deleted = 1U << 8U,  //!< A watched directory was itself deleted
+                                    self_moved = 1U << 9U,    //!< A watched directory was itself renamed
+
+                                    directory = 1U << 16U,  //!< Only ever reported: the entry is a directory
+                                    overflow = 1U << 17U,   //!< Only ever reported: records were lost
+
+                                    all = 0x37fU}  //!< Everything which can be watched for
+  QUICKCPPLIB_BITFIELD_END(event)
+
+  //! \brief A record of a change
+  struct record
+  {
+    path_view_type directory;  //!< The path of the directory changed, relative to the watched directory. Empty for the watched directory.
+    path_view_type leafname;   //!< The leafname of the entry changed, or empty if the change was to the directory itself.
+    event events;              //!< What happened
+    uint32_t cookie;           //!< Non-zero and equal in the `moved_from` and `moved_to` records of the same rename, otherwise zero.
+  };
+  //! The type of a batch of records, valid until the next read
+  using records_type = span<record>;
+  //! The type of the completion called by `async_read()`
+  using completion_type = detail::function_ptr<void(directory_watcher *, result<records_type>)>;
+
+protected:
+  struct _state;
+  std::unique_ptr<_state> _s;
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC explicit directory_watcher(std::unique_ptr<_state> s) noexcept;
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _async_read(completion_type &&completion) noexcept;
+
+public:
+  //! Default constructor
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC directory_watcher() noexcept;
+  //! Implicit move construction of directory_watcher permitted
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC directory_watcher(directory_watcher &&o) noexcept;
+  //! No copy construction
+  directory_watcher(const directory_watcher &) = delete;
+  //! Move assignment of directory_watcher permitted
+  directory_watcher &operator=(directory_watcher &&o) noexcept
+  {
+    this->~directory_watcher();
+    new(this) directory_watcher(std::move(o));
+    return *this;
+  }
+  //! No copy assignment
+  directory_watcher &operator=(const directory_watcher &) = delete;
+  //! Stops watching, cancelling any read in progress without calling its completion.
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC ~directory_watcher();
+
+  /*! \brief Starts watching a directory.
+
+  \param service The `io_service` which `async_read()` is to complete through.
+  \param base Handle to a base location on the filing system. Pass `{}` to indicate that path will be absolute.
+  \param path The path relative to base of the directory to watch.
+  \param events The kinds of change to report.
+  \param tree Whether to watch every directory beneath the directory as well.
+  \param buffer The size of the buffer into which batches of records are read.
+  \errors `errc::not_supported` if the platform cannot watch directories. Any of the values
+  POSIX `inotify_init1()` or `inotify_add_watch()` can return, and if `tree` is true, any of the values
+  `directory_handle::directory()` and `directory_handle::enumerate()` can return.
+  \mallocs The watcher's state and buffers, and per watched directory its path.
+  */
+  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<directory_watcher> watch(io_service &service, const path_handle &base, path_view_type path, event events = event::all, bool tree = false, size_t buffer = 65536) noexcept;
+
+  //! True if this watcher is watching
+  bool is_valid() const noexcept { return _s != nullptr; }
+  //! The `io_service` which `async_read()` completes through
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC io_service *service() const noexcept;
+  //! The number of directories being watched
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC size_t watches() const noexcept;
+  //! Stops watching, cancelling any read in progress without calling its completion.
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> close() noexcept;
+
+  /*! \brief Reads the next batch of records, waiting until the deadline for at least one.
+
+  \errors `errc::timed_out` if the deadline passed, `errc::device_or_resource_busy` if an `async_read()` is in
+  progress, `errc::no_such_file_or_directory` if nothing is being watched any more. Any of the values POSIX
+  `poll()` or `read()` can return.
+  \mallocs None, unless in tree mode a new directory is watched.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<records_type> read(deadline d = deadline()) noexcept;
+  /*! \brief Schedules a read of the next batch of records, calling the completion from within
+  `io_service::run_until()` once at least one record is available.
+
+  The completion may itself call `async_read()` to continue watching, but must not destroy or close
+  the watcher.
+
+  \param completion A callable with spec `void(directory_watcher *, result<records_type>)`.
+  \errors `errc::device_or_resource_busy` if an `async_read()` is already in progress,
+  `errc::no_such_file_or_directory` if nothing is being watched any more. Any of the values
+  `async_file_handle::async_read()` can return.
+  \mallocs The type erased completion, and the i/o state as for `async_file_handle::async_read()`.
+  */
+  template <class CompletionRoutine>                                                                                   //
+  AFIO_REQUIRES(detail::is_invocable_r<void, CompletionRoutine, directory_watcher *, result<records_type>>::value)  //
+  result<void> async_read(CompletionRoutine &&completion) noexcept
+  {
+    try
+    {
+      return _async_read(detail::make_function_ptr<void(directory_watcher *, result<records_type>)>(std::forward<CompletionRoutine>(completion)));
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+};
+
+AFIO_V2_NAMESPACE_END
+
+#if AFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define AFIO_INCLUDED_BY_HEADER 1
+#ifdef _WIN32
+#include "detail/impl/windows/directory_watcher.ipp"
+#else
+#include "detail/impl/posix/directory_watcher.ipp"
+#endif
+#undef AFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -274,6 +274,30 @@ public:
   */
   AFIO_MAKE_FREE_FUNCTION
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> zero(extent_type offset, extent_type bytes, deadline d = deadline()) noexcept;
+
+  /*! \brief Send a range of this file to a pipe or socket without copying it through userspace.
+
+  On Linux this is implemented using `sendfile()`, falling back onto `splice()` for pipe destinations
+  on kernels whose `sendfile()` cannot write to pipes. On all other platforms the data is read into
+  a page allocated bounce buffer and written to the destination, which is no better than doing it
+  yourself, but it does work.
+
+  If the destination is non-blocking and would block, the destination is polled for writability
+  until the deadline expires. If some data was sent by then, the count sent is returned, otherwise
+  `errc::timed_out`. A zero deadline therefore sends whatever can be sent without blocking. Transfers
+  which block in the kernel cannot be interrupted, so the deadline is also checked between them, and
+  once it has expired the count sent so far is returned.
+
+  \return The bytes sent, which will be less than requested if the end of the file was reached.
+  \param dest The native handle of a pipe or socket to send to. It is not adopted.
+  \param offset The offset within this file to send from.
+  \param bytes The number of bytes to send.
+  \param d An optional deadline by which the transfer must complete.
+  \errors Any of the values POSIX sendfile(), splice(), read(), write() or poll() can return, `errc::timed_out`.
+  \mallocs None on Linux. One page allocation of `utils::file_buffer_default_size()` for the emulation.
+  */
+  AFIO_MAKE_FREE_FUNCTION
+  AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> send_to(native_handle_type dest, extent_type offset, extent_type bytes, deadline d = deadline()) noexcept;
 };
 
 //! \brief Constructor for `file_handle`
@@ -406,6 +430,30 @@ inline result<file_handle::extent_type> zero(file_handle &self, file_handle::ext
 {
   return self.zero(std::forward<decltype(offset)>(offset), std::forward<decltype(bytes)>(bytes), std::forward<decltype(d)>(d));
 }
+/*! \brief Send a range of this file to a pipe or socket without copying it through userspace.
+
+On Linux this is implemented using `sendfile()`, falling back onto `splice()` for pipe destinations
+on kernels whose `sendfile()` cannot write to pipes. On all other platforms the data is read into
+a page allocated bounce buffer and written to the destination, which is no better than doing it
+yourself, but it does work.
+
+If the destination is non-blocking and would block, the destination is polled for writability
+until the deadline expires. If some data was sent by then, the count sent is returned, otherwise
+`errc::timed_out`. A zero deadline therefore sends whatever can be sent without blocking.
+
+\return The bytes sent, which will be less than requested if the end of the file was reached.
+\param self The object whose member function to call.
+\param dest The native handle of a pipe or socket to send to. It is not adopted.
+\param offset The offset within this file to send from.
+\param bytes The number of bytes to send.
+\param d An optional deadline by which the transfer must complete.
+\errors Any of the values POSIX sendfile(), splice(), read(), write() or poll() can return, `errc::timed_out`.
+\mallocs None on Linux. One page allocation of `utils::file_buffer_default_size()` for the emulation.
+*/
+inline result<file_handle::extent_type> send_to(file_handle &self, native_handle_type dest, file_handle::extent_type offset, file_handle::extent_type bytes, deadline d = deadline()) noexcept
+{
+  return self.send_to(std::forward<decltype(dest)>(dest), std::forward<decltype(offset)>(offset), std::forward<decltype(bytes)>(bytes), std::forward<decltype(d)>(d));
+}
 // END make_free_functions.py
 
 AFIO_V2_NAMESPACE_END
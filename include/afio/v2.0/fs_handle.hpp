@@ -63,6 +63,16 @@ protected:
 
   virtual const handle &_get_handle() const noexcept = 0;
 
+  /* Relinks the entry `leafname` within the directory `dirh` if it is still this handle's inode, else returns
+  false having done nothing. Used by implementations already knowing their containing directory, which then
+  need not call `parent_path_handle()`.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<bool> _relink_entry(const handle &dirh, path_view_type leafname, const path_handle &base, path_view_type path, bool atomic_replace) noexcept;
+  // As for `_relink_entry()`, but unlinks the entry
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<bool> _unlink_entry(const handle &dirh, path_view_type leafname) noexcept;
+  // As for `_relink_entry()`, but exchanges the entry with the entry `oleafname` within `odirh`, which must be the inode of `o`
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<bool> _exchange_entries(const handle &dirh, path_view_type leafname, const fs_handle &o, const handle &odirh, path_view_type oleafname) noexcept;
+
 protected:
   //! Default constructor
   constexpr fs_handle() {}  // NOLINT
@@ -175,6 +185,26 @@ public:
   AFIO_MAKE_FREE_FUNCTION
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC
   result<void> unlink(deadline d = std::chrono::seconds(30)) noexcept;
+
+  /*! Atomically exchanges the current paths of this open handle and another, so each is linked where
+  the other was. No observer ever sees either path missing, so this publishes a new version of a file
+  over an old one while keeping the old one linked elsewhere.
+
+  \warning As for `relink()`, on POSIX this is \b racy, and unless `flag::disable_safety_unlinks`
+  is set, this implementation opens a `path_handle` to the containing directory of each handle and checks
+  that the items about to be exchanged have the same inodes as the open handles.
+
+  \param o The handle whose path to exchange with.
+  \param d The deadline by which the matching of the containing directories to the open handles' inodes
+  must succeed, else `std::errc::timed_out` will be returned.
+  \errors `errc::not_supported` if the platform has no atomic exchange, which is currently all but Linux,
+  else any of the values POSIX `renameat2()` can return. Filing systems not supporting `RENAME_EXCHANGE`
+  return `errc::invalid_argument`.
+  \mallocs As for `relink()`, for each handle.
+  */
+  AFIO_MAKE_FREE_FUNCTION
+  AFIO_HEADERS_ONLY_VIRTUAL_SPEC
+  result<void> exchange(fs_handle &o, deadline d = std::chrono::seconds(30)) noexcept;
 };
 
 // BEGIN make_free_functions.py
@@ -233,6 +263,27 @@ inline result<void> unlink(fs_handle &self, deadline d = std::chrono::seconds(30
 {
   return self.unlink(std::forward<decltype(d)>(d));
 }
+/*! Atomically exchanges the current paths of this open handle and another, so each is linked where
+the other was. No observer ever sees either path missing, so this publishes a new version of a file
+over an old one while keeping the old one linked elsewhere.
+
+\warning As for `relink()`, on POSIX this is \b racy, and unless `flag::disable_safety_unlinks`
+is set, this implementation opens a `path_handle` to the containing directory of each handle and checks
+that the items about to be exchanged have the same inodes as the open handles.
+
+\param self The object whose member function to call.
+\param o The handle whose path to exchange with.
+\param d The deadline by which the matching of the containing directories to the open handles' inodes
+must succeed, else `std::errc::timed_out` will be returned.
+\errors `errc::not_supported` if the platform has no atomic exchange, which is currently all but Linux,
+else any of the values POSIX `renameat2()` can return. Filing systems not supporting `RENAME_EXCHANGE`
+return `errc::invalid_argument`.
+\mallocs As for `relink()`, for each handle.
+*/
+inline result<void> exchange(fs_handle &self, fs_handle &o, deadline d = std::chrono::seconds(30)) noexcept
+{
+  return self.exchange(std::forward<decltype(o)>(o), std::forward<decltype(d)>(d));
+}
 // END make_free_functions.py
 
 AFIO_V2_NAMESPACE_END
@@ -0,0 +1,190 @@
+/* A shell glob compiled for fast matching of leafnames
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef AFIO_GLOB_PATTERN_H
+#define AFIO_GLOB_PATTERN_H
+
+#ifndef AFIO_CONFIG_HPP
+#error You must include the master afio.hpp, not individual header files directly
+#endif
+#include "path_view.hpp"
+
+#include <cstring>  // for memcmp
+#include <string>
+#include <vector>
+
+//! \file glob_pattern.hpp Provides glob_pattern
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+AFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+/*! \class glob_pattern
+\brief A shell glob compiled once, for matching very many leafnames quickly.
+
+Matches as POSIX `fnmatch()` does with no flags: `*` matches any run of characters, `?` any single
+character, `[...]` any character in the set, which may contain ranges such as `a-z` and the POSIX
+classes such as `[:digit:]`, and `[!...]` or `[^...]` any character not in the set. A backslash makes
+the next character literal. Leading dots are not special. Characters are compared as bytes, so sets
+and `?` match a single byte of a UTF-8 leafname. Collating symbols and equivalence classes are not
+supported, and a trailing backslash matches a backslash where `fnmatch()` would match nothing. An empty glob matches everything, as `directory_handle::enumerate()` treats it.
+
+The common shapes of glob are recognised when compiled and matched without interpretation: a
+literal leafname, `*`, `prefix*`, `*suffix`, `prefix*suffix` and `*infix*` cost a length check and at
+most two `memcmp()` per leafname, or a byte search for an infix. Anything else is compiled into
+a sequence of literal runs, `?`, stars and sets, each set a 256 bit map, which is matched with no
+backtracking further than the most recent star.
+*/
+class AFIO_DECL glob_pattern
+{
+public:
+  //! The shape of a compiled glob
+  enum class shape : unsigned char
+  {
+    empty,          //!< Matches everything
+    literal,        //!< Matches exactly one leafname
+    any,            //!< `*`
+    prefix,         //!< `prefix*`
+    suffix,         //!< `*suffix`
+    prefix_suffix,  //!< `prefix*suffix`
+    infix,          //!< `*infix*`
+    general         //!< Anything else
+  };
+
+protected:
+  struct _token
+  {
+    enum class kind : unsigned char
+    {
+      literal,  // length bytes of _literals at offset
+      one,      // ?
+      set,      // _sets[offset]
+      star      // *
+    } k;
+    uint32_t offset, length;
+  };
+  struct _set
+  {
+    uint64_t bits[4];
+    bool test(unsigned char c) const noexcept { return ((bits[c >> 6] >> (c & 63)) & 1) != 0; }
+    void set(unsigned char c) noexcept { bits[c >> 6] |= uint64_t(1) << (c & 63); }
+  };
+  std::string _pattern;
+  // The literal runs of the glob, unescaped and concatenated. For a literal or infix shape,
+  // _head is the whole literal, otherwise _head is the prefix and _tail the suffix.
+  std::string _literals;
+  size_t _head{0}, _tail{0};
+  shape _shape{shape::empty};
+  std::vector<_token> _tokens;
+  std::vector<_set> _sets;
+
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC bool _match(const char *leafname, size_t length) const noexcept;
+  bool _find(const char *leafname, size_t length) const noexcept
+  {
+    if(length < _head)
+    {
+      return false;
+    }
+    const char *lit = _literals.data();
+    const char *end = leafname + length - _head + 1;
+    for(const char *p = leafname; (p = static_cast<const char *>(memchr(p, lit[0], end - p))) != nullptr; ++p)
+    {
+      if(0 == memcmp(p, lit, _head))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+public:
+  /*! Compiles a shell glob. An empty glob matches everything.
+  \mallocs A copy of the glob, its literal runs and, if it is not one of the common shapes, its
+  compiled form.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC explicit glob_pattern(path_view glob);
+
+  //! The shape which the glob was recognised as
+  shape kind() const noexcept { return _shape; }
+  //! True if the glob matches everything
+  bool empty() const noexcept { return _shape == shape::empty; }
+  //! The glob as compiled, in UTF-8
+  path_view pattern() const noexcept { return path_view(_pattern.data(), _pattern.size()); }
+  //! The single leafname matched by a glob of `shape::literal`, unescaped
+  path_view literal() const noexcept { return (_shape == shape::literal) ? path_view(_literals.data(), _head) : path_view(); }
+
+  //! True if the leafname is matched by the glob
+  bool matches(const char *leafname, size_t length) const noexcept
+  {
+    const char *lit = _literals.data();
+    switch(_shape)
+    {
+    case shape::empty:
+    case shape::any:
+      return true;
+    case shape::literal:
+      return length == _head && 0 == memcmp(leafname, lit, length);
+    case shape::prefix:
+      return length >= _head && 0 == memcmp(leafname, lit, _head);
+    case shape::suffix:
+      return length >= _tail && 0 == memcmp(leafname + length - _tail, lit, _tail);
+    case shape::prefix_suffix:
+      return length >= _head + _tail && 0 == memcmp(leafname, lit, _head) && 0 == memcmp(leafname + length - _tail, lit + _head, _tail);
+    case shape::infix:
+      return _find(leafname, length);
+    case shape::general:
+      return _match(leafname, length);
+    }
+    return false;
+  }
+  //! \overload
+  bool matches(string_view leafname) const noexcept { return matches(leafname.data(), leafname.size()); }
+};
+
+inline std::ostream &operator<<(std::ostream &s, const glob_pattern::shape &v)
+{
+  static constexpr const char *values[] = {"empty", "literal", "any", "prefix", "suffix", "prefix_suffix", "infix", "general"};
+  if(static_cast<size_t>(v) >= sizeof(values) / sizeof(values[0]) || (values[static_cast<size_t>(v)] == nullptr))
+  {
+    return s << "afio::glob_pattern::shape::<unknown>";
+  }
+  return s << "afio::glob_pattern::shape::" << values[static_cast<size_t>(v)];
+}
+
+AFIO_V2_NAMESPACE_END
+
+#if AFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define AFIO_INCLUDED_BY_HEADER 1
+#include "detail/impl/glob_pattern.ipp"
+#undef AFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -26,6 +26,10 @@ Distributed under the Boost Software License, Version 1.0.
 #define AFIO_MAP_HANDLE_H
 
 #include "file_handle.hpp"
+#include "io_service.hpp"
+
+#include <atomic>
+#include <condition_variable>
 
 //! \file map_handle.hpp Provides `map_handle`
 
@@ -65,9 +69,14 @@ public:
                                    prefault = 1U << 9U,     //!< Prefault, as if by reading every page, any views of memory upon creation.
                                    executable = 1U << 10U,  //!< The backing storage is in fact an executable program binary.
                                    singleton = 1U << 11U,   //!< A single instance of this section is to be shared by all processes using the same backing file.
+                                   transparent_huge_pages = 1U << 12U,  //!< Ask the kernel to back views with transparent huge pages where possible. If combined with `prefault`, views are collapsed into huge pages upon creation. Linux only, ignored elsewhere.
 
                                    barrier_on_close = 1U << 16U,  //!< Maps of this section, if writable, issue a `barrier()` when destructed blocking until data (not metadata) reaches physical storage.
 
+                                   page_sizes_1 = 1U << 24U,  //!< Use `utils::page_sizes()[1]` sized pages, or fail. Backing files must live on a large page filing system e.g. hugetlbfs.
+                                   page_sizes_2 = 2U << 24U,  //!< Use `utils::page_sizes()[2]` sized pages, or fail. Backing files must live on a large page filing system e.g. hugetlbfs.
+                                   page_sizes_3 = 3U << 24U,  //!< Use `utils::page_sizes()[3]` sized pages, or fail. Backing files must live on a large page filing system e.g. hugetlbfs.
+
                                    // NOTE: IF UPDATING THIS UPDATE THE std::ostream PRINTER BELOW!!!
 
                                    readwrite = (read | write)};
@@ -141,6 +150,9 @@ public:
   \param dirh Where to create the anonymous, managed file.
   \param _flag How to create the section.
 
+  If `_flag` requests large pages, on Linux the anonymous file is instead created on the internal
+  hugetlbfs mount using `memfd_create()`, and `dirh` is ignored.
+
   \errors Any of the values POSIX dup(), open() or NtCreateSection() can return.
   */
   AFIO_MAKE_FREE_FUNCTION
@@ -202,10 +214,26 @@ inline std::ostream &operator<<(std::ostream &s, const section_handle::flag &v)
   {
     temp.append("singleton|");
   }
+  if(!!(v & section_handle::flag::transparent_huge_pages))
+  {
+    temp.append("transparent_huge_pages|");
+  }
   if(!!(v & section_handle::flag::barrier_on_close))
   {
     temp.append("barrier_on_close|");
   }
+  if(!!(v & section_handle::flag::page_sizes_1) && !!(v & section_handle::flag::page_sizes_2))
+  {
+    temp.append("page_sizes_3|");
+  }
+  else if(!!(v & section_handle::flag::page_sizes_2))
+  {
+    temp.append("page_sizes_2|");
+  }
+  else if(!!(v & section_handle::flag::page_sizes_1))
+  {
+    temp.append("page_sizes_1|");
+  }
   if(!temp.empty())
   {
     temp.resize(temp.size() - 1);
@@ -274,12 +302,29 @@ public:
   template <class T> using io_request = io_handle::io_request<T>;
   template <class T> using io_result = io_handle::io_result<T>;
 
+  class fault_scope;
+
 protected:
+  struct _fault_counters
+  {
+    std::atomic<uint64_t> major{0}, minor{0};
+  };
   section_handle *_section{nullptr};
   char *_addr{nullptr};
   extent_type _offset{0};
   size_type _reservation{0}, _length{0};
+  size_type _pagesize{0};
   section_handle::flag _flag{section_handle::flag::none};
+  _fault_counters *_faults{nullptr};  // owned, only allocated if fault accounting is enabled
+  struct _lazy_state;
+  _lazy_state *_lazy{nullptr};  // owned, only allocated by map_lazy()
+  struct _async_barriers;
+  _async_barriers *_barriers{nullptr};  // owned, only allocated by async_barrier()
+
+  // Returns the faults taken so far by the calling thread, or by the process if the platform can't do per thread
+  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _fault_counts(uint64_t &major, uint64_t &minor) noexcept;
+  // Waits for any async_barrier() still in flight, including its completion unless posted to a service
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _wait_async_barriers() noexcept;
 
   explicit map_handle(section_handle *section)
       : _section(section)
@@ -292,13 +337,17 @@ public:
   constexpr map_handle() {}  // NOLINT
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC ~map_handle() override;
   //! Implicit move construction of map_handle permitted
-  constexpr map_handle(map_handle &&o) noexcept : io_handle(std::move(o)), _section(o._section), _addr(o._addr), _offset(o._offset), _reservation(o._reservation), _length(o._length), _flag(o._flag)
+  constexpr map_handle(map_handle &&o) noexcept : io_handle(std::move(o)), _section(o._section), _addr(o._addr), _offset(o._offset), _reservation(o._reservation), _length(o._length), _pagesize(o._pagesize), _flag(o._flag), _faults(o._faults), _lazy(o._lazy), _barriers(o._barriers)
   {
     o._section = nullptr;
     o._addr = nullptr;
     o._offset = 0;
     o._reservation = 0;
     o._length = 0;
+    o._pagesize = 0;
+    o._faults = nullptr;
+    o._lazy = nullptr;
+    o._barriers = nullptr;
     o._flag = section_handle::flag::none;
   }
   //! No copy construction (use `clone()`)
@@ -333,27 +382,108 @@ public:
   /*! Create new memory and map it into view.
   \param bytes How many bytes to create and map. Typically will be rounded up to a multiple of the page size (see `utils::page_sizes()`) on POSIX, 64Kb on Windows.
   \param _flag The permissions with which to map the view. `flag::none` can be useful for reserving virtual address space without committing system resources, use commit() to later change availability of memory.
+  \param numa The NUMA placement policy of the new memory, applied before any page is faulted in (see `utils::numa_policy`).
 
   \note On Microsoft Windows this constructor uses the faster VirtualAlloc() which creates less versatile page backed memory. If you want anonymous memory
   allocated from a paging file backed section instead, create a page file backed section and then a mapped view from that using
   the other constructor. This makes available all those very useful VM tricks Windows can do with section mapped memory which
   VirtualAlloc() memory cannot do.
 
-  \errors Any of the values POSIX mmap() or VirtualAlloc() can return.
+  \errors Any of the values POSIX mmap(), mbind() or VirtualAlloc() can return.
   */
   AFIO_MAKE_FREE_FUNCTION
-  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<map_handle> map(size_type bytes, section_handle::flag _flag = section_handle::flag::readwrite) noexcept;
+  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<map_handle> map(size_type bytes, section_handle::flag _flag = section_handle::flag::readwrite, utils::numa_policy numa = {}) noexcept;
 
   /*! Create a memory mapped view of a backing storage, optionally reserving additional address space for later growth.
   \param section A memory section handle specifying the backing storage to use.
   \param bytes How many bytes to reserve (0 = the size of the section). Rounded up to nearest 64Kb on Windows.
   \param offset The offset into the backing storage to map from. Typically needs to be at least a multiple of the page size (see utils::page_sizes()), on Windows it needs to be a multiple of the kernel memory allocation granularity (typically 64Kb).
   \param _flag The permissions with which to map the view which are constrained by the permissions of the memory section. `flag::none` can be useful for reserving virtual address space without committing system resources, use commit() to later change availability of memory.
+  \param numa The NUMA placement policy of pages of the section faulted in through this view (see `utils::numa_policy`). Pages
+  already resident, perhaps due to some other view, stay where they are. On Windows section memory is placed by the section,
+  so this is ignored.
 
-  \errors Any of the values POSIX mmap() or NtMapViewOfSection() can return.
+  \errors Any of the values POSIX mmap(), mbind() or NtMapViewOfSection() can return.
   */
   AFIO_MAKE_FREE_FUNCTION
-  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<map_handle> map(section_handle &section, size_type bytes = 0, extent_type offset = 0, section_handle::flag _flag = section_handle::flag::readwrite) noexcept;
+  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<map_handle> map(section_handle &section, size_type bytes = 0, extent_type offset = 0, section_handle::flag _flag = section_handle::flag::readwrite, utils::numa_policy numa = {}) noexcept;
+
+  //! The type of the callable which fills a lazy map, see `map_lazy()`
+  using lazy_fill_type = detail::function_ptr<result<size_type>(extent_type offset, buffer_type dest)>;
+  /*! \brief Create new memory whose pages are filled on demand, the first time each is touched.
+
+  On Linux the new memory is registered with a `userfaultfd`, and a handler thread owned by the map
+  services each fault on it by calling `fill` with the offset within the map of the missing page and a
+  buffer to fill, and then installing the buffer with `UFFDIO_COPY`, which wakes the faulting thread.
+  Any part of the buffer not filled, because `fill` returned fewer bytes, is zeroed. The pages of the
+  map are thus populated from any source at all, but only those pages actually touched are ever read.
+
+  Faults which follow on sequentially from the previous fault double the number of pages filled per fault,
+  up to `readahead`, so sequential access takes few faults. Any other fault resets the batch to a single page.
+  Pages already filled are never filled twice.
+
+  Once filled, pages are ordinary private anonymous memory. Writes to them are not written back to the source.
+
+  If this process may not handle faults taken by the kernel (see the Linux `vm.unprivileged_userfaultfd` sysctl),
+  only faults taken by user space are handled, so passing unfilled pages of the map to a syscall fails with `EFAULT`.
+
+  \note `fill` is called by the handler thread, so must be thread safe with respect to the rest of your program,
+  and must not touch the unfilled pages of the map, which would deadlock. If `fill` fails, the pages
+  are zero filled so the faulting thread can proceed, and the first such failure is reported by `lazy_status()`.
+
+  \param bytes How many bytes to create and map. Rounded up to a multiple of the page size.
+  \param fill The callable which fills `dest` with the bytes at `offset` within the map, returning how many it filled.
+  \param readahead The most bytes to fill per fault during sequential access. Zero means 1Mb.
+  \errors `errc::invalid_argument` if `bytes` is zero or `fill` is empty. `errc::not_supported` on platforms
+  other than Linux, or if the kernel was built without `userfaultfd` or denies it to this process.
+  Any of the values POSIX mmap(), userfaultfd() or ioctl() can return, or any of the values `std::thread` can throw.
+  \mallocs The lazy state, a staging buffer of `readahead` bytes, and a thread.
+  */
+  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<map_handle> map_lazy(size_type bytes, lazy_fill_type fill, size_type readahead = 0) noexcept;
+  /*! \brief Create new memory whose pages are read on demand from an i/o handle, the first time each is touched.
+
+  This is `map_lazy()` with a `fill` which reads from `source` at `offset` plus the offset within the map.
+  Reading past the end of `source` yields zeroed pages. `source` must remain open for the lifetime of the map.
+  */
+  static result<map_handle> map_lazy(size_type bytes, io_handle &source, extent_type offset = 0, size_type readahead = 0) noexcept
+  {
+    try
+    {
+      return map_lazy(bytes, detail::make_function_ptr<result<size_type>(extent_type, buffer_type)>([&source, offset](extent_type pos, buffer_type dest) -> result<size_type> {
+                        // A short read means the end of the source, but some handles may transfer less than
+                        // asked for elsewhere too, so keep reading until nothing more is returned
+                        size_type done = 0;
+                        while(done < dest.len)
+                        {
+                          OUTCOME_TRY(read, source.read(offset + pos + done, dest.data + done, dest.len - done));
+                          if(read.len == 0)
+                          {
+                            break;
+                          }
+                          // Some handles return their own storage rather than filling the buffer
+                          if(read.data != dest.data + done)
+                          {
+                            memcpy(dest.data + done, read.data, read.len);
+                          }
+                          done += read.len;
+                        }
+                        // Whatever lies past the end of the source reads as zeros
+                        memset(dest.data + done, 0, dest.len - done);
+                        return dest.len;
+                      }),
+                      readahead);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+  //! True if this map is filled on demand, see `map_lazy()`
+  bool is_lazy() const noexcept { return _lazy != nullptr; }
+  /*! \brief Returns the first failure of the fill of a lazy map, or success if there has been none, see `map_lazy()`.
+  Always success for maps which are not lazy.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> lazy_status() const noexcept;
 
   //! The memory section this handle is using
   section_handle *section() const noexcept { return _section; }
@@ -373,6 +503,69 @@ public:
   AFIO_MAKE_FREE_FUNCTION
   size_type length() const noexcept { return _length; }
 
+  /*! The size of the pages backing this map, which is one of `utils::page_sizes()`. For transparent
+  huge page maps, this reports the large page size only if the kernel collapsed the whole map into
+  large pages at creation, though the kernel may still promote parts of the map later.
+  */
+  size_type page_size() const noexcept { return _pagesize != 0 ? _pagesize : utils::page_size(); }
+
+  //! \brief Statistics about the pages of a map, see `page_statistics()`.
+  struct page_statistics_type
+  {
+    size_type pages{0};           //!< The number of pages examined.
+    size_type resident_pages{0};  //!< The number of those pages currently resident in memory.
+    size_type dirty_pages{0};     //!< The number of those pages modified but not yet written to storage, or `(size_type) -1` if this platform cannot tell.
+    uint64_t major_faults{0};     //!< The faults requiring i/o taken whilst accounting faults for this map, see `set_fault_accounting()`.
+    uint64_t minor_faults{0};     //!< The faults not requiring i/o taken whilst accounting faults for this map, see `set_fault_accounting()`.
+  };
+  /*! \brief Returns residency and fault statistics for a region of this map, or the whole map if the region is empty.
+
+  Residency is found using `mincore()` on POSIX and `QueryWorkingSetEx()` on Windows. Dirty pages are
+  found on Linux by parsing `/proc/self/smaps`, which reports dirty sizes per kernel mapping, so the
+  dirty count is an approximation if the region does not cover whole mappings. Other platforms cannot
+  report dirty pages. All of these are expensive, so don't call this in a hot path.
+
+  \errors Any of the values POSIX mincore() or QueryWorkingSetEx() can return.
+  \mallocs Several when parsing `/proc/self/smaps`.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<page_statistics_type> page_statistics(buffer_type region = {}) const noexcept;
+  /*! \brief Enables or disables the accounting of page faults taken whilst accessing this map.
+
+  When enabled, `write()` and any `fault_scope` instantiated upon this map count the major and
+  minor page faults taken by the calling thread, as reported by `getrusage()`, and add them to this
+  map's totals reported by `page_statistics()`. This costs two syscalls per accounted call. Only
+  Linux can count faults per thread, on other POSIX the faults of the whole process during the call
+  are counted. Windows cannot tell major from minor faults, and so reports all faults of the process
+  during the call as minor.
+
+  Disabling resets the totals, and must not be done whilst any `fault_scope` is outstanding.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> set_fault_accounting(bool enable) noexcept;
+  //! True if page faults are being accounted, see `set_fault_accounting()`
+  bool fault_accounting() const noexcept { return _faults != nullptr; }
+
+  /*! \brief Sets the NUMA placement policy of a region of this map, or the whole map if the region is empty.
+
+  Pages faulted in after this call are placed according to the policy. Pages already resident stay where
+  they are unless `move_existing` is true, in which case they are migrated, which is expensive.
+
+  \errors Any of the values `utils::apply_numa_policy()` can return, so always `errc::not_supported` on
+  Windows for any policy other than `mode::none`.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> set_numa_policy(utils::numa_policy policy, buffer_type region = {}, bool move_existing = false) noexcept;
+  /*! \brief Returns how many resident pages of a region of this map, or the whole map if the region is empty,
+  are upon each NUMA node.
+
+  Element N of the returned vector is the number of resident pages upon node N. Pages not resident are not
+  counted. This is found using `move_pages()` on Linux, and `QueryWorkingSetEx()` on Windows. It is
+  expensive, so don't call this in a hot path.
+
+  \errors Any of the values `move_pages()` or `QueryWorkingSetEx()` can return. `errc::not_supported` on
+  POSIX other than Linux.
+  \mallocs The returned vector.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::vector<size_type>> numa_distribution(buffer_type region = {}) const noexcept;
+
   //! Update the size of the memory map to that of any backing section, up to the reservation limit.
   result<size_type> update_map() noexcept
   {
@@ -411,13 +604,38 @@ public:
 
   \return The bytes actually reserved.
   \param newsize The bytes to truncate the map reservation to. Rounded up to the nearest page size (POSIX) or 64Kb on Windows.
-  \param permit_relocation Permit the address to change (some OSs provide a syscall for resizing
-  a memory map).
+  \param permit_relocation Permit the address to change, in which case this is equivalent to `relocate()`.
   \errors Any of the values POSIX `mremap()`, `mmap(addr)` or `VirtualAlloc(addr)` can return.
   */
   AFIO_MAKE_FREE_FUNCTION
   AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_type> truncate(size_type newsize, bool permit_relocation = false) noexcept;
 
+  /*! Resize the reservation of the memory map, moving it to a new address if it cannot be resized in place.
+
+  Unlike `truncate()`, this call never copies page contents. On Linux, `mremap(MREMAP_MAYMOVE)` is used
+  for both anonymous and file backed maps, which moves the page table entries rather than the pages,
+  so relocating a map of any size is O(1) and pages not yet faulted in stay that way.
+
+  On other platforms, or if the Linux kernel refuses to move the map in one go (e.g. because `commit()`,
+  `decommit()` or similar split it into regions of differing protection), an in place resize is tried
+  first. Failing that, a file backed map is remapped from its section at a new address and the old
+  address range released, which costs a page fault per page subsequently touched but no copying.
+  Anonymous and copy on write maps cannot be remapped without copying, so in that situation the call
+  fails with `errc::not_supported` and the map is left untouched.
+
+  After success `address()` returns the new base of the map and any pointers into the old address
+  range are invalid. The returned buffer is the new address and reservation, so callers can rebase
+  any pointers they hold.
+
+  \return The new address and reservation of the map.
+  \param newsize The bytes to resize the map reservation to. Rounded up to the nearest page size (POSIX) or 64Kb on Windows.
+  Must not be zero.
+  \errors Any of the values POSIX `mremap()` or `mmap()`, or Windows `NtMapViewOfSection()` can return.
+  `errc::invalid_argument` if `newsize` is zero, or if the map is not valid.
+  */
+  AFIO_MAKE_FREE_FUNCTION
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<buffer_type> relocate(size_type newsize) noexcept;
+
   //! Ask the system to commit the system resources to make the memory represented by the buffer available with the given permissions. addr and length should be page aligned (see utils::page_sizes()), if not the returned buffer is the region actually committed.
   AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<buffer_type> commit(buffer_type region, section_handle::flag flag = section_handle::flag::readwrite) noexcept;
 
@@ -452,6 +670,104 @@ public:
     return *ret.data();
   }
 
+  /*! \brief Synchronously fault in every page of the region given, returning the region actually populated.
+
+  Unlike `prefetch()` which merely hints to the kernel, this call returns only once the pages are resident
+  and mapped into the process, so subsequent access to them will not page fault. On Linux 5.14 or later
+  this is implemented using `MADV_POPULATE_READ` or `MADV_POPULATE_WRITE`, which also break copy on write
+  and allocate any backing storage for the latter. On other platforms every page is read, which does not
+  prevent the first write to each page from faulting.
+
+  \param region The region to populate. It must be accessible with the permissions implied by `for_write`.
+  \param for_write Whether to populate the pages as if written, rather than read.
+  \errors Any of the values POSIX madvise() can return.
+  */
+  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<buffer_type> populate(buffer_type region, bool for_write = false) noexcept;
+
+  class async_populate_state;
+  //! The type of the callable invoked as each region of an `async_populate()` completes
+  using async_populate_completion = detail::function_ptr<void(async_populate_state *, size_t, result<buffer_type>)>;
+  /*! \brief Asynchronously `populate()` the regions given on a background thread, in order.
+
+  The background threads are a pool shared by all maps, of no more threads than CPUs, so very
+  many populates in flight queue rather than each consuming a thread.
+
+  This avoids both the blocking of `section_handle::flag::prefault` and the page faults of a cold
+  map. Each region is reported as complete as soon as it has been populated, so you can begin to
+  use the first region whilst later ones are still loading: see `async_populate_state::wait()`.
+
+  If `completion` is supplied, it is invoked once per region in order. If `service` is not null,
+  completions are posted to it and so executed by the thread calling its `run()`, otherwise they
+  are executed by the background thread. Waiting upon a region may return before its completion
+  has been invoked.
+
+  \note The regions must remain mapped until the populate has completed or been cancelled and waited upon.
+
+  \return A shared state with which to wait upon, or cancel, the population of each region.
+  \param regions The regions to populate, which are copied.
+  \param for_write Whether to populate the pages as if written, rather than read.
+  \param service An optional i/o service to post completions to.
+  \param completion An optional callable to invoke as each region completes.
+  \errors Any of the values `std::thread` can throw.
+  \mallocs The shared state, a copy of the regions, the queued work and, if the pool has room, a thread.
+  */
+  static AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::shared_ptr<async_populate_state>> async_populate(span<buffer_type> regions, bool for_write = false, io_service *service = nullptr, async_populate_completion completion = {}) noexcept;
+
+  class async_barrier_state;
+  //! The type of the callable invoked when an `async_barrier()` completes
+  using async_barrier_completion = detail::function_ptr<void(async_barrier_state *, result<buffer_type>)>;
+  /*! \brief Begins writeback of the dirty pages in a region of this map, completing asynchronously
+  once they have reached storage.
+
+  Unlike `barrier()`, this call returns as soon as writeback has been scheduled, so a writer can
+  overlap durability with further work, and by issuing these regularly can bound the quantity of
+  dirty pages it accumulates. On POSIX writeback is scheduled using `msync(MS_ASYNC)`, plus on
+  Linux `sync_file_range(SYNC_FILE_RANGE_WRITE)` upon the backing file. A background thread, from
+  the pool shared with `async_populate()`, then waits for the pages to be written, using
+  `sync_file_range()` on Linux, `msync(MS_SYNC)` on other POSIX and `FlushViewOfFile()` on Windows,
+  and if `wait_for_device` or `and_metadata` are set calls `barrier()` upon the backing file. Maps
+  without a backing file complete immediately.
+
+  If `service` is not null, `completion` is posted to it and so executed by the thread calling its
+  `run()`, otherwise it is executed by the background thread. Waiting upon the barrier may return
+  before its completion has been invoked.
+
+  \note Closing or destroying the map waits for any barriers still in flight, including their
+  completions unless posted to `service`. The section and backing file must remain open until then,
+  and `service` must outlive the map.
+
+  \return A shared state with which to wait upon the barrier.
+  \param region The region to write back, which is rounded out to page boundaries. An empty region means the whole map.
+  \param wait_for_device True if you want the backing file to be flushed to the device.
+  \param and_metadata True if you want the backing file's metadata to be flushed too.
+  \param service An optional i/o service to post the completion to.
+  \param completion An optional callable to invoke when the barrier completes.
+  \errors `errc::invalid_argument` if the region is not within the map, any of the values POSIX
+  msync() can return, or any of the values `std::thread` can throw.
+  \mallocs The shared state, the queued work, upon first use the map's count of barriers in flight and,
+  if the pool has room, a thread.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::shared_ptr<async_barrier_state>> async_barrier(buffer_type region = {}, bool wait_for_device = false, bool and_metadata = false, io_service *service = nullptr, async_barrier_completion completion = {}) noexcept;
+
+  /*! \brief Send a range of the mapped view to a pipe or socket without copying it through userspace.
+
+  On Linux, if the destination is a pipe, the pages of the map are spliced into the pipe using `vmsplice()`.
+  The pipe then refers to the map's pages rather than to a copy of them, so you must not modify or unmap
+  the range until the reader has consumed it, else the reader may see the modifications. For all other
+  destinations, and on other platforms, the range is `write()`n directly from the map.
+
+  Non-blocking destinations which would block are polled until the deadline as per `file_handle::send_to()`.
+
+  \return The bytes sent, which will be less than requested if the end of the map was reached.
+  \param dest The native handle of a pipe or socket to send to. It is not adopted.
+  \param offset The offset within the map to send from.
+  \param bytes The number of bytes to send.
+  \param d An optional deadline by which the transfer must complete.
+  \errors Any of the values POSIX vmsplice(), write() or poll() can return, `errc::timed_out`.
+  \mallocs None.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_type> send_to(native_handle_type dest, extent_type offset, size_type bytes, deadline d = deadline()) const noexcept;
+
   /*! \brief Read data from the mapped view.
 
   \note Because this implementation never copies memory, you can pass in buffers with a null address.
@@ -481,6 +797,159 @@ public:
   using io_handle::write;
 };
 
+/*! \class map_handle::async_populate_state
+\brief The shared state of an in progress `map_handle::async_populate()`.
+*/
+class AFIO_DECL map_handle::async_populate_state : public std::enable_shared_from_this<map_handle::async_populate_state>
+{
+  friend class map_handle;
+  static constexpr int _pending = -1, _cancelled = -2;
+  std::vector<buffer_type> _regions;
+  std::unique_ptr<std::atomic<int>[]> _status;  // _pending, _cancelled, else the system error code (zero is success)
+  std::atomic<bool> _cancel{false};
+  mutable std::mutex _lock;
+  mutable std::condition_variable _changed;
+  io_service *_service{nullptr};
+  async_populate_completion _completion;
+
+  result<buffer_type> _result(size_t idx) const noexcept
+  {
+    int status = _status[idx].load(std::memory_order_acquire);
+    if(status == _cancelled)
+    {
+      return std::errc::operation_canceled;
+    }
+    if(status != 0)
+    {
+      return {status, std::system_category()};
+    }
+    return _regions[idx];
+  }
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _run(bool for_write) noexcept;
+
+public:
+  //! Constructs an instance for the given regions
+  explicit async_populate_state(span<buffer_type> regions)
+      : _regions(regions.data(), regions.data() + regions.size())
+      , _status(new std::atomic<int>[regions.size()])
+  {
+    for(size_t n = 0; n < _regions.size(); n++)
+    {
+      _status[n].store(_pending, std::memory_order_relaxed);
+    }
+  }
+  async_populate_state(const async_populate_state &) = delete;
+  async_populate_state(async_populate_state &&) = delete;
+  async_populate_state &operator=(const async_populate_state &) = delete;
+  async_populate_state &operator=(async_populate_state &&) = delete;
+  ~async_populate_state() = default;
+
+  //! The number of regions being populated
+  size_t size() const noexcept { return _regions.size(); }
+  //! True if region `idx` has completed, successfully or otherwise
+  bool is_ready(size_t idx) const noexcept { return _status[idx].load(std::memory_order_acquire) != _pending; }
+  //! True if all regions have completed
+  bool is_ready() const noexcept { return _regions.empty() || is_ready(_regions.size() - 1); }
+  //! Cancels the population of any regions not yet begun, which will complete with `errc::operation_canceled`
+  void cancel() noexcept { _cancel.store(true, std::memory_order_release); }
+  /*! Waits until region `idx` has completed, returning the region populated.
+  \errors `errc::timed_out`, `errc::operation_canceled`, or any of the values `populate()` can return.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<buffer_type> wait(size_t idx, deadline d = deadline()) const noexcept;
+  /*! Waits until all regions have completed, returning the first failure if any. The deadline
+  is for the whole wait, not for each region.
+  \errors `errc::timed_out`, `errc::operation_canceled`, or any of the values `populate()` can return.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> wait(deadline d = deadline()) const noexcept;
+};
+
+/*! \class map_handle::async_barrier_state
+\brief The shared state of an in progress `map_handle::async_barrier()`.
+*/
+class AFIO_DECL map_handle::async_barrier_state : public std::enable_shared_from_this<map_handle::async_barrier_state>
+{
+  friend class map_handle;
+  buffer_type _region;
+  file_handle *_backing{nullptr};
+  extent_type _offset{0};  // of the region within the backing file
+  bool _wait_for_device{false}, _and_metadata{false};
+  std::atomic<bool> _ready{false};
+  std::error_code _error;  // written before _ready is set
+  mutable std::mutex _lock;
+  mutable std::condition_variable _changed;
+  io_service *_service{nullptr};
+  async_barrier_completion _completion;
+
+  result<buffer_type> _result() const noexcept
+  {
+    if(_error)
+    {
+      return _error;
+    }
+    return _region;
+  }
+  // Schedules writeback, called by async_barrier()
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _start() noexcept;
+  // Waits for writeback, called by the background thread
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _finish() noexcept;
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _run() noexcept;
+
+public:
+  //! Constructs an instance for the given region
+  explicit async_barrier_state(buffer_type region)
+      : _region(region)
+  {
+  }
+  async_barrier_state(const async_barrier_state &) = delete;
+  async_barrier_state(async_barrier_state &&) = delete;
+  async_barrier_state &operator=(const async_barrier_state &) = delete;
+  async_barrier_state &operator=(async_barrier_state &&) = delete;
+  ~async_barrier_state() = default;
+
+  //! The region being written back
+  buffer_type region() const noexcept { return _region; }
+  //! True if the barrier has completed, successfully or otherwise
+  bool is_ready() const noexcept { return _ready.load(std::memory_order_acquire); }
+  /*! Waits until the barrier has completed, returning the region written back.
+  \errors `errc::timed_out`, or any of the values `map_handle::barrier()` can return.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<buffer_type> wait(deadline d = deadline()) const noexcept;
+};
+
+/*! \class map_handle::fault_scope
+\brief Adds the page faults taken by the calling thread during its lifetime to the totals of a map,
+if fault accounting is enabled for that map. Wrap direct accesses to the map's memory in one of these.
+*/
+class map_handle::fault_scope
+{
+  _fault_counters *_faults;
+  uint64_t _major{0}, _minor{0};
+
+public:
+  //! Begins counting the faults taken by this thread, if `h` has fault accounting enabled
+  explicit fault_scope(const map_handle &h) noexcept : _faults(h._faults)
+  {
+    if(_faults != nullptr)
+    {
+      _fault_counts(_major, _minor);
+    }
+  }
+  fault_scope(const fault_scope &) = delete;
+  fault_scope(fault_scope &&) = delete;
+  fault_scope &operator=(const fault_scope &) = delete;
+  fault_scope &operator=(fault_scope &&) = delete;
+  ~fault_scope()
+  {
+    if(_faults != nullptr)
+    {
+      uint64_t major = 0, minor = 0;
+      _fault_counts(major, minor);
+      _faults->major.fetch_add(major - _major, std::memory_order_relaxed);
+      _faults->minor.fetch_add(minor - _minor, std::memory_order_relaxed);
+    }
+  }
+};
+
 //! \brief Constructor for `map_handle`
 template <> struct construct<map_handle>
 {
@@ -531,35 +1000,64 @@ inline map_handle::io_result<map_handle::const_buffers_type> barrier(map_handle
 /*! Create new memory and map it into view.
 \param bytes How many bytes to create and map. Typically will be rounded to a multiple of the page size (see utils::page_sizes()).
 \param _flag The permissions with which to map the view which are constrained by the permissions of the memory section. `flag::none` can be useful for reserving virtual address space without committing system resources, use commit() to later change availability of memory.
+\param numa The NUMA placement policy of the new memory, applied before any page is faulted in (see `utils::numa_policy`).
 
 \note On Microsoft Windows this constructor uses the faster VirtualAlloc() which creates less versatile page backed memory. If you want anonymous memory
 allocated from a paging file backed section instead, create a page file backed section and then a mapped view from that using
 the other constructor. This makes available all those very useful VM tricks Windows can do with section mapped memory which
 VirtualAlloc() memory cannot do.
 
-\errors Any of the values POSIX mmap() or VirtualAlloc() can return.
+\errors Any of the values POSIX mmap(), mbind() or VirtualAlloc() can return.
 */
-inline result<map_handle> map(map_handle::size_type bytes, section_handle::flag _flag = section_handle::flag::readwrite) noexcept
+inline result<map_handle> map(map_handle::size_type bytes, section_handle::flag _flag = section_handle::flag::readwrite, utils::numa_policy numa = {}) noexcept
 {
-  return map_handle::map(std::forward<decltype(bytes)>(bytes), std::forward<decltype(_flag)>(_flag));
+  return map_handle::map(std::forward<decltype(bytes)>(bytes), std::forward<decltype(_flag)>(_flag), std::forward<decltype(numa)>(numa));
 }
 /*! Create a memory mapped view of a backing storage.
 \param section A memory section handle specifying the backing storage to use.
 \param bytes How many bytes to map (0 = the size of the memory section). Typically will be rounded to a multiple of the page size (see utils::page_sizes()).
 \param offset The offset into the backing storage to map from. Typically needs to be at least a multiple of the page size (see utils::page_sizes()), on Windows it needs to be a multiple of the kernel memory allocation granularity (typically 64Kb).
 \param _flag The permissions with which to map the view which are constrained by the permissions of the memory section. `flag::none` can be useful for reserving virtual address space without committing system resources, use commit() to later change availability of memory.
-
-\errors Any of the values POSIX mmap() or NtMapViewOfSection() can return.
+\param numa The NUMA placement policy of pages of the section faulted in through this view (see `utils::numa_policy`). Ignored on Windows.
+\errors Any of the values POSIX mmap(), mbind() or NtMapViewOfSection() can return.
 */
-inline result<map_handle> map(section_handle &section, map_handle::size_type bytes = 0, map_handle::extent_type offset = 0, section_handle::flag _flag = section_handle::flag::readwrite) noexcept
+inline result<map_handle> map(section_handle &section, map_handle::size_type bytes = 0, map_handle::extent_type offset = 0, section_handle::flag _flag = section_handle::flag::readwrite, utils::numa_policy numa = {}) noexcept
 {
-  return map_handle::map(std::forward<decltype(section)>(section), std::forward<decltype(bytes)>(bytes), std::forward<decltype(offset)>(offset), std::forward<decltype(_flag)>(_flag));
+  return map_handle::map(std::forward<decltype(section)>(section), std::forward<decltype(bytes)>(bytes), std::forward<decltype(offset)>(offset), std::forward<decltype(_flag)>(_flag), std::forward<decltype(numa)>(numa));
 }
 //! The size of the memory map.
 inline map_handle::size_type length(const map_handle &self) noexcept
 {
   return self.length();
 }
+/*! Resize the reservation of the memory map, moving it to a new address if it cannot be resized in place.
+
+Unlike `truncate()`, this call never copies page contents. On Linux, `mremap(MREMAP_MAYMOVE)` is used
+for both anonymous and file backed maps, which moves the page table entries rather than the pages,
+so relocating a map of any size is O(1) and pages not yet faulted in stay that way.
+
+On other platforms, or if the Linux kernel refuses to move the map in one go (e.g. because `commit()`,
+`decommit()` or similar split it into regions of differing protection), an in place resize is tried
+first. Failing that, a file backed map is remapped from its section at a new address and the old
+address range released, which costs a page fault per page subsequently touched but no copying.
+Anonymous and copy on write maps cannot be remapped without copying, so in that situation the call
+fails with `errc::not_supported` and the map is left untouched.
+
+After success `address()` returns the new base of the map and any pointers into the old address
+range are invalid. The returned buffer is the new address and reservation, so callers can rebase
+any pointers they hold.
+
+\return The new address and reservation of the map.
+\param self The object whose member function to call.
+\param newsize The bytes to resize the map reservation to. Rounded up to the nearest page size (POSIX) or 64Kb on Windows.
+Must not be zero.
+\errors Any of the values POSIX `mremap()` or `mmap()`, or Windows `NtMapViewOfSection()` can return.
+`errc::invalid_argument` if `newsize` is zero, or if the map is not valid.
+*/
+inline result<map_handle::buffer_type> relocate(map_handle &self, map_handle::size_type newsize) noexcept
+{
+  return self.relocate(std::forward<decltype(newsize)>(newsize));
+}
 /*! \brief Read data from the mapped view.
 
 \note Because this implementation never copies memory, you can pass in buffers with a null address.
@@ -601,6 +1099,7 @@ AFIO_V2_NAMESPACE_END
 #else
 #include "detail/impl/posix/map_handle.ipp"
 #endif
+#include "detail/impl/map_handle.ipp"
 #undef AFIO_INCLUDED_BY_HEADER
 #endif
 
@@ -98,6 +98,15 @@ entirely manual system is a bit tedious and cumbersome to use, but as mapping fi
 is an expensive operation given TLB shootdown, we leave it up to the end user to decide
 when to expend the cost of mapping.
 
+Alternatively, if you have plenty of address space, you can call `reserve_address_space()`
+to set aside a very large inaccessible region up front. From then on, `address()` never changes
+however much the file grows within that region, as growing the reservation maps more of the file
+in place over the inaccessible pages. `length()` is then published atomically after each
+extension, so threads reading the map need only fetch `length()` before accessing memory up to
+that length, and need not be excluded whilst another thread extends the file. Only one thread
+may extend or shrink the file at a time, and shrinking still requires that no other thread be
+accessing the region being truncated away.
+
 \warning You must be cautious when the file is being extended by third parties which are
 not using this `mapped_file_handle` to write the new data. With unified page cache kernels,
 mixing mapped and normal i/o is generally safe except at the end of a file where race
@@ -126,6 +135,8 @@ public:
 
 protected:
   size_type _reservation{0};
+  size_type _address_space{0};                     // non-zero if growing within a fixed address space reservation
+  std::atomic<extent_type> _published_length{0};  // the length readers may access if growing within _address_space
   section_handle _sh;  // Tracks the file (i.e. *this) somewhat lazily
   map_handle _mh;      // The current map with valid extent
 
@@ -134,7 +145,7 @@ public:
   constexpr mapped_file_handle() {}  // NOLINT
 
   //! Implicit move construction of mapped_file_handle permitted
-  mapped_file_handle(mapped_file_handle &&o) noexcept : file_handle(std::move(o)), _reservation(o._reservation), _sh(std::move(o._sh)), _mh(std::move(o._mh))
+  mapped_file_handle(mapped_file_handle &&o) noexcept : file_handle(std::move(o)), _reservation(o._reservation), _address_space(o._address_space), _published_length(o._published_length.load(std::memory_order_relaxed)), _sh(std::move(o._sh)), _mh(std::move(o._mh))
   {
     _sh.set_backing(this);
     _mh.set_section(&_sh);
@@ -296,12 +307,24 @@ public:
   //! The address in memory where this mapped file resides
   char *address() const noexcept { return _mh.address(); }
 
+  //! Residency and fault statistics for a region of the map, or the whole map if the region is empty. See `map_handle::page_statistics()`.
+  result<map_handle::page_statistics_type> page_statistics(map_handle::buffer_type region = {}) const noexcept { return _mh.page_statistics(region); }
+  //! Enables or disables the accounting of page faults taken by `write()` and any `map_handle::fault_scope` upon `map()`. See `map_handle::set_fault_accounting()`.
+  result<void> set_fault_accounting(bool enable) noexcept { return _mh.set_fault_accounting(enable); }
+  //! Sets the NUMA placement policy of a region of the map, or the whole map if the region is empty. See `map_handle::set_numa_policy()`.
+  result<void> set_numa_policy(utils::numa_policy policy, map_handle::buffer_type region = {}, bool move_existing = false) noexcept { return _mh.set_numa_policy(policy, region, move_existing); }
+  //! The number of resident pages of a region of the map, or the whole map if the region is empty, upon each NUMA node. See `map_handle::numa_distribution()`.
+  result<std::vector<size_type>> numa_distribution(map_handle::buffer_type region = {}) const noexcept { return _mh.numa_distribution(region); }
+
   //! The length of the underlying file
   result<extent_type> underlying_file_length() const noexcept { return file_handle::length(); }
 
   //! The address space (to be) reserved for future expansion of this file.
   size_type capacity() const noexcept { return _reservation; }
 
+  //! The address space within which this file can grow without `address()` changing, or zero if `reserve_address_space()` has not been called.
+  size_type address_space() const noexcept { return _address_space; }
+
   /*! \brief Reserve a new amount of address space for mapping future expansion of this file.
   \param reservation The number of bytes of virtual address space to reserve. Zero means reserve
   the current length of the underlying file.
@@ -311,6 +334,25 @@ public:
   */
   AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_type> reserve(size_type reservation = 0) noexcept;
 
+  /*! \brief Reserve a fixed region of address space within which this file can grow and shrink
+  without `address()` ever changing.
+
+  On POSIX the whole region is reserved with `PROT_NONE` and without committing memory, and the
+  current reservation of the file is mapped over its front with `MAP_FIXED`. Thereafter `reserve()`
+  and `truncate()` map or unmap the tail of the reservation in place, and publish the new `length()`
+  atomically, so threads accessing the map concurrently with growth see a stable address and need
+  no other synchronisation. On Windows the view of the section spans the whole region, and extending
+  the section makes more of the view accessible in place. Windows cannot shrink a file with a section
+  open upon it, so shrinking the file on Windows still closes and recreates the map at a new address.
+
+  Once called, `reserve()` and `truncate()` will fail with `errc::not_enough_memory` rather than
+  exceed the region. Calling this function again chooses a new region, and a new `address()`.
+
+  \param bytes The bytes of address space to reserve, which cannot be less than the current reservation.
+  On 64 bit platforms this can be terabytes, as only the address space is consumed.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_type> reserve_address_space(size_type bytes) noexcept;
+
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC ~mapped_file_handle() override
   {
     if(_v)
@@ -321,6 +363,8 @@ public:
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override;
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC native_handle_type release() noexcept override;
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> barrier(io_request<const_buffers_type> reqs = io_request<const_buffers_type>(), bool wait_for_device = false, bool and_metadata = false, deadline d = deadline()) noexcept override { return _mh.barrier(reqs, wait_for_device, and_metadata, d); }
+  //! Begins writeback of the dirty pages in a region of the map, completing asynchronously once they have reached storage. See `map_handle::async_barrier()`.
+  result<std::shared_ptr<map_handle::async_barrier_state>> async_barrier(map_handle::buffer_type region = {}, bool wait_for_device = false, bool and_metadata = false, io_service *service = nullptr, map_handle::async_barrier_completion completion = {}) noexcept { return _mh.async_barrier(region, wait_for_device, and_metadata, service, std::move(completion)); }
   AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<file_handle> clone(mode mode_ = mode::unchanged, caching caching_ = caching::unchanged, deadline d = std::chrono::seconds(30)) const noexcept override
   {
     OUTCOME_TRY(fh, file_handle::clone(mode_, caching_, d));
@@ -332,8 +376,35 @@ public:
     OUTCOME_TRY(fh, file_handle::clone(mode_, caching_, d));
     return mapped_file_handle(std::move(fh), reservation);
   }
+  /*! \brief Takes a point in time snapshot of a range of this file, returning it mapped.
+
+  The snapshot is a new anonymous inode created, where possible, in the same directory as this file.
+  Readers can scan it without locks whilst writers continue to modify this file, and it ceases to
+  exist when closed. On Linux the range's extents are shared with the snapshot using
+  `ioctl(FICLONERANGE)` if the filing system supports reflinks (e.g. btrfs, XFS), so the snapshot
+  costs no copying of data, and only pages later modified in this file consume extra storage. Failing
+  that, `copy_file_range()` is used, which copies within the kernel, or shares extents on filing
+  systems able to. On other platforms, or if all else fails, the range is copied out of the map.
+
+  Writes to this file complete before this call are always in the snapshot, and writes after it are
+  never in the snapshot. Writes racing with this call may or may not be, so if you need a multi-page
+  update to be atomic with respect to snapshots, exclude snapshots whilst making the update.
+
+  \note Mapping a private copy on write view of this file, as `section_handle::flag::cow` does, is
+  not a snapshot on most kernels, as pages not yet written to by the private view show later
+  modifications of the file.
+
+  \return A mapped file handle of the snapshot, whose offset zero is `offset` in this file.
+  \param offset The offset in this file to begin the snapshot from.
+  \param bytes The bytes to snapshot, or zero for up to the end of the file.
+  \errors Any of the values `file_handle::temp_inode()`, `truncate()` and `write()` can return, and
+  `errc::invalid_argument` if the range is empty or beyond the end of the file.
+  \mallocs Those of `parent_path_handle()`.
+  */
+  AFIO_HEADERS_ONLY_MEMFUNC_SPEC result<mapped_file_handle> snapshot(extent_type offset = 0, extent_type bytes = 0) const noexcept;
+
   //! Return the current maximum permitted extent of the file.
-  AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> length() const noexcept override { return _mh.length(); }
+  AFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> length() const noexcept override { return (_address_space != 0) ? _published_length.load(std::memory_order_acquire) : static_cast<extent_type>(_mh.length()); }
 
   /*! \brief Resize the current maximum permitted extent of the mapped file to the given extent, avoiding any
   new allocation of physical storage where supported, and mapping or unmapping any new pages
@@ -384,7 +455,7 @@ public:
   \errors None, though the various signals and structured exception throws common to using memory maps may occur.
   \mallocs None.
   */
-  AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override { return _mh.read(reqs, d); }
+  AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override { return _mh.read(_clamp_to_length(reqs), d); }
   /*! \brief Write data to the mapped file.
 
   \return The buffers written, which will never be the buffers input because they will point at where the data was copied into the mapped view.
@@ -394,7 +465,39 @@ public:
   \errors None, though the various signals and structured exception throws common to using memory maps may occur.
   \mallocs None.
   */
-  AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override { return _mh.write(reqs, d); }
+  AFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override { return _mh.write(_clamp_to_length(reqs), d); }
+
+protected:
+  // When growing within a fixed address space reservation the map spans the whole region, so bound i/o by the published length instead
+  template <class T> io_request<T> _clamp_to_length(io_request<T> reqs) const noexcept
+  {
+    if(_address_space != 0)
+    {
+      extent_type length = _published_length.load(std::memory_order_acquire);
+      extent_type togo = reqs.offset < length ? (length - reqs.offset) : 0;
+      for(auto &req : reqs.buffers)
+      {
+        if(req.len > togo)
+        {
+          req.len = static_cast<size_type>(togo);
+        }
+        togo -= req.len;
+      }
+    }
+    return reqs;
+  }
+  // Publishes the length readers may access
+  void _publish_length(extent_type length) noexcept
+  {
+    if(_address_space != 0)
+    {
+      _published_length.store(length, std::memory_order_release);
+    }
+    else
+    {
+      _mh._length = static_cast<size_type>(length);
+    }
+  }
 };
 
 //! \brief Constructor for `mapped_file_handle`
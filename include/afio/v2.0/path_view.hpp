@@ -27,6 +27,8 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "config.hpp"
 
+#include <new>  // for nothrow
+
 //! \file path_view.hpp Provides view of a path
 
 #ifdef _MSC_VER
@@ -422,7 +424,12 @@ public:
   // iterator begin() const;
   // iterator end() const;
 
-  //! Instantiate from a `path_view` to get a zero terminated path suitable for feeding to the kernel
+  /*! Instantiate from a `path_view` to get a zero terminated path suitable for feeding to the kernel.
+
+  If the view is already zero terminated, it is used directly. Otherwise it is copied into a small
+  internal buffer, or if too long for that into a buffer allocated from the heap. Nothing is ever
+  zero filled, so constructing one of these for a short path costs nanoseconds.
+  */
   struct AFIO_DECL c_str
   {
     //! Number of characters, excluding zero terminating char, at buffer
@@ -452,15 +459,11 @@ public:
           buffer = view._state._utf16.data();
           return;
         }
-        // Otherwise use _buffer and zero terminate.
-        if(length > sizeof(_buffer) - 1)
-        {
-          AFIO_LOG_FATAL(&view, "Attempt to send a path exceeding 64Kb to kernel");
-          abort();
-        }
-        memcpy(_buffer, view._state._utf16.data(), length);
-        _buffer[length] = 0;
-        buffer = _buffer;
+        // Otherwise copy and zero terminate
+        filesystem::path::value_type *p = _reserve(length + 1);
+        memcpy(p, view._state._utf16.data(), length * sizeof(filesystem::path::value_type));
+        p[length] = 0;
+        buffer = p;
         return;
       }
       if(!view._state._utf8.empty())
@@ -475,7 +478,7 @@ public:
       {
         if(view._state._utf8.size() > 32768)
         {
-          AFIO_LOG_FATAL(&view, "Attempt to send a path exceeding 64Kb to kernel");
+          AFIO_LOG_FATAL(&view, "Attempt to send a path exceeding 32Kb to kernel");
           abort();
         }
         length = static_cast<uint16_t>(view._state._utf8.size());
@@ -485,15 +488,11 @@ public:
           buffer = view._state._utf8.data();
           return;
         }
-        // Otherwise use _buffer and zero terminate.
-        if(length > sizeof(_buffer) - 1)
-        {
-          AFIO_LOG_FATAL(&view, "Attempt to send a path exceeding 32Kb to kernel");
-          abort();
-        }
-        memcpy(_buffer, view._state._utf8.data(), length);
-        _buffer[length] = 0;
-        buffer = _buffer;
+        // Otherwise copy and zero terminate
+        filesystem::path::value_type *p = _reserve(length + 1);
+        memcpy(p, view._state._utf8.data(), length);
+        p[length] = 0;
+        buffer = p;
         return;
       }
 #endif
@@ -501,14 +500,33 @@ public:
       _buffer[0] = 0;
       buffer = _buffer;
     }
-    ~c_str() = default;
+    ~c_str() { delete[] _allocated; }
     c_str(const c_str &) = delete;
     c_str(c_str &&) = delete;
     c_str &operator=(const c_str &) = delete;
     c_str &operator=(c_str &&) = delete;
 
   private:
-    filesystem::path::value_type _buffer[32768]{};
+    // Most paths fit into this, which is deliberately left uninitialised
+    filesystem::path::value_type _buffer[256];
+    // Longer paths are copied here
+    filesystem::path::value_type *_allocated{nullptr};
+
+    // Returns storage for at least count characters
+    filesystem::path::value_type *_reserve(size_t count) noexcept
+    {
+      if(count <= sizeof(_buffer) / sizeof(_buffer[0]))
+      {
+        return _buffer;
+      }
+      _allocated = new(std::nothrow) filesystem::path::value_type[count];
+      if(_allocated == nullptr)
+      {
+        AFIO_LOG_FATAL(this, "Failed to allocate memory for a zero terminated path");
+        abort();
+      }
+      return _allocated;
+    }
 #ifdef _WIN32
     AFIO_HEADERS_ONLY_MEMFUNC_SPEC void _from_utf8(const path_view &view) noexcept;
 #endif
@@ -72,6 +72,29 @@ namespace utils
     i.len = (i.len + pagesize - 1) & ~(pagesize - 1);
     return i;
   }
+  /*! \brief Round a value to its next lowest multiple of `pagesize`, which must be a power of two e.g. one of `page_sizes()`
+  */
+  template <class T> inline T round_down_to_page_size(T i, size_t pagesize) noexcept
+  {
+    i = (T)(AFIO_V2_NAMESPACE::detail::unsigned_integer_cast<uintptr_t>(i) & ~(pagesize - 1));  // NOLINT
+    return i;
+  }
+  /*! \brief Round a value to its next highest multiple of `pagesize`, which must be a power of two e.g. one of `page_sizes()`
+  */
+  template <class T> inline T round_up_to_page_size(T i, size_t pagesize) noexcept
+  {
+    i = (T)((AFIO_V2_NAMESPACE::detail::unsigned_integer_cast<uintptr_t>(i) + pagesize - 1) & ~(pagesize - 1));  // NOLINT
+    return i;
+  }
+  /*! \brief Round a pair of a pointer and a size_t to their nearest multiples of `pagesize`, which must be a power of two
+  e.g. one of `page_sizes()`. The pointer will be rounded down, the size_t upwards.
+  */
+  template <class T> inline T round_to_page_size(T i, size_t pagesize) noexcept
+  {
+    i.data = reinterpret_cast<char *>((AFIO_V2_NAMESPACE::detail::unsigned_integer_cast<uintptr_t>(i.data)) & ~(pagesize - 1));
+    i.len = (i.len + pagesize - 1) & ~(pagesize - 1);
+    return i;
+  }
 
   /*! \brief Returns the page sizes of this architecture which is useful for calculating direct i/o multiples.
 
@@ -153,6 +176,66 @@ namespace utils
   */
   AFIO_HEADERS_ONLY_FUNC_SPEC result<void> drop_filesystem_cache() noexcept;
 
+  /*! \brief A NUMA memory placement policy.
+  \ingroup utils
+
+  By default memory is placed upon whichever NUMA node first touches each page. A policy lets you
+  instead bind pages to a set of nodes, interleave them across a set of nodes, or prefer a node.
+  Nodes are a bitmask, so only the first 64 nodes can be named.
+
+  On Windows, only a preferred node can be requested, and only when memory is allocated. `bind` is
+  treated as preferring the lowest numbered node in the set, and `interleave` is not supported.
+  */
+  struct numa_policy
+  {
+    //! How pages are placed
+    enum class mode : unsigned char
+    {
+      none,        //!< The system default, usually the node of the thread first touching each page
+      bind,        //!< Only place pages upon the nodes in `nodes`, failing when those are exhausted
+      interleave,  //!< Place pages round robin across the nodes in `nodes`
+      preferred    //!< Place pages upon the lowest numbered node in `nodes` if possible, else elsewhere
+    } policy{mode::none};
+    //! Bitmask of NUMA nodes, where bit N is node N
+    uint64_t nodes{0};
+
+    constexpr numa_policy() {}  // NOLINT
+    constexpr numa_policy(mode _policy, uint64_t _nodes)
+        : policy(_policy)
+        , nodes(_nodes)
+    {
+    }
+    //! True if this is not the system default policy
+    constexpr explicit operator bool() const noexcept { return policy != mode::none; }
+  };
+
+  /*! \brief Sets the NUMA placement policy of a region of address space.
+  \ingroup utils
+
+  Pages not yet faulted in will be placed according to the policy when they are. Pages already
+  faulted in stay where they are unless `move_existing` is true, in which case they are migrated.
+  If the system has no NUMA support, this succeeds without doing anything.
+
+  \param addr The page aligned start of the region.
+  \param bytes The size of the region. Rounded up to the page size.
+  \param policy The policy to apply.
+  \param move_existing Whether to migrate already resident pages to comply with the policy.
+  \errors Any of the values POSIX `mbind()` can return. `errc::not_supported` on Windows unless `policy`
+  is `mode::none`, as Windows can only place memory when it is allocated.
+  */
+  AFIO_HEADERS_ONLY_FUNC_SPEC result<void> apply_numa_policy(void *addr, size_t bytes, numa_policy policy, bool move_existing = false) noexcept;
+
+  /*! \brief Sets the NUMA placement policy of all future memory allocations by the calling thread
+  which do not have a policy of their own.
+  \ingroup utils
+
+  If the system has no NUMA support, this succeeds without doing anything.
+
+  \errors Any of the values POSIX `set_mempolicy()` can return. `errc::not_supported` on Windows unless
+  `policy` is `mode::none`.
+  */
+  AFIO_HEADERS_ONLY_FUNC_SPEC result<void> set_thread_numa_policy(numa_policy policy) noexcept;
+
   namespace detail
   {
     struct large_page_allocation
@@ -180,7 +263,7 @@ namespace utils
       ret.actual_size = (bytes + ret.page_size_used - 1) & ~(ret.page_size_used - 1);
       return ret;
     }
-    AFIO_HEADERS_ONLY_FUNC_SPEC large_page_allocation allocate_large_pages(size_t bytes);
+    AFIO_HEADERS_ONLY_FUNC_SPEC large_page_allocation allocate_large_pages(size_t bytes, numa_policy numa = {});
     AFIO_HEADERS_ONLY_FUNC_SPEC void deallocate_large_pages(void *p, size_t bytes);
   }  // namespace detail
   /*! \class page_allocator
@@ -205,9 +288,16 @@ namespace utils
   Be aware that as soon as the allocation exceeds a large page size, most
   systems allocate in multiples of the large page size, so if the large page
   size were 2Mb and you allocate 2Mb + 1 byte, 4Mb is actually consumed.
+
+  An allocator constructed with a `numa_policy` places its allocations
+  according to that policy. Any page_allocator can deallocate memory allocated
+  by any other.
   */
   template <typename T> class page_allocator
   {
+    template <typename U> friend class page_allocator;
+    numa_policy _numa;
+
   public:
     using value_type = T;
     using pointer = T *;
@@ -226,7 +316,13 @@ namespace utils
 
     constexpr page_allocator() noexcept {}  // NOLINT
 
-    template <class U> page_allocator(const page_allocator<U> & /*unused*/) noexcept {}  // NOLINT
+    //! Constructs an allocator placing its allocations according to `numa`
+    constexpr explicit page_allocator(numa_policy numa) noexcept : _numa(numa) {}
+
+    template <class U> page_allocator(const page_allocator<U> &o) noexcept : _numa(o._numa) {}  // NOLINT
+
+    //! The NUMA placement policy of allocations
+    numa_policy numa() const noexcept { return _numa; }
 
     size_type max_size() const noexcept { return size_type(~0U) / sizeof(T); }
 
@@ -240,7 +336,7 @@ namespace utils
       {
         throw std::bad_alloc();
       }
-      auto mem(detail::allocate_large_pages(n * sizeof(T)));
+      auto mem(detail::allocate_large_pages(n * sizeof(T), _numa));
       if(mem.p == nullptr)
       {
         throw std::bad_alloc();
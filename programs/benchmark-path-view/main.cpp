@@ -0,0 +1,69 @@
+/* Test the performance of making zero terminated paths from path_view
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+//! Constructions of path_view::c_str per measurement
+#define BENCHMARK_ITERATIONS 10000000
+
+#define _CRT_SECURE_NO_WARNINGS 1
+
+#include "../../include/afio/afio.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace afio = AFIO_V2_NAMESPACE;
+
+static volatile size_t sink;
+
+// Returns the nanoseconds per construction of a path_view::c_str from the view
+static double benchmark(afio::path_view view)
+{
+  size_t total = 0;
+  auto begin = std::chrono::high_resolution_clock::now();
+  for(size_t n = 0; n < BENCHMARK_ITERATIONS; n++)
+  {
+#ifdef _WIN32
+    afio::path_view::c_str zpath(view, false);
+#else
+    afio::path_view::c_str zpath(view);
+#endif
+    total += zpath.length + static_cast<size_t>(zpath.buffer[n % (zpath.length + 1)]);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  sink = total;
+  return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / BENCHMARK_ITERATIONS;
+}
+
+int main()
+{
+  // The views below of the first 27 characters are not zero terminated, so must be copied
+  const std::string shortpath("/home/ned/documents/foo.txt/bar");
+  const std::string longpath(std::string("/home/ned/") + std::string(1000, 'a') + "/bar");
+  std::cout << "Benchmarking " << BENCHMARK_ITERATIONS << " constructions of path_view::c_str per case ..." << std::endl;
+  std::cout << "  Zero terminated view: " << benchmark(afio::path_view(shortpath.c_str())) << " ns" << std::endl;
+  std::cout << "  Short view needing a copy: " << benchmark(afio::path_view(shortpath.data(), 27)) << " ns" << std::endl;
+  std::cout << "  Long view needing an allocation: " << benchmark(afio::path_view(longpath.data(), longpath.size() - 4)) << " ns" << std::endl;
+  return 0;
+}
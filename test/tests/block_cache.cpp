@@ -0,0 +1,109 @@
+/* Integration test kernel for block cache
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestBlockCache()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using AFIO_V2_NAMESPACE::file_handle;
+  using adapter_type = algorithm::block_cache_adapter<file_handle>;
+  auto cache = algorithm::block_cache::cache(16 * 4096, 4096).value();
+  BOOST_REQUIRE(cache->blocks() == 16);
+  adapter_type fh = algorithm::cache_blocks<file_handle>(cache, path_handle(), "block_cache_testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  std::vector<char> contents(10 * 4096 + 100);
+  for(size_t n = 0; n < contents.size(); n++)
+  {
+    contents[n] = static_cast<char>(n * 7);
+  }
+  fh.write(0, contents.data(), contents.size()).value();
+
+  // A read within one block points into the cache, and a second read of it hits
+  char buffer[9000];
+  auto r = fh.read(100, buffer, 50).value();
+  BOOST_REQUIRE(r.len == 50);
+  BOOST_CHECK(r.data != buffer);
+  BOOST_CHECK(0 == memcmp(r.data, contents.data() + 100, 50));
+  BOOST_CHECK(cache->misses() == 1 && cache->hits() == 0);
+  r = fh.read(120, buffer, 50).value();
+  BOOST_CHECK(0 == memcmp(r.data, contents.data() + 120, 50));
+  BOOST_CHECK(cache->hits() == 1);
+  // A read spanning blocks is copied
+  r = fh.read(4000, buffer, 9000).value();
+  BOOST_REQUIRE(r.len == 9000);
+  BOOST_CHECK(r.data == buffer);
+  BOOST_CHECK(0 == memcmp(r.data, contents.data() + 4000, 9000));
+
+  // The final partial block is not cached, so growth by another handle is seen
+  r = fh.read(10 * 4096 + 50, buffer, 100).value();
+  BOOST_REQUIRE(r.len == 50);
+  BOOST_CHECK(0 == memcmp(r.data, contents.data() + 10 * 4096 + 50, 50));
+  {
+    file_handle other = fh.clone().value();
+    other.write(10 * 4096 + 100, "grown", 5).value();
+  }
+  r = fh.read(10 * 4096 + 50, buffer, 100).value();
+  BOOST_REQUIRE(r.len == 55);
+  BOOST_CHECK(0 == memcmp(r.data + 50, "grown", 5));
+  // Reads past the end read nothing
+  r = fh.read(11 * 4096, buffer, 100).value();
+  BOOST_CHECK(r.len == 0);
+
+  // Writes through the adapter invalidate what they overwrite
+  r = fh.read(130, buffer, 1).value();
+  BOOST_CHECK(r.data[0] == contents[130]);
+  fh.write(130, "Q", 1).value();
+  r = fh.read(130, buffer, 1).value();
+  BOOST_CHECK(r.data[0] == 'Q');
+  contents[130] = 'Q';
+
+  // Adapters can be made by the construct<T> framework, and share the cache
+  path_handle base;
+  adapter_type fh2 = construct<adapter_type>{cache, {base, "block_cache_testfile2", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close}}().value();
+  BOOST_CHECK(fh2.cache() == cache);
+
+  // A scan through more than the cache holds does not displace a working set read between its parts
+  auto small = algorithm::block_cache::cache(64 * 4096, 4096).value();
+  adapter_type fh3 = algorithm::cache_blocks<file_handle>(small, path_handle(), "block_cache_testfile3", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  fh3.truncate(2048 * 4096).value();
+  size_t hits = 0, scan = 32;
+  for(size_t round = 0; round < 50; round++)
+  {
+    for(size_t n = 0; n < 32; n++)
+    {
+      const auto before = small->hits();
+      fh3.read(n * 4096, buffer, 10).value();
+      hits += small->hits() - before;
+    }
+    for(size_t n = 0; n < 60; n++, scan++)
+    {
+      fh3.read((32 + scan % 2000) * 4096, buffer, 10).value();
+    }
+  }
+  // Plain CLOCK would hit nothing here
+  BOOST_CHECK(hits >= 50 * 32 * 9 / 10);
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, algorithm, block_cache, "Tests that afio::algorithm::block_cache_adapter caches blocks correctly", TestBlockCache())
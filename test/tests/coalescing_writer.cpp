@@ -0,0 +1,90 @@
+/* Integration test kernel for coalescing writer
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestCoalescingWriter()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using AFIO_V2_NAMESPACE::file_handle;
+  using writer_type = algorithm::coalescing_writer<file_handle>;
+  writer_type fh = algorithm::coalesce_writes<file_handle>(path_handle(), "testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  fh.set_flush_age(std::chrono::hours(1));
+  fh.set_flush_threshold(4096);
+  // Small appends merge into one extent
+  char record[16];
+  for(size_t n = 0; n < 64; n++)
+  {
+    memset(record, 'a' + static_cast<int>(n % 26), sizeof(record));
+    fh.write(n * sizeof(record), record, sizeof(record)).value();
+  }
+  BOOST_CHECK(fh.buffered() == 1024);
+  BOOST_CHECK(fh.length().value() == 0);
+  // Overwrite the middle of a buffered extent, and write a disjoint extent after a hole
+  fh.write(8, "XXXXXXXX", 8).value();
+  fh.write(2048, "hello", 5).value();
+  BOOST_CHECK(fh.buffered() == 1029);
+  // Reads must see the unflushed writes, with the hole reading as zeros
+  char buffer[2100];
+  auto r = fh.read(0, buffer, sizeof(buffer)).value();
+  BOOST_REQUIRE(r.len == 2053);
+  BOOST_CHECK(0 == memcmp(r.data, "aaaaaaaaXXXXXXXXbbbb", 20));
+  BOOST_CHECK(r.data[1023] == 'l');
+  BOOST_CHECK(r.data[1024] == 0 && r.data[2047] == 0);
+  BOOST_CHECK(0 == memcmp(r.data + 2048, "hello", 5));
+  // Barrier must write everything out
+  fh.barrier().value();
+  BOOST_CHECK(fh.buffered() == 0);
+  BOOST_CHECK(fh.length().value() == 2053);
+  r = fh.read(0, buffer, sizeof(buffer)).value();
+  BOOST_REQUIRE(r.len == 2053);
+  BOOST_CHECK(0 == memcmp(r.data, "aaaaaaaaXXXXXXXXbbbb", 20));
+  BOOST_CHECK(0 == memcmp(r.data + 2048, "hello", 5));
+  // Bytes past the end of the file but before buffered writes read as zero, even in a buffer
+  // which overlaps no buffered write
+  fh.write(3000, "tail", 4).value();
+  memset(buffer, 'x', sizeof(buffer));
+  char buffer2[500];
+  memset(buffer2, 'x', sizeof(buffer2));
+  file_handle::buffer_type reqs[] = {{buffer, 600}, {buffer2, 500}};
+  auto filled = fh.read({file_handle::buffers_type(reqs), 2000}).value();
+  BOOST_REQUIRE(filled.size() == 2);
+  BOOST_REQUIRE(filled[0].len == 600);
+  BOOST_CHECK(0 == memcmp(filled[0].data + 48, "hello", 5));
+  BOOST_CHECK(filled[0].data[53] == 0 && filled[0].data[599] == 0);
+  BOOST_REQUIRE(filled[1].len == 404);
+  BOOST_CHECK(filled[1].data[0] == 0 && filled[1].data[399] == 0);
+  BOOST_CHECK(0 == memcmp(filled[1].data + 400, "tail", 4));
+  fh.flush().value();
+  BOOST_CHECK(fh.length().value() == 3004);
+  // Exceeding the threshold must flush
+  std::vector<char> big(4096, 'z');
+  fh.write(4096, big.data(), 100).value();
+  BOOST_CHECK(fh.buffered() == 100);
+  fh.write(4196, big.data(), 4000).value();
+  BOOST_CHECK(fh.buffered() == 0);
+  BOOST_CHECK(fh.length().value() == 8196);
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, algorithm, coalescing_writer, "Tests that afio::algorithm::coalescing_writer works as expected", TestCoalescingWriter())
@@ -0,0 +1,88 @@
+/* Integration test kernel for direct i/o adapter
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestDirectIoAdapter()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using AFIO_V2_NAMESPACE::file_handle;
+  using adapter_type = algorithm::direct_io_adapter<file_handle>;
+  adapter_type fh = algorithm::align_direct_io<file_handle>(path_handle(), "testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::only_metadata, file_handle::flag::unlink_on_close).value();
+  BOOST_REQUIRE(fh.requires_aligned_io());
+  const size_t align = fh.alignment();
+  BOOST_REQUIRE(align >= 512 && (align & (align - 1)) == 0);
+  utils::page_allocator<char> allocator;
+  const size_t memsize = utils::round_up_to_page_size(align * 4);
+  char *mem = allocator.allocate(memsize);
+  auto unmem = undoer([&] { allocator.deallocate(mem, memsize); });
+
+  // Aligned i/o passes straight through
+  memset(mem, 'a', align * 3);
+  fh.write(0, mem, align * 3).value();
+  BOOST_CHECK(fh.length().value() == align * 3);
+
+  // Unaligned head and tail are read-modify-written around the aligned middle
+  memset(mem, 'b', align * 3);
+  fh.write(100, mem + 100, align * 2).value();
+  BOOST_CHECK(fh.length().value() == align * 3);
+  memset(mem, 0, align * 4);
+  auto r = fh.read(0, mem, align * 3).value();
+  BOOST_REQUIRE(r.len == align * 3);
+  BOOST_CHECK(r.data[99] == 'a' && r.data[100] == 'b');
+  BOOST_CHECK(r.data[align * 2 + 99] == 'b' && r.data[align * 2 + 100] == 'a');
+  // And read back bouncing the ends
+  std::vector<char> buffer(align * 4, 'x');
+  r = fh.read(99, buffer.data(), align * 2 + 2).value();
+  BOOST_REQUIRE(r.len == align * 2 + 2);
+  BOOST_CHECK(r.data[0] == 'a' && r.data[1] == 'b' && r.data[align * 2] == 'b' && r.data[align * 2 + 1] == 'a');
+
+  // A bounced write past the end of the file extends it only as far as written, with zeros before
+  fh.write(align * 3 + 10, "tail", 4).value();
+  BOOST_CHECK(fh.length().value() == align * 3 + 14);
+  // A bounced write within the last block does not extend it
+  fh.write(align * 3 + 2, "xy", 2).value();
+  BOOST_CHECK(fh.length().value() == align * 3 + 14);
+
+  // Reads across the end of the file stop at it, and reads past it return nothing
+  std::fill(buffer.begin(), buffer.end(), 'x');
+  r = fh.read(align * 3 - 50, buffer.data(), 200).value();
+  BOOST_REQUIRE(r.len == 64);
+  BOOST_CHECK(r.data[49] == 'a');
+  BOOST_CHECK(r.data[50] == 0 && r.data[51] == 0 && 0 == memcmp(r.data + 52, "xy", 2) && r.data[59] == 0);
+  BOOST_CHECK(0 == memcmp(r.data + 60, "tail", 4));
+  BOOST_CHECK(buffer[64] == 'x');
+  r = fh.read(align * 3 + 100, buffer.data(), 10).value();
+  BOOST_CHECK(r.len == 0);
+  // A scatter read ending the first buffer at the end of the file leaves the rest empty
+  file_handle::buffer_type reqs[] = {{buffer.data(), 30}, {buffer.data() + 30, 30}};
+  auto filled = fh.read({file_handle::buffers_type(reqs), align * 3 - 16}).value();
+  BOOST_REQUIRE(filled.size() == 2);
+  BOOST_CHECK(filled[0].len == 30);
+  BOOST_CHECK(0 == memcmp(filled[0].data + 26, "tail", 4));
+  BOOST_CHECK(filled[1].len == 0);
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, algorithm, direct_io_adapter, "Tests that afio::algorithm::direct_io_adapter performs unaligned i/o correctly", TestDirectIoAdapter())
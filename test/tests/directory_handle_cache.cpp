@@ -0,0 +1,111 @@
+/* Integration test kernel for algorithm::directory_handle_cache
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestDirectoryHandleCache()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using algorithm::directory_handle_cache;
+  // directory_handle_cache_test/a/b/c/d, plus e to h beside a
+  directory_handle root = directory_handle::directory({}, "directory_handle_cache_test", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  std::vector<directory_handle> dirs;
+  dirs.push_back(directory_handle::directory(root, "a", directory_handle::mode::write, directory_handle::creation::if_needed).value());
+  dirs.push_back(directory_handle::directory(dirs.back(), "b", directory_handle::mode::write, directory_handle::creation::if_needed).value());
+  dirs.push_back(directory_handle::directory(dirs.back(), "c", directory_handle::mode::write, directory_handle::creation::if_needed).value());
+  dirs.push_back(directory_handle::directory(dirs.back(), "d", directory_handle::mode::write, directory_handle::creation::if_needed).value());
+  for(const char *leaf : {"e", "f", "g", "h"})
+  {
+    dirs.push_back(directory_handle::directory(root, leaf, directory_handle::mode::write, directory_handle::creation::if_needed).value());
+  }
+  const filesystem::path base = filesystem::current_path() / "directory_handle_cache_test";
+
+  directory_handle_cache cache(4, std::chrono::steady_clock::duration::zero(), 1);
+  BOOST_CHECK(cache.capacity() == 4);
+  BOOST_CHECK(cache.directory("relative").error() == std::errc::invalid_argument);
+
+  // Resolving opens the parent directory, and the leafname can be opened relative to it
+  filesystem::path file = base / "a" / "b" / "c" / "file";
+  auto r = cache.resolve(file).value();
+  BOOST_CHECK(r.leafname == "file");
+  file_handle fh = file_handle::file(*r.parent, r.leafname, file_handle::mode::write, file_handle::creation::if_needed).value();
+  BOOST_CHECK(cache.size() == 1);
+  BOOST_CHECK(cache.stats().misses == 1);
+  // A second resolve is a hit returning the same handle
+  BOOST_CHECK(cache.resolve(file).value().parent == r.parent);
+  BOOST_CHECK(cache.stats().hits == 1);
+
+  // A miss below a cached directory opens relative to it, caching each directory on the way
+  auto d = cache.directory(base / "a" / "b" / "c" / "d").value();
+  BOOST_CHECK(d->st_ino() == dirs[3].st_ino());
+  BOOST_CHECK(cache.size() == 2);
+
+  // Renaming a cached directory makes its entry stale
+  dirs[3].relink(dirs[2], "d2").value();
+  BOOST_CHECK(!cache.directory(base / "a" / "b" / "c" / "d"));
+  BOOST_CHECK(cache.stats().stale == 1);
+  BOOST_CHECK(cache.size() == 1);
+  dirs[3].relink(dirs[2], "d").value();
+
+  // The least recently used entries are evicted when full
+  for(const char *leaf : {"e", "f", "g", "h"})
+  {
+    cache.directory(base / leaf).value();
+  }
+  BOOST_CHECK(cache.size() == 4);
+  BOOST_CHECK(cache.stats().evictions == 1);
+  // An evicted handle still in use remains open
+  BOOST_CHECK(r.parent->is_valid());
+
+  // Invalidation discards everything at and below a path. Caching base evicted e.
+  cache.directory(base).value();
+  cache.invalidate(base / "h");
+  BOOST_CHECK(cache.size() == 3);
+  cache.invalidate(base);
+  BOOST_CHECK(cache.size() == 0);
+
+  // The paths current_path() returns, which on Windows are kernel paths without a drive letter,
+  // are accepted, so the adapter can open files relative to a cached parent
+  {
+    const filesystem::path kernelpath = dirs[2].current_path().value();
+    BOOST_CHECK(cache.directory(kernelpath).value()->st_ino() == dirs[2].st_ino());
+    auto cfh = algorithm::cache_parent<file_handle>(dirs[2], "file", file_handle::mode::write, file_handle::creation::open_existing).value();
+    BOOST_CHECK(cfh.st_ino() == fh.st_ino());
+    cfh.close().value();
+    cache.invalidate(kernelpath);
+    directory_handle_cache::process().invalidate(kernelpath);
+  }
+
+  fh.unlink().value();
+  fh.close().value();
+  r.parent.reset();
+  d.reset();
+  for(auto it = dirs.rbegin(); it != dirs.rend(); ++it)
+  {
+    it->unlink().value();
+  }
+  root.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, algorithm, directory_handle_cache, "Tests that afio::algorithm::directory_handle_cache works as expected", TestDirectoryHandleCache())
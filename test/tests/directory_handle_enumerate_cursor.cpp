@@ -0,0 +1,87 @@
+/* Integration test kernel for incremental directory enumeration
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <set>
+
+static inline void TestDirectoryHandleEnumerateCursor()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  static constexpr size_t files = 1000;
+  directory_handle dh = directory_handle::directory({}, "enumerate_cursor_test", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  for(size_t n = 0; n < files; n++)
+  {
+    file_handle::file(dh, std::to_string(n), file_handle::mode::write, file_handle::creation::if_needed).value();
+  }
+
+  // Enumerating in small batches sees every entry exactly once
+  directory_entry _entries[64];
+  span<directory_entry> entries(_entries);
+  // A fixed kernel buffer bounds memory use however large the directory
+  std::vector<char> _kernelbuffer(4096);
+  span<char> kernelbuffer(_kernelbuffer);
+  std::set<std::string> seen;
+  directory_handle::enumerate_cursor cursor;
+  size_t calls = 0;
+  while(!cursor.done)
+  {
+    auto info = dh.enumerate(cursor, entries, {}, directory_handle::filter::fastdeleted, kernelbuffer).value();
+    BOOST_REQUIRE(info.filled.size() <= entries.size());
+    for(auto &i : info.filled)
+    {
+      BOOST_CHECK(i.stat.st_type == filesystem::file_type::regular);
+      BOOST_CHECK(seen.insert(i.leafname.path().string()).second);
+    }
+    BOOST_CHECK(info.done == cursor.done);
+    BOOST_REQUIRE(++calls < files);
+  }
+  BOOST_CHECK(seen.size() == files);
+  BOOST_CHECK(calls >= files / entries.size());
+  // Once done, the cursor stays done
+  BOOST_CHECK(dh.enumerate(cursor, entries).value().filled.empty());
+
+  // Globs filter each batch
+  seen.clear();
+  cursor = {};
+  while(!cursor.done)
+  {
+    auto info = dh.enumerate(cursor, entries, "99*", directory_handle::filter::fastdeleted, kernelbuffer).value();
+    for(auto &i : info.filled)
+    {
+      BOOST_CHECK(seen.insert(i.leafname.path().string()).second);
+    }
+  }
+  BOOST_CHECK(seen.size() == 11);
+
+  for(size_t n = 0; n < files; n++)
+  {
+    file_handle::file(dh, std::to_string(n), file_handle::mode::write).value().unlink().value();
+  }
+  dh.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, directory_handle_enumerate_cursor, directory_handle, "Tests that afio::directory_handle::enumerate() with a cursor sees every entry exactly once", TestDirectoryHandleEnumerateCursor())
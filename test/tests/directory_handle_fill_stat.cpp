@@ -0,0 +1,76 @@
+/* Integration test kernel for directory_handle::fill_stat()
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestDirectoryHandleFillStat()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  static constexpr size_t files = 64;
+  directory_handle dh = directory_handle::directory({}, "fill_stat_test", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  std::vector<std::string> names;
+  for(size_t n = 0; n < files; n++)
+  {
+    names.push_back(std::to_string(n));
+    file_handle fh = file_handle::file(dh, names.back(), file_handle::mode::write, file_handle::creation::if_needed).value();
+    fh.truncate(n * 100).value();
+  }
+  // One entry which does not exist
+  names.push_back("missing");
+
+  std::vector<directory_entry> entries(names.size());
+  for(size_t n = 0; n < names.size(); n++)
+  {
+    entries[n].leafname = names[n];
+  }
+  auto filled = dh.fill_stat(entries, stat_t::want::type | stat_t::want::size | stat_t::want::mtim).value();
+  BOOST_CHECK(filled & stat_t::want::type);
+  BOOST_CHECK(filled & stat_t::want::size);
+  BOOST_CHECK(filled & stat_t::want::mtim);
+  for(size_t n = 0; n < files; n++)
+  {
+    BOOST_CHECK(entries[n].stat.st_type == filesystem::file_type::regular);
+    BOOST_CHECK(entries[n].stat.st_size == n * 100);
+    BOOST_CHECK(entries[n].stat.st_mtim != std::chrono::system_clock::time_point());
+  }
+  BOOST_CHECK(entries.back().stat.st_type == filesystem::file_type::not_found);
+
+  // Up to date metadata matches what stat_t::fill() says
+  file_handle fh = file_handle::file(dh, names[10], file_handle::mode::write).value();
+  fh.truncate(12345).value();
+  stat_t s(nullptr);
+  s.fill(fh).value();
+  dh.fill_stat(span<directory_entry>(entries.data() + 10, 1), stat_t::want::size | stat_t::want::ino, true).value();
+  BOOST_CHECK(entries[10].stat.st_size == 12345);
+  BOOST_CHECK(entries[10].stat.st_ino == s.st_ino);
+  fh.close().value();
+
+  for(size_t n = 0; n < files; n++)
+  {
+    file_handle::file(dh, names[n], file_handle::mode::write).value().unlink().value();
+  }
+  dh.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, directory_handle_fill_stat, directory_handle, "Tests that afio::directory_handle::fill_stat() fills the metadata of many entries at once", TestDirectoryHandleFillStat())
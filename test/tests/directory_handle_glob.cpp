@@ -0,0 +1,150 @@
+/* Integration test kernel for glob_pattern and directory_handle::enumerate()
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <set>
+
+static inline void TestGlobPattern()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using shape = glob_pattern::shape;
+  // The common shapes are recognised
+  BOOST_CHECK(glob_pattern("").kind() == shape::empty);
+  BOOST_CHECK(glob_pattern("foo").kind() == shape::literal);
+  BOOST_CHECK(glob_pattern("**").kind() == shape::any);
+  BOOST_CHECK(glob_pattern("foo*").kind() == shape::prefix);
+  BOOST_CHECK(glob_pattern("*.txt").kind() == shape::suffix);
+  BOOST_CHECK(glob_pattern("foo*.txt").kind() == shape::prefix_suffix);
+  BOOST_CHECK(glob_pattern("*oo*").kind() == shape::infix);
+  BOOST_CHECK(glob_pattern("*.[ch]").kind() == shape::general);
+  BOOST_CHECK(glob_pattern("a\\*b").kind() == shape::literal);
+  BOOST_CHECK(glob_pattern("a\\*b").literal() == path_view("a*b"));
+
+  static const struct
+  {
+    const char *glob, *leafname;
+    bool matches;
+  } cases[] = {
+  {"", "anything", true},                 //
+  {"foo", "foo", true},                   //
+  {"foo", "fooo", false},                 //
+  {"*", "", true},                        //
+  {"*", ".hidden", true},                 //
+  {"foo*", "foo", true},                  //
+  {"foo*", "fo", false},                  //
+  {"*.txt", "a.txt", true},               //
+  {"*.txt", "a.txt.bak", false},          //
+  {"f*o", "fo", true},                    //
+  {"f*of", "fof", true},                  //
+  {"fo*of", "fof", false},                //
+  {"*oo*", "boot", true},                 //
+  {"*oo*", "bot", false},                 //
+  {"?", "a", true},                       //
+  {"?", "", false},                       //
+  {"*.[ch]", "main.c", true},             //
+  {"*.[ch]", "main.o", false},            //
+  {"[!a-c]x", "dx", true},                //
+  {"[!a-c]x", "bx", false},               //
+  {"[^a-c]x", "bx", false},               //
+  {"[]a]*", "]", true},                   //
+  {"[[:digit:]]*", "9lives", true},       //
+  {"[[:digit:]]*", "lives", false},       //
+  {"*[[:upper:]]?", "aBc", true},         //
+  {"a[b", "a[b", true},                   //
+  {"\\*", "*", true},                     //
+  {"\\*", "a", false},                    //
+  {"a*b*c", "aXbYbZc", true},             //
+  {"a*b*c", "aXbYbZ", false},             //
+  {"*a*a*a*b", "aaaaaaaaaaaaaaaaaa", false}  //
+  };
+  for(const auto &c : cases)
+  {
+    glob_pattern g(c.glob);
+    BOOST_CHECK(g.matches(c.leafname) == c.matches);
+    if(g.matches(c.leafname) != c.matches)
+    {
+      std::cerr << "glob " << c.glob << " (" << g.kind() << ") matching " << c.leafname << " should have been " << c.matches << std::endl;
+    }
+  }
+}
+
+static inline void TestDirectoryHandleEnumerateGlobPattern()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  static constexpr size_t files = 1000;
+  directory_handle dh = directory_handle::directory({}, "enumerate_glob_test", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  for(size_t n = 0; n < files; n++)
+  {
+    file_handle::file(dh, std::to_string(n) + ((n % 10 == 0) ? ".txt" : ".dat"), file_handle::mode::write, file_handle::creation::if_needed).value();
+  }
+  std::vector<directory_entry> _entries(files);
+  span<directory_entry> entries(_entries);
+  auto count = [&](const glob_pattern &glob) {
+    auto info = dh.enumerate(entries, glob).value();
+    BOOST_CHECK(info.done);
+    return info.filled.size();
+  };
+  BOOST_CHECK(count(glob_pattern("")) == files);
+  BOOST_CHECK(count(glob_pattern("*.txt")) == files / 10);
+  BOOST_CHECK(count(glob_pattern("9*")) == 111);
+  BOOST_CHECK(count(glob_pattern("99*.dat")) == 10);
+  BOOST_CHECK(count(glob_pattern("*5*")) == 271);
+  BOOST_CHECK(count(glob_pattern("?.txt")) == 1);
+  BOOST_CHECK(count(glob_pattern("5.dat")) == 1);
+#ifndef _WIN32
+  BOOST_CHECK(count(glob_pattern("[12]0.txt")) == 2);
+#endif
+  // The same glob as a path view gives the same entries
+  {
+    auto info = dh.enumerate(entries, "*.txt").value();
+    BOOST_CHECK(info.filled.size() == files / 10);
+  }
+
+  // One compiled glob serves every batch of an enumeration with a cursor
+  glob_pattern txt("*.txt");
+  directory_entry _batch[16];
+  span<directory_entry> batch(_batch);
+  std::set<std::string> seen;
+  directory_handle::enumerate_cursor cursor;
+  while(!cursor.done)
+  {
+    auto info = dh.enumerate(cursor, batch, txt).value();
+    for(auto &i : info.filled)
+    {
+      BOOST_CHECK(txt.matches(i.leafname.path().string()));
+      BOOST_CHECK(seen.insert(i.leafname.path().string()).second);
+    }
+  }
+  BOOST_CHECK(seen.size() == files / 10);
+
+  for(size_t n = 0; n < files; n++)
+  {
+    file_handle::file(dh, std::to_string(n) + ((n % 10 == 0) ? ".txt" : ".dat"), file_handle::mode::write).value().unlink().value();
+  }
+  dh.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(unit, afio, glob_pattern, glob_pattern, "Tests that afio::glob_pattern matches as fnmatch() does", TestGlobPattern())
+KERNELTEST_TEST_KERNEL(integration, afio, directory_handle_glob_pattern, directory_handle, "Tests that afio::directory_handle::enumerate() filters by a glob_pattern", TestDirectoryHandleEnumerateGlobPattern())
@@ -0,0 +1,100 @@
+/* Integration test kernel for directory_handle::mutate()
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestDirectoryHandleMutate()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using operation = directory_handle::mutation::operation;
+  static constexpr size_t files = 256;
+  directory_handle dh = directory_handle::directory({}, "mutate_test", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  std::vector<std::string> names, newnames;
+  for(size_t n = 0; n < files; n++)
+  {
+    names.push_back(std::to_string(n));
+    newnames.push_back(std::to_string(n) + ".renamed");
+  }
+
+  // Create many files and a directory, one of the files twice
+  std::vector<directory_handle::mutation> mutations;
+  for(size_t n = 0; n < files; n++)
+  {
+    mutations.push_back({operation::create_file, names[n]});
+  }
+  mutations.push_back({operation::create_file, names[0]});
+  mutations.push_back({operation::create_directory, "subdir"});
+  BOOST_CHECK(dh.mutate(mutations) == files + 1);
+  for(size_t n = 0; n < files; n++)
+  {
+    BOOST_CHECK(mutations[n].status);
+  }
+  BOOST_CHECK(mutations[files].status.error() == std::errc::file_exists);
+  BOOST_CHECK(mutations[files + 1].status);
+  BOOST_CHECK(directory_handle::directory(dh, "subdir"));
+  for(size_t n = 0; n < files; n++)
+  {
+    BOOST_CHECK(file_handle::file(dh, names[n]));
+  }
+
+  // Rename them all, the first into the subdirectory
+  mutations.clear();
+  mutations.push_back({operation::relink, names[0], "subdir/0"});
+  for(size_t n = 1; n < files; n++)
+  {
+    mutations.push_back({operation::relink, names[n], newnames[n]});
+  }
+  // Refuses to replace an existing entry if asked
+  mutations.push_back({operation::relink, newnames[1], newnames[2], false});
+  BOOST_CHECK(dh.mutate(mutations) == files);
+  BOOST_CHECK(!mutations.back().status);
+  BOOST_CHECK(file_handle::file(dh, "subdir/0"));
+  for(size_t n = 1; n < files; n++)
+  {
+    BOOST_CHECK(!file_handle::file(dh, names[n]));
+    BOOST_CHECK(file_handle::file(dh, newnames[n]));
+  }
+
+  // Unlink them all, stopping at the first failure
+  mutations.clear();
+  mutations.push_back({operation::unlink_file, "subdir/0"});
+  mutations.push_back({operation::unlink_directory, "subdir"});
+  mutations.push_back({operation::unlink_file, "missing"});
+  for(size_t n = 1; n < files; n++)
+  {
+    mutations.push_back({operation::unlink_file, newnames[n]});
+  }
+  BOOST_CHECK(dh.mutate(mutations, true) == 2);
+  BOOST_CHECK(mutations[2].status.error() == std::errc::no_such_file_or_directory);
+  BOOST_CHECK(mutations[3].status.error() == std::errc::operation_canceled);
+  BOOST_CHECK(file_handle::file(dh, newnames[1]));
+  BOOST_CHECK(dh.mutate(span<directory_handle::mutation>(mutations.data() + 3, mutations.size() - 3)) == files - 1);
+  for(size_t n = 1; n < files; n++)
+  {
+    BOOST_CHECK(!file_handle::file(dh, newnames[n]));
+  }
+  dh.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, directory_handle_mutate, directory_handle, "Tests that afio::directory_handle::mutate() makes many changes at once", TestDirectoryHandleMutate())
@@ -0,0 +1,95 @@
+/* Integration test kernel for directory_handle::version()
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <thread>
+
+static inline void TestDirectoryHandleVersion()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  directory_handle dh = directory_handle::directory({}, "version_test", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  for(size_t n = 0; n < 100; n++)
+  {
+    file_handle::file(dh, std::to_string(n), file_handle::mode::write, file_handle::creation::if_needed).value();
+  }
+  // A token taken just after a change cannot be trusted
+  auto racy = dh.version().value();
+  BOOST_CHECK(!racy.stable);
+  BOOST_CHECK(!dh.unchanged_since(racy).value());
+  // Nor can one never taken
+  BOOST_CHECK(!dh.unchanged_since(directory_handle::version_token()).value());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+  auto token = dh.version().value();
+  BOOST_CHECK(token.stable);
+  BOOST_CHECK(dh.unchanged_since(token).value());
+
+  // Every enumeration returns the version it began from
+  directory_entry _entries[200];
+  span<directory_entry> entries(_entries);
+  auto info = dh.enumerate(entries).value();
+  BOOST_CHECK(info.filled.size() == 100);
+  BOOST_CHECK(info.version.stable);
+  BOOST_CHECK(info.version.mtim == token.mtim && info.version.ctim == token.ctim);
+  BOOST_CHECK(dh.unchanged_since(info.version).value());
+  directory_handle::enumerate_cursor cursor;
+  directory_entry _batch[16];
+  span<directory_entry> batch(_batch);
+  while(!cursor.done)
+  {
+    auto binfo = dh.enumerate(cursor, batch).value();
+    BOOST_CHECK(binfo.version.stable);
+    BOOST_CHECK(binfo.version.mtim == token.mtim && binfo.version.ctim == token.ctim);
+  }
+
+  // Changing the contents or metadata of an entry does not change the directory
+  {
+    file_handle fh = file_handle::file(dh, "0", file_handle::mode::write).value();
+    fh.write(0, "hello", 5).value();
+  }
+  BOOST_CHECK(dh.unchanged_since(token).value());
+
+  // Creating, renaming and removing entries does
+  file_handle fh = file_handle::file(dh, "new", file_handle::mode::write, file_handle::creation::if_needed).value();
+  BOOST_CHECK(!dh.unchanged_since(token).value());
+  BOOST_CHECK(!dh.unchanged_since(info.version).value());
+  BOOST_CHECK(!dh.unchanged_since(cursor.version).value());
+  std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+  token = dh.version().value();
+  fh.relink(dh, "renamed").value();
+  BOOST_CHECK(!dh.unchanged_since(token).value());
+  std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+  token = dh.version().value();
+  fh.unlink().value();
+  BOOST_CHECK(!dh.unchanged_since(token).value());
+
+  for(size_t n = 0; n < 100; n++)
+  {
+    file_handle::file(dh, std::to_string(n), file_handle::mode::write).value().unlink().value();
+  }
+  dh.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, directory_handle_version, directory_handle, "Tests that afio::directory_handle::unchanged_since() sees every change to the entries of a directory", TestDirectoryHandleVersion())
@@ -0,0 +1,120 @@
+/* Integration test kernel for the parallel directory walker
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <atomic>
+#include <set>
+
+static inline void TestDirectoryWalker()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using algorithm::directory_walker;
+  // Three levels of four directories, each holding a file of known size
+  static constexpr size_t fanout = 4, levels = 3;
+  directory_handle root = directory_handle::directory({}, "directory_walker_test", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  std::vector<directory_handle> dirs;
+  auto populate = [&](const directory_handle &dh, size_t level, auto &self) -> void {
+    file_handle fh = file_handle::file(dh, "file", file_handle::mode::write, file_handle::creation::if_needed).value();
+    fh.truncate(level + 1).value();
+    if(level == levels)
+    {
+      return;
+    }
+    for(size_t n = 0; n < fanout; n++)
+    {
+      directory_handle sub = directory_handle::directory(dh, std::to_string(n), directory_handle::mode::write, directory_handle::creation::if_needed).value();
+      self(sub, level + 1, self);
+      dirs.push_back(std::move(sub));
+    }
+  };
+  populate(root, 0, populate);
+  const size_t directories = dirs.size();  // 4 + 16 + 64
+  const size_t entries = directories * 2 + 1;
+
+  // Every entry is visited once, with the metadata wanted, at the right depth
+  std::atomic<size_t> visited(0), files(0), bad(0);
+  directory_walker walker(detail::make_function_ptr<directory_walker::action(const directory_handle &, const directory_entry &, stat_t::want, size_t)>([&](const directory_handle &, const directory_entry &entry, stat_t::want metadata, size_t depth) {
+                            ++visited;
+                            if(!(metadata & stat_t::want::size) || !(metadata & stat_t::want::type))
+                            {
+                              ++bad;
+                            }
+                            if(entry.stat.st_type == filesystem::file_type::regular)
+                            {
+                              ++files;
+                              if(entry.stat.st_size != static_cast<handle::extent_type>(depth + 1))
+                              {
+                                ++bad;
+                              }
+                            }
+                            return directory_walker::action::descend;
+                          }),
+                          stat_t::want::size, 4, 3);
+  BOOST_CHECK(walker.threads() == 4);
+  auto stats = walker.walk({}, "directory_walker_test").value();
+  BOOST_CHECK(stats.directories == directories + 1);
+  BOOST_CHECK(stats.entries == entries);
+  BOOST_CHECK(stats.vanished == 0);
+  BOOST_CHECK(visited == entries);
+  BOOST_CHECK(files == directories + 1);
+  BOOST_CHECK(bad == 0);
+
+  // Filtered entries are neither visited nor descended into, and pruned directories are not descended into
+  visited = 0;
+  directory_walker pruner(detail::make_function_ptr<directory_walker::action(const directory_handle &, const directory_entry &, stat_t::want, size_t)>([&](const directory_handle &, const directory_entry &entry, stat_t::want, size_t) {
+    ++visited;
+    return (entry.leafname == path_view("1")) ? directory_walker::action::prune : directory_walker::action::descend;
+  }));
+  pruner.set_filter(detail::make_function_ptr<bool(const directory_handle &, const directory_entry &, size_t)>([](const directory_handle &, const directory_entry &entry, size_t) { return !(entry.leafname == path_view("0")); }));
+  stats = pruner.walk({}, "directory_walker_test").value();
+  // The root and "2" and "3" at each level are walked, each holding "1", "2", "3" and "file" except at the bottom
+  BOOST_CHECK(stats.directories == 1 + 2 + 4 + 8);
+  BOOST_CHECK(visited == 4 + 2 * 4 + 4 * 4 + 8);
+
+  // Stopping ends the walk early
+  visited = 0;
+  directory_walker stopper(detail::make_function_ptr<directory_walker::action(const directory_handle &, const directory_entry &, stat_t::want, size_t)>([&](const directory_handle &, const directory_entry &, stat_t::want, size_t) {
+    ++visited;
+    return directory_walker::action::stop;
+  }), stat_t::want::none, 1);
+  stopper.walk({}, "directory_walker_test").value();
+  BOOST_CHECK(visited == 1);
+
+  // A missing root is an error
+  BOOST_CHECK(!walker.walk({}, "directory_walker_test_missing"));
+
+  // Subdirectories were stored before their parents
+  for(auto &dh : dirs)
+  {
+    file_handle::file(dh, "file", file_handle::mode::write).value().unlink().value();
+    dh.unlink().value();
+  }
+  file_handle::file(root, "file", file_handle::mode::write).value().unlink().value();
+  root.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, algorithm, directory_walker, "Tests that afio::algorithm::directory_walker works as expected", TestDirectoryWalker())
@@ -0,0 +1,181 @@
+/* Integration test kernel for directory_watcher
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <string>
+#include <vector>
+
+namespace directory_watcher_test
+{
+  struct seen
+  {
+    std::string directory, leafname;
+    AFIO_V2_NAMESPACE::directory_watcher::event events;
+    uint32_t cookie;
+  };
+  // Reads records until one matching pred is seen or no more arrive
+  template <class Pred> static inline bool wait_for(AFIO_V2_NAMESPACE::directory_watcher &w, std::vector<seen> &out, Pred &&pred)
+  {
+    for(;;)
+    {
+      auto records = w.read(std::chrono::seconds(5));
+      if(!records)
+      {
+        return false;
+      }
+      bool found = false;
+      for(auto &r : records.value())
+      {
+        out.push_back(seen{r.directory.path().string(), r.leafname.path().string(), r.events, r.cookie});
+        if(pred(out.back()))
+        {
+          found = true;
+        }
+      }
+      if(found)
+      {
+        return true;
+      }
+    }
+  }
+}  // namespace directory_watcher_test
+
+static inline void TestDirectoryWatcher()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using event = directory_watcher::event;
+  using directory_watcher_test::seen;
+  using directory_watcher_test::wait_for;
+  io_service service;
+  directory_handle dh = directory_handle::directory({}, "directory_watcher_test", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  auto _w = directory_watcher::watch(service, {}, "directory_watcher_test", event::created | event::deleted | event::moved_from | event::moved_to);
+  if(!_w && _w.error() == std::errc::not_supported)
+  {
+    std::cout << "NOTE: directory_watcher is not supported on this platform, skipping test" << std::endl;
+    dh.unlink().value();
+    return;
+  }
+  directory_watcher w(std::move(_w).value());
+  BOOST_REQUIRE(w.is_valid());
+  BOOST_CHECK(w.watches() == 1);
+  std::vector<seen> records;
+
+  // Nothing happens, so the deadline expires
+  BOOST_CHECK(w.read(std::chrono::milliseconds(10)).error() == std::errc::timed_out);
+
+  // Creation, rename and deletion are reported in order, with the rename's records paired by cookie
+  file_handle fh = file_handle::file(dh, "a", file_handle::mode::write, file_handle::creation::if_needed).value();
+  BOOST_CHECK(wait_for(w, records, [](const seen &s) { return s.leafname == "a" && (s.events & event::created); }));
+  fh.relink(dh, "b").value();
+  BOOST_CHECK(wait_for(w, records, [](const seen &s) { return s.leafname == "b" && (s.events & event::moved_to); }));
+  uint32_t cookie = 0;
+  for(auto &s : records)
+  {
+    if(s.leafname == "a" && (s.events & event::moved_from))
+    {
+      cookie = s.cookie;
+    }
+  }
+  BOOST_CHECK(cookie != 0);
+  BOOST_CHECK(records.back().cookie == cookie);
+  fh.unlink().value();
+  fh.close().value();
+  BOOST_CHECK(wait_for(w, records, [](const seen &s) { return s.leafname == "b" && (s.events & event::deleted); }));
+  for(auto &s : records)
+  {
+    BOOST_CHECK(s.directory.empty());
+    BOOST_CHECK(!(s.events & event::directory));
+  }
+
+  // Asynchronous reads complete through the io_service
+  records.clear();
+  optional<result<size_t>> completed;
+  w.async_read([&](directory_watcher *, result<directory_watcher::records_type> r) {
+     if(!r)
+     {
+       completed = r.error();
+       return;
+     }
+     for(auto &i : r.value())
+     {
+       records.push_back(seen{i.directory.path().string(), i.leafname.path().string(), i.events, i.cookie});
+     }
+     completed = r.value().size();
+   }).value();
+  BOOST_CHECK(w.read().error() == std::errc::device_or_resource_busy);
+  directory_handle sub = directory_handle::directory(dh, "sub", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  while(!completed)
+  {
+    service.run().value();
+  }
+  BOOST_REQUIRE(completed->has_value());
+  BOOST_CHECK(completed->value() > 0);
+  BOOST_CHECK(records.front().leafname == "sub");
+  BOOST_CHECK(records.front().events == (event::created | event::directory));
+
+  // A pending read is cancelled by closing
+  completed.reset();
+  w.async_read([&](directory_watcher *, result<directory_watcher::records_type>) { completed = static_cast<size_t>(0); }).value();
+  w.close().value();
+  BOOST_CHECK(!w.is_valid());
+  BOOST_CHECK(!completed);
+
+  // Tree mode watches existing and newly created subdirectories
+  w = directory_watcher::watch(service, {}, "directory_watcher_test", event::created | event::deleted, true).value();
+  BOOST_CHECK(w.watches() == 2);
+  records.clear();
+  directory_handle subsub = directory_handle::directory(sub, "subsub", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  BOOST_CHECK(wait_for(w, records, [](const seen &s) { return s.leafname == "subsub"; }));
+  BOOST_CHECK(records.back().directory == "sub");
+  BOOST_CHECK(w.watches() == 3);
+  file_handle fh2 = file_handle::file(subsub, "c", file_handle::mode::write, file_handle::creation::if_needed).value();
+  BOOST_CHECK(wait_for(w, records, [](const seen &s) { return s.leafname == "c"; }));
+  BOOST_CHECK(records.back().directory == (filesystem::path("sub") / "subsub").string());
+  fh2.unlink().value();
+  fh2.close().value();
+  subsub.unlink().value();
+  subsub.close().value();
+  BOOST_CHECK(wait_for(w, records, [](const seen &s) { return s.leafname == "subsub" && (s.events & event::deleted); }));
+  // The removal of the deleted directory's watch may be reported in a later batch
+  while(w.watches() > 2 && w.read(std::chrono::seconds(5)))
+  {
+  }
+  BOOST_CHECK(w.watches() == 2);
+
+  sub.unlink().value();
+  dh.unlink().value();
+  // Once the watched directory is gone, nothing is watched any more
+  while(w.watches() > 0)
+  {
+    if(!w.read(std::chrono::seconds(5)))
+    {
+      break;
+    }
+  }
+  BOOST_CHECK(w.watches() == 0);
+  BOOST_CHECK(w.read().error() == std::errc::no_such_file_or_directory);
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, directory_watcher, directory_watcher, "Tests that afio::directory_watcher reports changes to a directory and a directory tree", TestDirectoryWatcher())
@@ -0,0 +1,68 @@
+/* Integration test kernel for file_handle::barrier()
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestFileHandleBarrier()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using AFIO_V2_NAMESPACE::file_handle;
+  file_handle fh = file_handle::file({}, "barrier_testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  std::vector<char> data(8192, 'a');
+  // Caching changed after opening cannot make writes or metadata changes synchronous, so barrier() must still flush
+  for(auto caching : {file_handle::caching::all, file_handle::caching::reads_and_metadata, file_handle::caching::reads})
+  {
+    file_handle h = fh.clone(file_handle::mode::unchanged, caching).value();
+    BOOST_REQUIRE(h.write(0, data.data(), data.size()).value().len == data.size());
+    // Barriers of a range return the range
+    file_handle::const_buffer_type range[] = {{data.data() + 4096, 4096}};
+    for(bool wait_for_device : {false, true})
+    {
+      for(bool and_metadata : {false, true})
+      {
+        auto flushed = h.barrier({file_handle::const_buffers_type(range), 4096}, wait_for_device, and_metadata).value();
+        BOOST_REQUIRE(flushed.size() == 1);
+        BOOST_CHECK(flushed[0].data == range[0].data && flushed[0].len == 4096);
+      }
+    }
+    // Metadata changes are flushed as well as writes
+    BOOST_CHECK(h.truncate(16384).value() == 16384);
+    BOOST_CHECK(h.barrier({}, true, true));
+    h.zero(0, 4096).value();
+    BOOST_CHECK(h.barrier({}, true, false));
+    BOOST_CHECK(fh.length().value() == 16384);
+    char buffer[8];
+    auto r = fh.read(4090, buffer, sizeof(buffer)).value();
+    BOOST_REQUIRE(r.len == 8);
+    BOOST_CHECK(r.data[0] == 0 && r.data[5] == 0 && r.data[6] == 'a' && r.data[7] == 'a');
+    // Deadline barriers are not supported on POSIX
+#ifndef _WIN32
+    BOOST_CHECK(h.barrier({}, false, false, std::chrono::seconds(1)).error() == std::errc::not_supported);
+#endif
+    BOOST_REQUIRE(h.truncate(0));
+  }
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, file_handle, barrier, "Tests that afio::file_handle::barrier() flushes regardless of caching", TestFileHandleBarrier())
@@ -0,0 +1,108 @@
+/* Integration test kernel for zero copy sending to pipes and sockets
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <thread>
+
+static inline void TestFileHandleSendTo()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using AFIO_V2_NAMESPACE::file_handle;
+  file_handle fh = file_handle::file({}, "testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  std::vector<char> contents(1024 * 1024 + 123);
+  for(size_t n = 0; n < contents.size(); n++)
+  {
+    contents[n] = static_cast<char>(n * 7 + n / 4096);
+  }
+  fh.write(0, contents.data(), contents.size()).value();
+  map_handle mh = map_handle::map(contents.size()).value();
+  memcpy(mh.address(), contents.data(), contents.size());
+  auto check = [&](bool socket, bool from_map) {
+    int fds[2];
+    BOOST_REQUIRE(0 == (socket ? ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) : ::pipe(fds)));
+    std::vector<char> received;
+    std::thread reader([&] {
+      char buffer[65536];
+      ssize_t bytes;
+      while((bytes = ::read(fds[0], buffer, sizeof(buffer))) > 0)
+      {
+        received.insert(received.end(), buffer, buffer + bytes);
+      }
+    });
+    native_handle_type dest(native_handle_type::disposition::writable, fds[1]);
+    // Sending from the file past its end must stop at the end
+    file_handle::extent_type sent = from_map ? mh.send_to(dest, 100, contents.size() - 100).value() : fh.send_to(dest, 100, contents.size()).value();
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+    BOOST_CHECK(sent == contents.size() - 100);
+    BOOST_REQUIRE(received.size() == contents.size() - 100);
+    BOOST_CHECK(0 == memcmp(received.data(), contents.data() + 100, received.size()));
+  };
+  check(false, false);
+  check(true, false);
+  check(false, true);
+  check(true, true);
+
+  // Neither sendfile() nor splice() can write to an append only file, so this is emulated, and
+  // must honour a deadline and stop at the end of the file
+  int fd = ::open("testfile_appended", O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+  BOOST_REQUIRE(fd != -1);
+  native_handle_type dest(native_handle_type::disposition::writable, fd);
+  BOOST_CHECK(fh.send_to(dest, 100, contents.size(), std::chrono::seconds(60)).value() == contents.size() - 100);
+  BOOST_CHECK(fh.send_to(dest, contents.size(), 100, std::chrono::seconds(60)).value() == 0);
+  ::close(fd);
+  file_handle appended = file_handle::file({}, "testfile_appended", file_handle::mode::write, file_handle::creation::open_existing, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  std::vector<char> received(contents.size());
+  auto r = appended.read(0, received.data(), received.size()).value();
+  BOOST_REQUIRE(r.len == contents.size() - 100);
+  BOOST_CHECK(0 == memcmp(r.data, contents.data() + 100, r.len));
+
+  // Reads of a mapped file return pointers into the map rather than filling the buffer supplied,
+  // so the emulation must send what read() returned
+  mapped_file_handle mfh = mapped_file_handle::mapped_file({}, "testfile", mapped_file_handle::mode::read).value();
+  fd = ::open("testfile_mapped", O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+  BOOST_REQUIRE(fd != -1);
+  native_handle_type mapped_dest(native_handle_type::disposition::writable, fd);
+  BOOST_CHECK(mfh.send_to(mapped_dest, 100, contents.size()).value() == contents.size() - 100);
+  ::close(fd);
+  file_handle mapped_sent = file_handle::file({}, "testfile_mapped", file_handle::mode::write, file_handle::creation::open_existing, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  r = mapped_sent.read(0, received.data(), received.size()).value();
+  BOOST_REQUIRE(r.len == contents.size() - 100);
+  BOOST_CHECK(0 == memcmp(r.data, contents.data() + 100, r.len));
+}
+#else
+static inline void TestFileHandleSendTo()
+{
+}
+#endif
+
+KERNELTEST_TEST_KERNEL(integration, afio, file_handle_send_to, file_handle, "Tests that afio::file_handle::send_to() and afio::map_handle::send_to() work as expected", TestFileHandleSendTo())
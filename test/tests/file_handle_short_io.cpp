@@ -0,0 +1,55 @@
+/* Integration test kernel for short reads and writes through io_handle
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestFileHandleShortRead()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  using AFIO_V2_NAMESPACE::file_handle;
+  file_handle fh = file_handle::file({}, "short_io_testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  std::vector<char> data(100, 'a');
+  BOOST_REQUIRE(fh.write(0, data.data(), data.size()).value().len == 100);
+  // A read crossing the end of the file trims each buffer to what was read
+  char a[64], b[64], c[64];
+  file_handle::buffer_type reqs[] = {{a, sizeof(a)}, {b, sizeof(b)}, {c, sizeof(c)}};
+  auto filled = fh.read({file_handle::buffers_type(reqs), 0}).value();
+  BOOST_REQUIRE(filled.size() == 3);
+  BOOST_CHECK(filled[0].len == 64);
+  BOOST_CHECK(filled[1].len == 36);
+  BOOST_CHECK(filled[2].len == 0);
+  // A read starting at the end of the file reads nothing
+  file_handle::buffer_type reqs2[] = {{a, sizeof(a)}, {b, sizeof(b)}};
+  filled = fh.read({file_handle::buffers_type(reqs2), 100}).value();
+  BOOST_REQUIRE(filled.size() == 2);
+  BOOST_CHECK(filled[0].len == 0);
+  BOOST_CHECK(filled[1].len == 0);
+  // A read exactly filling its buffers leaves them untouched
+  file_handle::buffer_type reqs3[] = {{a, 50}, {b, 50}};
+  filled = fh.read({file_handle::buffers_type(reqs3), 0}).value();
+  BOOST_CHECK(filled[0].len == 50);
+  BOOST_CHECK(filled[1].len == 50);
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, file_handle, short_read, "Tests that afio::file_handle::read() trims buffers past the end of the file", TestFileHandleShortRead())
@@ -0,0 +1,82 @@
+/* Integration test kernel for fs_handle::exchange() and relinking within a cached parent
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+template <class FileHandleType> static inline void TestFsHandleExchange()
+{
+  namespace afio = AFIO_V2_NAMESPACE;
+  {
+    std::error_code ec;
+    afio::filesystem::remove_all("exchange_test", ec);
+  }
+  afio::directory_handle dh = afio::directory_handle::directory({}, "exchange_test", afio::directory_handle::mode::write, afio::directory_handle::creation::if_needed).value();
+  auto dirpath = dh.current_path().value();
+  afio::path_handle null_path_handle;
+  FileHandleType a = afio::construct<FileHandleType>{null_path_handle, dirpath / "a", afio::file_handle::mode::write, afio::file_handle::creation::if_needed, afio::file_handle::caching::temporary, afio::file_handle::flag::none}().value();  // NOLINT
+  FileHandleType b = afio::construct<FileHandleType>{null_path_handle, dirpath / "b", afio::file_handle::mode::write, afio::file_handle::creation::if_needed, afio::file_handle::caching::temporary, afio::file_handle::flag::none}().value();  // NOLINT
+  auto inode_at = [&](const char *leafname) { return afio::file_handle::file(dh, leafname).value().st_ino(); };
+
+  auto exchanged = a.exchange(b);
+  if(!exchanged && exchanged.error() == std::errc::not_supported)
+  {
+    std::cout << "NOTE: fs_handle::exchange() is not supported on this platform, skipping exchange tests" << std::endl;
+  }
+  else
+  {
+    exchanged.value();
+    BOOST_CHECK(inode_at("a") == b.st_ino());
+    BOOST_CHECK(inode_at("b") == a.st_ino());
+    BOOST_CHECK(a.current_path().value().filename() == "b");
+    BOOST_CHECK(b.current_path().value().filename() == "a");
+    // And back again
+    b.exchange(a).value();
+    BOOST_CHECK(inode_at("a") == a.st_ino());
+    BOOST_CHECK(inode_at("b") == b.st_ino());
+    BOOST_CHECK(a.current_path().value().filename() == "a");
+  }
+
+  // Relinking without replacing fails if something is already there, and leaves both entries alone
+  BOOST_CHECK(!a.relink(dh, "b", false));
+  BOOST_CHECK(inode_at("a") == a.st_ino());
+  BOOST_CHECK(inode_at("b") == b.st_ino());
+
+  // Relinking and unlinking find the entry even after a third party has renamed it
+  afio::filesystem::rename(dirpath / "a", dirpath / "c");
+  a.relink(dh, "d").value();
+  BOOST_CHECK(inode_at("d") == a.st_ino());
+  BOOST_CHECK(a.current_path().value().filename() == "d");
+  afio::filesystem::rename(dirpath / "d", dirpath / "e");
+  a.unlink().value();
+  BOOST_CHECK(!afio::filesystem::exists(dirpath / "e"));
+  a.close().value();
+
+  b.unlink().value();
+  b.close().value();
+  dh.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, fs_handle_exchange, file_handle, "Tests that afio::fs_handle::exchange() and relink() work as expected", TestFsHandleExchange<AFIO_V2_NAMESPACE::file_handle>())
+KERNELTEST_TEST_KERNEL(integration, afio, fs_handle_exchange, cached_parent_handle_adapter, "Tests that afio::cached_parent_handle_adapter::exchange() and relink() work as expected",
+                       TestFsHandleExchange<AFIO_V2_NAMESPACE::algorithm::cached_parent_handle_adapter<AFIO_V2_NAMESPACE::file_handle>>())
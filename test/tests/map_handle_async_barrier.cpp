@@ -0,0 +1,84 @@
+/* Integration test kernel for asynchronous writeback of mapped pages
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <atomic>
+
+static inline void TestMapHandleAsyncBarrier()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  io_service service;
+  mapped_file_handle mfh = mapped_file_handle::mapped_file({}, "testfile", mapped_file_handle::mode::write, mapped_file_handle::creation::if_needed, mapped_file_handle::caching::all, mapped_file_handle::flag::unlink_on_close).value();
+  mfh.truncate(1024 * 1024).value();
+  memset(mfh.address(), 78, 1024 * 1024);
+  size_t completions = 0;
+  map_handle::buffer_type completed{nullptr, 0};
+  auto completion = detail::make_function_ptr<void(map_handle::async_barrier_state *, result<map_handle::buffer_type>)>([&](map_handle::async_barrier_state * /*unused*/, result<map_handle::buffer_type> r) {
+    ++completions;
+    completed = r.value();
+  });
+  auto state = mfh.async_barrier({mfh.address() + 5, 8192}, true, false, &service, std::move(completion)).value();
+  // The region is rounded out to page boundaries
+  auto region = state->wait().value();
+  BOOST_CHECK(region.data == mfh.address());
+  BOOST_CHECK(region.len == utils::round_up_to_page_size(static_cast<size_t>(8192 + 5)));
+  BOOST_CHECK(state->is_ready());
+  // The completion is posted to the service, so it only runs when the service is pumped
+  while(completions == 0)
+  {
+    service.run().value();
+  }
+  BOOST_CHECK(completions == 1);
+  BOOST_CHECK(completed.data == region.data);
+
+  // Regions outside the map are rejected
+  char c;
+  BOOST_CHECK(!mfh.async_barrier({&c, 1}));
+
+  // Barriers upon anonymous memory complete immediately
+  map_handle mh = map_handle::map(65536).value();
+  BOOST_CHECK(mh.async_barrier().value()->wait().value().len == 65536);
+
+  // Closing a map waits for its barriers in flight, including completions not posted to a service,
+  // however many more there are than background threads
+  std::atomic<size_t> unposted{0};
+  {
+    section_handle sh = section_handle::section(mfh).value();
+    map_handle view = map_handle::map(sh).value();
+    for(size_t n = 0; n < 64; n++)
+    {
+      view.address()[n * 16384] = 'x';
+      BOOST_CHECK(view.async_barrier({view.address() + n * 16384, 16384}, false, false, nullptr, detail::make_function_ptr<void(map_handle::async_barrier_state *, result<map_handle::buffer_type>)>([&unposted](map_handle::async_barrier_state * /*unused*/, result<map_handle::buffer_type> r) {
+        BOOST_CHECK(r);
+        ++unposted;
+      })));
+    }
+    view.close().value();
+    BOOST_CHECK(unposted == 64);
+  }
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, map_handle_async_barrier, map_handle, "Tests that afio::map_handle::async_barrier() works as expected", TestMapHandleAsyncBarrier())
@@ -0,0 +1,132 @@
+/* Integration test kernel for large and transparent huge page maps
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#ifdef __linux__
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// True if the kernel has marked the mapping starting at addr with MADV_HUGEPAGE
+static inline bool has_madv_hugepage(const void *addr)
+{
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool found = false;
+  while(std::getline(smaps, line))
+  {
+    if(!found)
+    {
+      // Mappings begin with their address range in hex without a leading 0x
+      std::istringstream s(line);
+      unsigned long long start = 0;
+      s >> std::hex >> start;
+      found = !s.fail() && s.peek() == '-' && start == reinterpret_cast<uintptr_t>(addr);
+    }
+    else if(line.compare(0, 8, "VmFlags:") == 0)
+    {
+      return line.find(" hg") != std::string::npos;
+    }
+  }
+  return false;
+}
+#endif
+
+static inline void TestMapHandleLargePages()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  const size_t pagesize = utils::page_size();
+  auto pagesizes(utils::page_sizes(false));
+
+  map_handle mh = map_handle::map(pagesize * 16, section_handle::flag::readwrite | section_handle::flag::transparent_huge_pages).value();
+  BOOST_CHECK(mh.page_size() == pagesize);
+  mh.address()[0] = 'a';
+#ifndef _WIN32
+  // On POSIX truncating to zero unmaps, so growing again maps afresh with the flags the map was created with
+  BOOST_CHECK(mh.truncate(0).value() == 0);
+  BOOST_CHECK(mh.truncate(pagesize * 16).value() == pagesize * 16);
+  // Writable, not reserved only
+  mh.address()[pagesize * 15] = 'b';
+  BOOST_CHECK(mh.address()[pagesize * 15] == 'b');
+#ifdef __linux__
+  if(-1 != ::access("/sys/kernel/mm/transparent_hugepage/enabled", F_OK))
+  {
+    BOOST_CHECK(has_madv_hugepage(mh.address()));
+  }
+#endif
+#endif
+
+  // Prefaulted transparent huge pages are collapsed where the kernel can
+  {
+    map_handle thp = map_handle::map(pagesize * 1024, section_handle::flag::readwrite | section_handle::flag::transparent_huge_pages | section_handle::flag::prefault).value();
+    BOOST_CHECK(thp.page_size() == pagesize || (pagesizes.size() > 1 && thp.page_size() == pagesizes[1]));
+    thp.address()[0] = 'c';
+  }
+
+  // Large page maps either get the large page size requested, or fail
+  if(pagesizes.size() > 1)
+  {
+    auto lp = map_handle::map(pagesizes[1], section_handle::flag::readwrite | section_handle::flag::page_sizes_1);
+    if(lp)
+    {
+      BOOST_CHECK(lp.value().page_size() == pagesizes[1]);
+      lp.value().address()[0] = 'd';
+#ifndef _WIN32
+      BOOST_CHECK(lp.value().truncate(0).value() == 0);
+      BOOST_CHECK(lp.value().truncate(1).value() == pagesizes[1]);
+      BOOST_CHECK(lp.value().page_size() == pagesizes[1]);
+      lp.value().address()[0] = 'd';
+#endif
+    }
+    else
+    {
+      std::cout << "NOTE: Large pages are not available on this system, so skipping large page maps: " << lp.error().message() << std::endl;
+    }
+  }
+  BOOST_CHECK(!map_handle::map(pagesize, section_handle::flag::readwrite | section_handle::flag::page_sizes_3) || pagesizes.size() > 3);
+
+  // File backed large page sections must live on a large page filing system
+  file_handle fh = file_handle::file({}, "testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  fh.truncate(pagesize * 4).value();
+  if(pagesizes.size() > 1)
+  {
+    BOOST_CHECK(!section_handle::section(fh, 0, section_handle::flag::readwrite | section_handle::flag::page_sizes_1));
+  }
+
+#ifndef _WIN32
+  // Views keep their own flags, so a copy on write view of a shared section stays private when remapped
+  section_handle sh = section_handle::section(fh).value();
+  map_handle cow = map_handle::map(sh, 0, 0, section_handle::flag::cow).value();
+  BOOST_CHECK(cow.truncate(0).value() == 0);
+  BOOST_CHECK(cow.truncate(pagesize * 4).value() == pagesize * 4);
+  cow.address()[0] = 'e';
+  char buffer[1];
+  fh.read(0, buffer, 1).value();
+  BOOST_CHECK(buffer[0] == 0);
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, map_handle_large_pages, map_handle, "Tests that afio::map_handle keeps its large and transparent huge page flags", TestMapHandleLargePages())
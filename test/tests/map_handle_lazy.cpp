@@ -0,0 +1,87 @@
+/* Integration test kernel for lazily filled memory maps
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestMapHandleLazy()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  const size_t pagesize = utils::page_size();
+  std::atomic<size_t> fills(0);
+  auto fill = [&fills](map_handle::extent_type offset, map_handle::buffer_type dest) -> result<map_handle::size_type> {
+    ++fills;
+    for(size_t n = 0; n < dest.len; n++)
+    {
+      dest.data[n] = static_cast<char>((offset + n) % 251);
+    }
+    return dest.len;
+  };
+  auto _mh = map_handle::map_lazy(pagesize * 256, detail::make_function_ptr<result<map_handle::size_type>(map_handle::extent_type, map_handle::buffer_type)>(fill), pagesize * 16);
+  if(!_mh && _mh.error() == std::errc::not_supported)
+  {
+    std::cout << "NOTE: map_handle::map_lazy() is not supported on this platform, skipping test" << std::endl;
+    return;
+  }
+  map_handle mh(std::move(_mh).value());
+  BOOST_REQUIRE(mh.is_lazy());
+  BOOST_CHECK(fills == 0);
+  // A random touch fills only the page touched
+  BOOST_CHECK(mh.address()[pagesize * 200 + 7] == static_cast<char>((pagesize * 200 + 7) % 251));
+  BOOST_CHECK(fills == 1);
+  // Sequential access is batched, and never refills the page already filled
+  for(size_t n = 0; n < pagesize * 256; n += pagesize)
+  {
+    BOOST_CHECK(mh.address()[n] == static_cast<char>(n % 251));
+  }
+  BOOST_CHECK(fills < 64);
+  BOOST_CHECK(mh.page_statistics().value().resident_pages == 256);
+  // Filled pages are ordinary memory
+  mh.address()[0] = 'x';
+  BOOST_CHECK(mh.address()[0] == 'x');
+  BOOST_CHECK(mh.lazy_status());
+  BOOST_CHECK(mh.relocate(pagesize * 512).error() == std::errc::not_supported);
+  mh.close().value();
+
+  // A failing fill yields zeroed pages and is reported
+  mh = map_handle::map_lazy(pagesize, detail::make_function_ptr<result<map_handle::size_type>(map_handle::extent_type, map_handle::buffer_type)>([](map_handle::extent_type, map_handle::buffer_type) -> result<map_handle::size_type> { return std::errc::io_error; })).value();
+  BOOST_CHECK(mh.address()[5] == 0);
+  BOOST_CHECK(mh.lazy_status().error() == std::errc::io_error);
+  mh.close().value();
+
+  // Pages are read on demand from an i/o handle, and zero past its end
+  file_handle fh = file_handle::file({}, "testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  std::vector<char> contents(pagesize * 3 + 100, 'a');
+  contents[pagesize * 2] = 'b';
+  fh.write(0, contents.data(), contents.size()).value();
+  mh = map_handle::map_lazy(pagesize * 8, fh).value();
+  BOOST_CHECK(mh.address()[pagesize * 2] == 'b');
+  BOOST_CHECK(mh.address()[pagesize * 3 + 99] == 'a');
+  BOOST_CHECK(mh.address()[pagesize * 3 + 100] == 0);
+  BOOST_CHECK(mh.address()[pagesize * 7] == 0);
+  BOOST_CHECK(mh.lazy_status());
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, map_handle_lazy, map_handle, "Tests that afio::map_handle::map_lazy() fills pages on demand", TestMapHandleLazy())
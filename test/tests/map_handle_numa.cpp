@@ -0,0 +1,67 @@
+/* Integration test kernel for NUMA placement of memory maps
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestMapHandleNuma()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  // Every system has a node zero, so binding to it must always work
+  const utils::numa_policy node0(utils::numa_policy::mode::bind, 1);
+  const size_t pagesize = utils::page_size();
+  map_handle mh = map_handle::map(pagesize * 16, section_handle::flag::readwrite | section_handle::flag::prefault, node0).value();
+  auto distribution = mh.numa_distribution().value();
+  BOOST_REQUIRE(!distribution.empty());
+  BOOST_CHECK(distribution[0] == 16);
+  for(size_t n = 1; n < distribution.size(); n++)
+  {
+    BOOST_CHECK(distribution[n] == 0);
+  }
+  // Pages not resident are not counted
+  map_handle untouched = map_handle::map(pagesize * 16).value();
+  size_t total = 0;
+  for(auto i : untouched.numa_distribution().value())
+  {
+    total += i;
+  }
+  BOOST_CHECK(total == 0);
+#ifndef _WIN32
+  untouched.set_numa_policy(node0, {}, true).value();
+  untouched.address()[0] = 1;
+  BOOST_CHECK(untouched.numa_distribution().value().at(0) == 1);
+#endif
+  // A node mask is required for anything but the default policy
+  BOOST_CHECK(!map_handle::map(pagesize, section_handle::flag::readwrite, utils::numa_policy(utils::numa_policy::mode::bind, 0)));
+
+  // The allocator places its allocations too
+  utils::page_allocator<char> allocator(node0);
+  utils::page_allocator<int> rebound(allocator);
+  BOOST_CHECK(rebound.numa().policy == utils::numa_policy::mode::bind);
+  char *p = allocator.allocate(pagesize * 4);
+  memset(p, 1, pagesize * 4);
+  allocator.deallocate(p, pagesize * 4);
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, map_handle_numa, map_handle, "Tests that afio::map_handle places and reports NUMA placement as expected", TestMapHandleNuma())
@@ -0,0 +1,105 @@
+/* Integration test kernel for page residency and fault statistics of maps
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static inline void TestMapHandlePageStatistics()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  const size_t pagesize = utils::page_size();
+  map_handle mh = map_handle::map(pagesize * 64).value();
+#ifdef __linux__
+  // A transparent huge page would fault in every page at once
+  ::madvise(mh.address(), pagesize * 64, MADV_NOHUGEPAGE);
+#endif
+
+  // A fresh anonymous map has no pages resident, and counts no faults until asked to
+  auto stats = mh.page_statistics().value();
+  BOOST_CHECK(stats.pages == 64);
+  BOOST_CHECK(stats.resident_pages == 0);
+  BOOST_CHECK(!mh.fault_accounting());
+  BOOST_CHECK(stats.major_faults == 0 && stats.minor_faults == 0);
+  mh.set_fault_accounting(true).value();
+  BOOST_CHECK(mh.fault_accounting());
+
+  // The first write to each page of anonymous memory takes a fault
+  {
+    map_handle::fault_scope scope(mh);
+    for(size_t n = 0; n < 16; n++)
+    {
+      mh.address()[n * pagesize] = 'a';
+    }
+  }
+  stats = mh.page_statistics().value();
+  BOOST_CHECK(stats.resident_pages == 16);
+  BOOST_CHECK(stats.minor_faults >= 16);
+  const uint64_t after_scope = stats.minor_faults + stats.major_faults;
+#ifdef __linux__
+  BOOST_CHECK(stats.dirty_pages <= stats.resident_pages);
+#else
+  BOOST_CHECK(stats.dirty_pages == static_cast<map_handle::size_type>(-1) || stats.dirty_pages <= stats.resident_pages);
+#endif
+
+  // Regions report only their own pages
+  stats = mh.page_statistics({mh.address() + 16 * pagesize, 16 * pagesize}).value();
+  BOOST_CHECK(stats.pages == 16);
+  BOOST_CHECK(stats.resident_pages == 0);
+
+  // write() is accounted
+  std::vector<char> data(16 * pagesize, 'b');
+  mh.write(32 * pagesize, data.data(), data.size()).value();
+  stats = mh.page_statistics().value();
+  BOOST_CHECK(stats.resident_pages == 32);
+  BOOST_CHECK(stats.minor_faults + stats.major_faults >= after_scope + 16);
+  const uint64_t after_write = stats.minor_faults + stats.major_faults;
+
+#ifdef __linux__
+  // Linux counts per thread, so faults taken outside any scope upon another thread are not counted
+  std::thread([&] {
+    for(size_t n = 48; n < 64; n++)
+    {
+      mh.address()[n * pagesize] = 'c';
+    }
+  }).join();
+  stats = mh.page_statistics().value();
+  BOOST_CHECK(stats.resident_pages == 48);
+  BOOST_CHECK(stats.minor_faults + stats.major_faults == after_write);
+#else
+  (void) after_write;
+#endif
+
+  // Disabling resets the totals
+  mh.set_fault_accounting(false).value();
+  stats = mh.page_statistics().value();
+  BOOST_CHECK(stats.major_faults == 0 && stats.minor_faults == 0);
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, map_handle_page_statistics, map_handle, "Tests that afio::map_handle::page_statistics() counts resident pages and the faults taken", TestMapHandlePageStatistics())
@@ -0,0 +1,92 @@
+/* Integration test kernel for faulting in mapped pages ahead of use
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <thread>
+#include <vector>
+
+static inline void TestMapHandlePopulate()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  const size_t pagesize = utils::page_size();
+  map_handle mh = map_handle::map(256 * pagesize).value();
+
+  // The region is rounded out to page boundaries
+  auto region = map_handle::populate({mh.address() + 5, 100}, true).value();
+  BOOST_CHECK(region.data == mh.address());
+  BOOST_CHECK(region.len == pagesize);
+  BOOST_CHECK(!map_handle::populate({nullptr, pagesize}));
+  region = map_handle::populate({mh.address(), 256 * pagesize}).value();
+  BOOST_CHECK(region.len == 256 * pagesize);
+  // Anonymous memory populated for read still reads as zero
+  for(size_t n = 0; n < 256 * pagesize; n += pagesize)
+  {
+    BOOST_CHECK(mh.address()[n] == 0);
+  }
+
+  // Very many populates in flight are queued upon a bounded pool, and all complete
+  const size_t concurrency = std::max<size_t>(std::thread::hardware_concurrency(), 2);
+  std::vector<std::shared_ptr<map_handle::async_populate_state>> states;
+  for(size_t n = 0; n < concurrency * 8; n++)
+  {
+    map_handle::buffer_type regions[] = {{mh.address() + (n % 256) * pagesize, pagesize}, {mh.address() + ((n + 1) % 256) * pagesize, pagesize}};
+    states.push_back(map_handle::async_populate(regions, (n & 1) != 0).value());
+  }
+  for(auto &state : states)
+  {
+    BOOST_CHECK(state->size() == 2);
+    // The deadline is for the whole wait, not for each region
+    BOOST_CHECK(state->wait(std::chrono::seconds(30)));
+    BOOST_CHECK(state->is_ready(0) && state->is_ready(1));
+  }
+
+  // Completions are posted to the service in order of region
+  io_service service;
+  std::vector<size_t> completed;
+  auto completion = detail::make_function_ptr<void(map_handle::async_populate_state *, size_t, result<map_handle::buffer_type>)>([&](map_handle::async_populate_state * /*unused*/, size_t idx, result<map_handle::buffer_type> r) {
+    BOOST_CHECK(r);
+    completed.push_back(idx);
+  });
+  map_handle::buffer_type regions[] = {{mh.address(), 64 * pagesize}, {mh.address() + 64 * pagesize, 64 * pagesize}, {mh.address() + 128 * pagesize, 128 * pagesize}};
+  auto state = map_handle::async_populate(regions, true, &service, std::move(completion)).value();
+  BOOST_CHECK(state->wait(2).value().len == 128 * pagesize);
+  while(completed.size() < 3)
+  {
+    service.run().value();
+  }
+  BOOST_CHECK(completed[0] == 0 && completed[1] == 1 && completed[2] == 2);
+  BOOST_CHECK(!state->wait(3));
+
+  // Cancelled regions not yet begun complete with operation_canceled
+  state = map_handle::async_populate(regions).value();
+  state->cancel();
+  for(size_t n = 0; n < 3; n++)
+  {
+    auto r = state->wait(n);
+    BOOST_CHECK(r || r.error() == std::errc::operation_canceled);
+  }
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, map_handle_populate, map_handle, "Tests that afio::map_handle::populate() and async_populate() work as expected", TestMapHandlePopulate())
@@ -0,0 +1,88 @@
+/* Integration test kernel for relocation of memory maps
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestMapHandleRelocate()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  const size_t pagesize = utils::page_size();
+  // Anonymous memory keeps its contents wherever it ends up
+  map_handle mh = map_handle::map(pagesize * 4).value();
+  for(size_t n = 0; n < 4; n++)
+  {
+    mh.address()[n * pagesize] = static_cast<char>('a' + n);
+  }
+  auto region = mh.relocate(pagesize * 64).value();
+  BOOST_CHECK(region.data == mh.address());
+  BOOST_CHECK(region.len == pagesize * 64);
+  BOOST_CHECK(mh.length() == pagesize * 64);
+  for(size_t n = 0; n < 4; n++)
+  {
+    BOOST_CHECK(mh.address()[n * pagesize] == static_cast<char>('a' + n));
+  }
+  // Shrinking never needs to move
+  char *addr = mh.address();
+  region = mh.relocate(pagesize * 2).value();
+  BOOST_CHECK(region.data == addr);
+  BOOST_CHECK(region.len == pagesize * 2);
+  BOOST_CHECK(mh.address()[pagesize] == 'b');
+  BOOST_CHECK(!mh.relocate(0));
+  // The free function forwards to the member function
+  BOOST_CHECK(!relocate(mh, 0));
+  mh.close().value();
+
+#ifdef __linux__
+  if(sizeof(void *) >= 8)
+  {
+    // Growing a huge anonymous map never touches its pages
+    map_handle big = map_handle::map(static_cast<size_t>(1) << 30U, section_handle::flag::readwrite | section_handle::flag::nocommit).value();
+    big.address()[0] = 'x';
+    big.set_fault_accounting(true).value();
+    region = big.relocate(static_cast<size_t>(20) << 30U).value();
+    BOOST_CHECK(region.len == static_cast<size_t>(20) << 30U);
+    auto stats = big.page_statistics().value();
+    BOOST_CHECK(stats.resident_pages <= 1);
+    BOOST_CHECK(big.address()[0] == 'x');
+  }
+#endif
+
+  // File backed maps see the same file contents after relocation
+  file_handle fh = file_handle::file({}, "testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  fh.truncate(pagesize * 8).value();
+  section_handle sh = section_handle::section(fh).value();
+  map_handle fmh = map_handle::map(sh, pagesize).value();
+  fmh.address()[0] = 'z';
+  region = fmh.relocate(pagesize * 8).value();
+  BOOST_CHECK(region.len == pagesize * 8);
+  BOOST_CHECK(fmh.length() == pagesize * 8);
+  BOOST_CHECK(fmh.address()[0] == 'z');
+  fmh.address()[pagesize * 7] = 'y';
+  char buffer[1];
+  fh.read(pagesize * 7, buffer, 1).value();
+  BOOST_CHECK(buffer[0] == 'y');
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, map_handle_relocate, map_handle, "Tests that afio::map_handle::relocate() moves maps without losing their contents", TestMapHandleRelocate())
@@ -0,0 +1,89 @@
+/* Integration test kernel for growing mapped files without the map moving
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <atomic>
+#include <thread>
+
+static inline void TestMappedFileHandleGrowth()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  const size_t pagesize = utils::page_size();
+  mapped_file_handle mfh = mapped_file_handle::mapped_file({}, "testfile", mapped_file_handle::mode::write, mapped_file_handle::creation::if_needed, mapped_file_handle::caching::all, mapped_file_handle::flag::unlink_on_close).value();
+  mfh.truncate(pagesize).value();
+  const mapped_file_handle::size_type address_space = (sizeof(void *) > 4) ? (1ULL << 36U) : (64 * 1024 * 1024);
+  BOOST_REQUIRE(mfh.reserve_address_space(address_space).value() == address_space);
+  BOOST_CHECK(mfh.address_space() == address_space);
+  BOOST_CHECK(mfh.length().value() == pagesize);
+  char *const addr = mfh.address();
+  BOOST_REQUIRE(addr != nullptr);
+
+  // Have a reader scan the published length whilst the file is grown beneath it
+  std::atomic<bool> done(false);
+  std::atomic<size_t> mismatches(0);
+  std::thread reader([&] {
+    while(!done)
+    {
+      auto length = static_cast<size_t>(mfh.length().value());
+      for(size_t n = pagesize; n < length; n += pagesize)
+      {
+        // A newly published page may not have had its marker written yet
+        char c = addr[n];
+        if(c != 0 && c != static_cast<char>(n / pagesize))
+        {
+          ++mismatches;
+        }
+      }
+    }
+  });
+  for(size_t n = 2; n <= 1024; n++)
+  {
+    mfh.truncate(n * pagesize).value();
+    BOOST_REQUIRE(mfh.address() == addr);
+    addr[(n - 1) * pagesize] = static_cast<char>(n - 1);
+  }
+  done = true;
+  reader.join();
+  BOOST_CHECK(mismatches == 0);
+  BOOST_CHECK(mfh.length().value() == 1024 * pagesize);
+
+  // i/o must be bounded by the published length, not the address space
+  char buffer[64];
+  mapped_file_handle::buffer_type b{buffer, sizeof(buffer)};
+  auto read = mfh.read(mapped_file_handle::io_request<mapped_file_handle::buffers_type>({&b, 1}, 1024 * pagesize - 16)).value();
+  BOOST_CHECK(read[0].len == 16);
+
+  // Shrinking and growing beyond the address space
+  mfh.truncate(16 * pagesize).value();
+  BOOST_CHECK(mfh.length().value() == 16 * pagesize);
+  BOOST_CHECK(!mfh.truncate(address_space + pagesize));
+#ifndef _WIN32
+  // POSIX never moves the map, even when shrinking
+  BOOST_CHECK(mfh.address() == addr);
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, mapped_file_handle_growth, mapped_file_handle, "Tests that afio::mapped_file_handle::reserve_address_space() grows the file without the map moving", TestMappedFileHandleGrowth())
@@ -0,0 +1,65 @@
+/* Integration test kernel for snapshots of mapped files
+(C) 2017 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Dec 2017
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestMappedFileHandleSnapshot()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  const size_t pagesize = utils::page_size();
+  mapped_file_handle mfh = mapped_file_handle::mapped_file({}, "testfile", mapped_file_handle::mode::write, mapped_file_handle::creation::if_needed, mapped_file_handle::caching::all, mapped_file_handle::flag::unlink_on_close).value();
+  mfh.truncate(64 * pagesize + 100).value();
+  for(size_t n = 0; n < 64 * pagesize + 100; n++)
+  {
+    mfh.address()[n] = static_cast<char>(n / pagesize);
+  }
+  // Whole file, and a page aligned range ending at the end of the file, and an unaligned range
+  auto whole = mfh.snapshot().value();
+  auto tail = mfh.snapshot(8 * pagesize).value();
+  auto middle = mfh.snapshot(3 * pagesize + 7, 5 * pagesize).value();
+  BOOST_REQUIRE(whole.length().value() == 64 * pagesize + 100);
+  BOOST_REQUIRE(tail.length().value() == 56 * pagesize + 100);
+  BOOST_REQUIRE(middle.length().value() == 5 * pagesize);
+  // Modifying the original must not affect the snapshots
+  memset(mfh.address(), 0xff, 64 * pagesize + 100);
+  mfh.barrier({}, true).value();
+  BOOST_CHECK(whole.address() != mfh.address());
+  for(size_t n = 0; n < 64 * pagesize + 100; n++)
+  {
+    if(whole.address()[n] != static_cast<char>(n / pagesize))
+    {
+      BOOST_CHECK(whole.address()[n] == static_cast<char>(n / pagesize));
+      break;
+    }
+  }
+  BOOST_CHECK(tail.address()[0] == 8);
+  BOOST_CHECK(tail.address()[56 * pagesize + 99] == 64);
+  BOOST_CHECK(middle.address()[0] == 3);
+  BOOST_CHECK(middle.address()[5 * pagesize - 1] == 8);
+  // Empty and out of range snapshots are rejected
+  BOOST_CHECK(!mfh.snapshot(64 * pagesize + 100));
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, mapped_file_handle_snapshot, mapped_file_handle, "Tests that afio::mapped_file_handle::snapshot() works as expected", TestMappedFileHandleSnapshot())
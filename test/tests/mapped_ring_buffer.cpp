@@ -0,0 +1,109 @@
+/* Integration test kernel for the double mapped ring buffer
+(C) 2018 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Jan 2018
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <thread>
+#include <vector>
+
+static inline void TestMappedRingBuffer()
+{
+  using namespace AFIO_V2_NAMESPACE;
+  auto ring = algorithm::mapped_ring_buffer::ring(10000).value();
+  BOOST_CHECK(ring.capacity() >= 10000);
+  BOOST_CHECK((ring.capacity() & (ring.capacity() - 1)) == 0);
+  BOOST_CHECK(ring.empty());
+  BOOST_CHECK(!ring.reserve(0));
+  BOOST_CHECK(!ring.reserve(ring.capacity() + 1));
+
+  // Several producers push records of varying length which repeatedly wrap the end of the storage,
+  // and the consumer must always see whole records in the order each producer pushed them
+  static constexpr size_t producers = 4;
+  static constexpr uint64_t records = 100000;
+  std::vector<std::thread> threads;
+  for(size_t p = 0; p < producers; p++)
+  {
+    threads.emplace_back([&ring, p] {
+      for(uint64_t n = 0; n < records;)
+      {
+        size_t len = 16 + static_cast<size_t>(n % 37);
+        auto space = ring.reserve(len);
+        if(!space)
+        {
+          std::this_thread::yield();
+          continue;
+        }
+        auto l = static_cast<uint32_t>(len), pp = static_cast<uint32_t>(p);
+        memcpy(space.value().data, &l, 4);
+        memcpy(space.value().data + 4, &pp, 4);
+        memcpy(space.value().data + 8, &n, 8);
+        ring.commit(space.value());
+        ++n;
+      }
+    });
+  }
+  uint64_t next[producers] = {0}, received = 0;
+  bool ordered = true, whole = true;
+  while(received < producers * records)
+  {
+    auto committed = ring.peek();
+    size_t offset = 0;
+    while(offset + 16 <= committed.len)
+    {
+      uint32_t l, pp;
+      uint64_t n;
+      memcpy(&l, committed.data + offset, 4);
+      memcpy(&pp, committed.data + offset + 4, 4);
+      memcpy(&n, committed.data + offset + 8, 8);
+      whole = whole && (offset + l <= committed.len);
+      ordered = ordered && (pp < producers) && (n == next[pp]);
+      next[pp % producers]++;
+      offset += l;
+      ++received;
+    }
+    ring.consume(offset);
+  }
+  for(auto &t : threads)
+  {
+    t.join();
+  }
+  BOOST_CHECK(whole);
+  BOOST_CHECK(ordered);
+  BOOST_CHECK(ring.empty());
+
+  // File backed rings persist their contents
+  file_handle fh = file_handle::file({}, "testfile", file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::all, file_handle::flag::unlink_on_close).value();
+  {
+    auto fring = algorithm::mapped_ring_buffer::ring(fh, 5000).value();
+    fring.push({"hello", 5}).value();
+  }
+  auto fring = algorithm::mapped_ring_buffer::ring(fh).value();
+  BOOST_CHECK(fring.capacity() >= 5000);
+  auto committed = fring.peek();
+  BOOST_CHECK(committed.len == 5);
+  BOOST_CHECK(0 == memcmp(committed.data, "hello", 5));
+}
+
+KERNELTEST_TEST_KERNEL(integration, afio, algorithm, mapped_ring_buffer, "Tests that afio::algorithm::mapped_ring_buffer works as expected", TestMappedRingBuffer())
@@ -45,8 +45,17 @@ static inline void TestPathView()
   // cstr
   afio::path_view::c_str g(e);
   BOOST_CHECK(g.buffer != p);  // NOLINT
+  BOOST_CHECK(g.length == 69);
+  BOOST_CHECK(0 == memcmp(g.buffer, p, 69) && g.buffer[69] == 0);
   afio::path_view::c_str h(f);
   BOOST_CHECK(h.buffer == p + 70);  // NOLINT
+  // Paths too long for the internal buffer are copied to the heap
+  std::string long_path(2000, 'a');
+  afio::path_view l(long_path.data(), 1999);
+  afio::path_view::c_str m(l);
+  BOOST_CHECK(m.buffer != long_path.data());
+  BOOST_CHECK(m.length == 1999);
+  BOOST_CHECK(m.buffer[1998] == 'a' && m.buffer[1999] == 0);
 #endif
 
 #ifdef _WIN32
@@ -72,6 +81,13 @@ static inline void TestPathView()
   BOOST_CHECK(j.buffer == p2);
   afio::path_view::c_str k(h, false);
   BOOST_CHECK(k.buffer == p2 + 70);
+  // UTF-8 paths too long for the internal buffer are converted on the heap
+  std::string long_path(2000, 'a');
+  long_path[1000] = '/';
+  afio::path_view l(long_path.data(), 1999);
+  afio::path_view::c_str m(l, false);
+  BOOST_CHECK(m.length == 1999);
+  BOOST_CHECK(m.buffer[1000] == '\\' && m.buffer[1998] == 'a' && m.buffer[1999] == 0);
 #endif
 }
 